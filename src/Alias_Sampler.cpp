@@ -0,0 +1,144 @@
+/*
+ * Alias_Sampler.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Alias_Sampler.hpp"
+#include <iostream>
+#include <algorithm>
+
+Alias_Sampler::Alias_Sampler() {
+	size = 0;
+}
+
+Alias_Sampler::~Alias_Sampler() {
+
+}
+
+// build table from (unnormalized, non-negative) bin weights
+void Alias_Sampler::init(const vector<double> &weights)
+{
+	size = weights.size();
+	prob.assign(size, 1.0);
+	alias.resize(size);
+
+	double total = 0.0;
+	for (int i=0; i<size; i++)
+	{
+		total = total + max(weights[i], 0.0);
+	}
+	if (size == 0 || !(total > 0.0))
+	{
+		cout << "Cannot sample from a distribution with no positive weights!\n";
+		exit(1);
+	}
+
+	CDF.resize(size);
+	double sum = 0.0;
+	for (int i=0; i<size; i++)
+	{
+		sum = sum + max(weights[i], 0.0);
+		CDF[i] = sum/total;
+	}
+
+	// scale weights so that they average 1, then pair each underfull bin with an overfull one
+	vector<double> scaled(size);
+	vector<int> small;
+	vector<int> large;
+	for (int i=0; i<size; i++)
+	{
+		alias[i] = i;
+		scaled[i] = max(weights[i], 0.0)*size/total;
+		if (scaled[i] < 1.0)
+		{
+			small.push_back(i);
+		}
+		else
+		{
+			large.push_back(i);
+		}
+	}
+	while (!small.empty() && !large.empty())
+	{
+		int s = small.back();
+		small.pop_back();
+		int l = large.back();
+		large.pop_back();
+
+		prob[s] = scaled[s];
+		alias[s] = l;
+		scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+		if (scaled[l] < 1.0)
+		{
+			small.push_back(l);
+		}
+		else
+		{
+			large.push_back(l);
+		}
+	}
+
+	// whatever is left over is full to within rounding error
+	for (int i : small)
+	{
+		prob[i] = 1.0;
+	}
+	for (int i : large)
+	{
+		prob[i] = 1.0;
+	}
+}
+
+// build table from a cumulative distribution over bins (CDF[i] = probability of bins 0 through i)
+void Alias_Sampler::init_from_CDF(const vector<double> &CDF)
+{
+	vector<double> weights(CDF.size());
+	for (unsigned i=0; i<CDF.size(); i++)
+	{
+		weights[i] = (i == 0) ? CDF[i] : CDF[i] - CDF[i-1];
+	}
+	init(weights);
+}
+
+// returns bin index for uniform random number u in [0, 1)
+// (the integer part of u*size picks a bin, the fractional part decides between it and its alias)
+int Alias_Sampler::sample(double u) const
+{
+	double x = u*size;
+	int i = (int)x;
+	if (i >= size)
+	{
+		i = size - 1;
+	}
+	else if (i < 0)
+	{
+		i = 0;
+	}
+	return (x - i < prob[i]) ? i : alias[i];
+}
+
+// returns bin index for u in [0, 1) by inverting the cumulative distribution (binary search), and sets frac
+// to the position of u within the bin
+int Alias_Sampler::sample_ordered(double u, double &frac) const
+{
+	int i = upper_bound(CDF.begin(), CDF.end(), u) - CDF.begin();
+	if (i >= size)
+	{
+		// rounding left the last CDF value just below u: take the last bin of nonzero weight
+		i = size - 1;
+		while (i > 0 && CDF[i] == CDF[i-1])
+		{
+			i--;
+		}
+	}
+	double lower = (i == 0) ? 0.0 : CDF[i-1];
+	frac = min(max((u - lower)/(CDF[i] - lower), 0.0), 1.0);
+	return i;
+}
+
+int Alias_Sampler::get_size() const
+{
+	return size;
+}
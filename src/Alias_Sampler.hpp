@@ -0,0 +1,44 @@
+/*
+ * Alias_Sampler.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef ALIAS_SAMPLER_HPP_
+#define ALIAS_SAMPLER_HPP_
+
+#include <vector>
+using namespace std;
+
+// Walker alias table for drawing bin indices from a discrete distribution in constant time
+// (built with Vose's method; bins of zero weight are never drawn)
+class Alias_Sampler {
+public:
+	Alias_Sampler();
+	virtual ~Alias_Sampler();
+
+	// build table from (unnormalized, non-negative) bin weights
+	void init(const vector<double> &weights);
+
+	// build table from a cumulative distribution over bins (CDF[i] = probability of bins 0 through i)
+	void init_from_CDF(const vector<double> &CDF);
+
+	// returns bin index for uniform random number u in [0, 1)
+	int sample(double u) const;
+
+	// returns bin index for u in [0, 1) by inverting the cumulative distribution, and sets frac to the position
+	// of u within that bin's share of [0, 1); unlike sample(), this is monotone in u, so evenly spread u
+	// (e.g. quasi-random numbers) give evenly spread bins and positions within bins
+	int sample_ordered(double u, double &frac) const;
+
+	int get_size() const;
+
+private:
+	int size;
+	vector<double> prob;   // probability of keeping bin i rather than taking its alias
+	vector<int> alias;     // bin taken instead of bin i with probability 1 - prob[i]
+	vector<double> CDF;    // normalized cumulative distribution over bins, for sample_ordered()
+};
+
+#endif /* ALIAS_SAMPLER_HPP_ */
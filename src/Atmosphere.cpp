@@ -8,87 +8,179 @@
 #include "Atmosphere.hpp"
 
 // construct atmosphere using given parameters
-Atmosphere::Atmosphere(int n, int num_to_trace, string trace_output_dir, Planet p, vector<shared_ptr<Particle>> parts, shared_ptr<Distribution> dist, Background_Species bg, int num_EDFs, int EDF_alts[])
+Atmosphere::Atmosphere(int n, int num_to_trace, string trace_output_dir, Planet p, const vector<Particle> &parts, shared_ptr<Distribution> dist, const Background_Species &bg, int num_EDFs, int EDF_alts[], int threads, int first_id)
 {
 	num_parts = n;                // number of test particles to track
+	this->first_id = first_id;
 	num_traced = num_to_trace;    // number of tracked particles to output detailed trace data for
 	trace_dir = trace_output_dir;
 	active_parts = num_parts;
 	my_planet = p;
 	my_dist = dist;
 	my_parts.resize(num_parts);
+	part_ids.resize(num_parts);
 	bg_species = bg;
+	num_collisions = 0;
+	num_threads = threads;
+	recording_births = false;
+	track_length = false;
+	integrator = integrator_verlet;
+	checking_energy = false;
+	step_error_sum = 0.0;
+	step_error_max = 0.0;
+	flight_drift_max = 0.0;
+	num_checked_steps = 0;
+	substep_tau = 0.0;
+	max_substep_level = 0;
+	num_substeps_taken = 0;
+	coupled_collisions = false;
+	sort_freq = 0;
+	parallel_mode = parallel_serial;
+	num_migrations = 0;
+	last_rebalance = 0;
+	num_rebalances = 0;
+	imbalance_sum = 0.0;
+	num_parallel_steps = 0;
+	final_fates.assign(num_parts, fate_active);
+
+	init_particles(parts);
+
+	//initialize stats tracking vectors: one tally for all particles, plus one per source if the distribution mixes sources
+	stats_num_EDFs = num_EDFs;
+	stats_EDF_alts.resize(stats_num_EDFs);
+	for (int i=0; i<stats_num_EDFs; i++)
+	{
+		stats_EDF_alts[i] = EDF_alts[i];
+	}
+	int num_sources = my_dist->get_num_sources();
+	stats.resize(num_sources > 1 ? 1 + num_sources : 1);
+	for (Stats_Tally &t : stats)
+	{
+		init_tally(t);
+	}
 
-	for (int i=0; i<num_parts; i++)
+	// pick trace particles if any
+	if (num_traced > 0)
 	{
-		my_parts[i] = parts[i];
-		my_dist->init(my_parts[i]);
+		traced_parts.resize(num_traced);
+		for (int i=0; i<num_traced; i++)
+		{
+			traced_parts[i] = common::get_rand_int(0, num_parts-1);
+			my_parts[traced_parts[i]].set_traced();
+		}
 	}
+}
 
-	//initialize stats tracking vectors
-	stats_num_EDFs = num_EDFs;
-	stats_EDF_alts.resize(stats_num_EDFs);
-	stats_loss_rates.resize(stats_num_EDFs);
-	stats_EDFs.resize(2);   // index 0 is day side EDFs, 1 is night side
-	stats_EDFs[0].resize(stats_num_EDFs);
-	stats_EDFs[1].resize(stats_num_EDFs);
-	stats_angleavg_dens.resize(stats_num_EDFs); // vector for accumulating angle-averaged column density counts in x=const. plane
+Atmosphere::~Atmosphere() {
+	stop_workers();
+}
+
+// size and zero a stats tally; a sparse tally only gets its outer structure here (see tally_row and tally_bin)
+void Atmosphere::init_tally(Stats_Tally &t, bool sparse)
+{
+	t.loss_rates.resize(stats_num_EDFs);
+	t.EDFs.resize(2);   // index 0 is day side EDFs, 1 is night side
+	t.EDFs[0].resize(stats_num_EDFs);
+	t.EDFs[1].resize(stats_num_EDFs);
+	t.angleavg_dens.resize(stats_num_EDFs); // vector for accumulating angle-averaged column density counts in x=const. plane
 
 	for (int i=0; i<stats_num_EDFs; i++)
 	{
-		stats_EDF_alts[i] = EDF_alts[i];
-		stats_loss_rates[i] = 0.0;
-		stats_EDFs[0][i].resize(201);
-		stats_EDFs[1][i].resize(201);
+		t.loss_rates[i] = 0.0;
+		t.angleavg_dens[i] = 0.0;
+		t.EDFs[0][i].resize(201);
+		t.EDFs[1][i].resize(201);
 
-		for (int j=0; j<201; j++)
+		for (int j=0; j<201 && !sparse; j++)
 		{
-			stats_EDFs[0][i][j].resize(201);
-			stats_EDFs[1][i][j].resize(201);
+			t.EDFs[0][i][j].resize(201);
+			t.EDFs[1][i][j].resize(201);
 
 			for(int k=0; k<201; k++)
 			{
-				stats_EDFs[0][i][j][k] = 0.0;
-				stats_EDFs[1][i][j][k] = 0.0;
+				t.EDFs[0][i][j][k] = 0.0;
+				t.EDFs[1][i][j][k] = 0.0;
 			}
 		}
 	}
 
-	stats_dens_counts.resize(2);  // index 0 is day side, 1 is night side
-	stats_dens_counts[0].resize(100001);
-	stats_dens_counts[1].resize(100001);
-	stats_coldens_counts.resize(100001);
+	t.dens_counts.resize(2);  // index 0 is day side, 1 is night side
+	t.dens2d_counts.resize(1025);
+	if (sparse)
+	{
+		return;
+	}
+	t.dens_counts[0].resize(100001);
+	t.dens_counts[1].resize(100001);
+	t.coldens_counts.resize(100001);
 	for (int i=0; i<100001; i++)
 	{
-		stats_dens_counts[0][i] = 0;
-		stats_dens_counts[1][i] = 0;
-		stats_coldens_counts[i] = 0;
+		t.dens_counts[0][i] = 0;
+		t.dens_counts[1][i] = 0;
+		t.coldens_counts[i] = 0;
 	}
 
-	stats_dens2d_counts.resize(1025);
 	for (int i=0; i<1025; i++)
 	{
-		stats_dens2d_counts[i].resize(1025);
+		t.dens2d_counts[i].resize(1025);
 		for (int j=0; j<1025; j++)
 		{
-			stats_dens2d_counts[i][j] = 0;
+			t.dens2d_counts[i][j] = 0;
 		}
 	}
+}
 
-	// pick trace particles if any
-	if (num_traced > 0)
+// initialize my_parts from parts using the distribution, in chunks of init_chunk_size spread over num_threads
+// threads; chunk c uses random number stream c, so the result does not depend on the number of threads
+void Atmosphere::init_particles(const vector<Particle> &parts)
+{
+	int num_chunks = (num_parts + init_chunk_size - 1) / init_chunk_size;
+	atomic<int> next_chunk(0);
+
+	auto worker = [&]()
 	{
-		traced_parts.resize(num_traced);
-		for (int i=0; i<num_traced; i++)
+		Particle_Store chunk;
+		int c;
+		while ((c = next_chunk++) < num_chunks)
 		{
-			traced_parts[i] = common::get_rand_int(0, num_parts-1);
-			my_parts[traced_parts[i]]->set_traced();
+			int begin = c*init_chunk_size;
+			int n = min(init_chunk_size, num_parts - begin);
+			chunk.resize(n);
+			for (int k=0; k<n; k++)
+			{
+				chunk.id[k] = first_id + begin + k;
+				chunk.species[k] = parts[begin + k].get_species();
+				chunk.source[k] = 0;
+			}
+			my_dist->init_batch(chunk, 0, n, first_id/init_chunk_size + c);
+			for (int k=0; k<n; k++)
+			{
+				// an imported distribution may give particles a different species than they were made with
+				if (chunk.species[k] == parts[begin + k].get_species())
+				{
+					my_parts[begin + k] = parts[begin + k];
+				}
+				else
+				{
+					my_parts[begin + k] = Particle(chunk.species[k]);
+				}
+				my_parts[begin + k].set_source(chunk.source[k]);
+				part_ids[begin + k] = chunk.id[k];
+				my_parts[begin + k].init_particle(chunk.x[k], chunk.y[k], chunk.z[k], chunk.vx[k], chunk.vy[k], chunk.vz[k]);
+			}
 		}
-	}
-}
-
-Atmosphere::~Atmosphere() {
+	};
 
+	// always run on worker threads, so the main thread's random number sequence is left untouched
+	vector<thread> workers;
+	for (int t=0; t<min(num_threads, max(num_chunks, 1)); t++)
+	{
+		workers.push_back(thread(worker));
+	}
+	for (thread &w : workers)
+	{
+		w.join();
+	}
 }
 
 // writes single-column output file of altitude bin counts using active particles
@@ -103,11 +195,11 @@ void Atmosphere::output_altitude_distro(double bin_width, string datapath)
 	double max_radius = 0.0;
 	for (int i=0; i<num_parts; i++)
 	{
-		if (my_parts[i]->is_active())
+		if (my_parts[i].is_active())
 		{
-			if (my_parts[i]->get_radius() > max_radius)
+			if (my_parts[i].get_radius() > max_radius)
 			{
-				max_radius = my_parts[i]->get_radius();
+				max_radius = my_parts[i].get_radius();
 			}
 		}
 	}
@@ -116,9 +208,9 @@ void Atmosphere::output_altitude_distro(double bin_width, string datapath)
 
 	for (int i=0; i<num_parts; i++)
 	{
-		if (my_parts[i]->is_active())
+		if (my_parts[i].is_active())
 		{
-			alt = my_parts[i]->get_radius() - my_planet.get_radius();
+			alt = my_parts[i].get_radius() - my_planet.get_radius();
 			nb = (int)(alt / bin_width);
 			abins[nb]++;
 		}
@@ -139,7 +231,7 @@ void Atmosphere::output_collision_data()
 	for (int i=0; i<num_traced; i++)
 	{
 		string filename = trace_dir + "part" + to_string(traced_parts[i]) + "_collisions.out";
-		my_parts[traced_parts[i]]->dump_collision_log(filename);
+		my_parts[traced_parts[i]].dump_collision_log(filename);
 	}
 }
 
@@ -151,25 +243,52 @@ void Atmosphere::output_positions(string datapath)
 	outfile.open(datapath);
 	for (int i=0; i<num_parts; i++)
 	{
-		outfile << setprecision(10) << my_parts[i]->get_x() << '\t';
-		outfile << setprecision(10) << my_parts[i]->get_y() << '\t';
-		outfile << setprecision(10) << my_parts[i]->get_z() << '\n';
+		outfile << setprecision(10) << my_parts[i].get_x() << '\t';
+		outfile << setprecision(10) << my_parts[i].get_y() << '\t';
+		outfile << setprecision(10) << my_parts[i].get_z() << '\n';
 	}
 	outfile.close();
 }
 
+// binary snapshot of the active particles (see Particle_File.hpp), which can be imported to seed another run
+void Atmosphere::output_snapshot(string datapath)
+{
+	Particle_Store snapshot;
+	snapshot.resize(active_parts);
+	int n = 0;
+	for (int i=0; i<num_parts && n<active_parts; i++)
+	{
+		const Particle &p = my_parts[i];
+		if (!p.is_active())
+		{
+			continue;
+		}
+		snapshot.id[n] = part_ids[i];
+		snapshot.species[n] = p.get_species();
+		snapshot.x[n] = p.get_x();
+		snapshot.y[n] = p.get_y();
+		snapshot.z[n] = p.get_z();
+		snapshot.vx[n] = p.get_vx();
+		snapshot.vy[n] = p.get_vy();
+		snapshot.vz[n] = p.get_vz();
+		n++;
+	}
+	snapshot.resize(n);
+	Particle_File::write(datapath, snapshot, NULL);
+}
+
 // output test particle trace data for selected particles
 void Atmosphere::output_trace_data()
 {
 	for (int i=0; i<num_traced; i++)
 	{
-		if (my_parts[traced_parts[i]]->is_active())
+		if (my_parts[traced_parts[i]].is_active())
 		{
 			ofstream position_file;
 			position_file.open(trace_dir + "part" + to_string(traced_parts[i]) + "_positions.out", ios::out | ios::app);
-			position_file << setprecision(10) << my_parts[traced_parts[i]]->get_x() << '\t';
-			position_file << setprecision(10) << my_parts[traced_parts[i]]->get_y() << '\t';
-			position_file << setprecision(10) << my_parts[traced_parts[i]]->get_z() << '\n';
+			position_file << setprecision(10) << my_parts[traced_parts[i]].get_x() << '\t';
+			position_file << setprecision(10) << my_parts[traced_parts[i]].get_y() << '\t';
+			position_file << setprecision(10) << my_parts[traced_parts[i]].get_z() << '\n';
 			position_file.close();
 		}
 	}
@@ -187,9 +306,9 @@ void Atmosphere::output_velocity_distro(double bin_width, string datapath)
 	double max_v = 0.0;
 	for (int i=0; i<num_parts; i++)
 	{
-		if (my_parts[i]->is_active())
+		if (my_parts[i].is_active())
 		{
-			double total_v = my_parts[i]->get_total_v();
+			double total_v = my_parts[i].get_total_v();
 			if (total_v > max_v)
 			{
 				max_v = total_v;
@@ -201,9 +320,9 @@ void Atmosphere::output_velocity_distro(double bin_width, string datapath)
 
 	for (int i=0; i<num_parts; i++)
 	{
-		if (my_parts[i]->is_active())
+		if (my_parts[i].is_active())
 		{
-			v = my_parts[i]->get_total_v();
+			v = my_parts[i].get_total_v();
 			nb = (int)(v / bin_width);
 			vbins[nb]++;
 		}
@@ -232,9 +351,9 @@ void Atmosphere::output_alt_energy_distro(double alt_in_cm, double e_bin_width,
 	double max_e = 0.0;
 	for (int i=0; i<num_parts; i++)
 	{
-		if (my_parts[i]->is_active() && my_parts[i]->get_radius() >= r && my_parts[i]->get_radius() < r + 1e5)
+		if (my_parts[i].is_active() && my_parts[i].get_radius() >= r && my_parts[i].get_radius() < r + 1e5)
 		{
-			double total_e = my_parts[i]->get_energy_in_eV();
+			double total_e = my_parts[i].get_energy_in_eV();
 			if (total_e > max_e)
 			{
 				max_e = total_e;
@@ -246,9 +365,9 @@ void Atmosphere::output_alt_energy_distro(double alt_in_cm, double e_bin_width,
 
 	for (int i=0; i<num_parts; i++)
 	{
-		if (my_parts[i]->is_active() && my_parts[i]->get_radius() >= r && my_parts[i]->get_radius() < r + 1e5)
+		if (my_parts[i].is_active() && my_parts[i].get_radius() >= r && my_parts[i].get_radius() < r + 1e5)
 		{
-			e = my_parts[i]->get_energy_in_eV();
+			e = my_parts[i].get_energy_in_eV();
 			nb = (int)(e / e_bin_width);
 			ebins[nb]++;
 		}
@@ -266,30 +385,64 @@ void Atmosphere::output_alt_energy_distro(double alt_in_cm, double e_bin_width,
 
 // iterate equation of motion and check for collisions for each active particle being tracked
 // a lot of stuff in here needs to be changed to be dynamically determined at runtime
-void Atmosphere::run_simulation(double dt, int num_steps, double lower_bound, double upper_bound, int print_status_freq, int output_pos_freq, string output_pos_dir, string output_stats_dir)
+void Atmosphere::run_simulation(const Run_Options &options)
 {
+	double dt = options.dt;
+	int num_steps = options.num_steps;
 	int night_escape_count = 0;
 	int day_escape_count = 0;
-	double v_esc_current = 0.0;
-	double v_thermal = 0.0;
+	int num_sources = my_dist->get_num_sources();
+	vector<int> source_escape_count(num_sources, 0);  // escapes (day and night) of the particles from each source
+	shared_ptr<Distribution_Response> response = dynamic_pointer_cast<Distribution_Response>(my_dist);  // set in escape response mode
 
 	// most probable MB velocity of test particle at 200K
-	//double v_mp = sqrt(2.0*constants::k_b*200.0/my_parts[0]->get_mass());
+	//double v_mp = sqrt(2.0*constants::k_b*200.0/my_parts[0].get_mass());
 
 	// RMS thermal velocity of test particle at 200K
-	//double v_rms = sqrt(3.0*constants::k_b*200.0/my_parts[0]->get_mass());
+	//double v_rms = sqrt(3.0*constants::k_b*200.0/my_parts[0].get_mass());
 
 	// average thermal velocity of test particle at 200K
-	//double v_avg = sqrt(8.0*constants::k_b*200.0/(constants::pi*my_parts[0]->get_mass()));
+	//double v_avg = sqrt(8.0*constants::k_b*200.0/(constants::pi*my_parts[0].get_mass()));
 
 	// background O velocity as defined in Justin's original code
 	//double v_Obg = sqrt(8.0*constants::k_b*277.6 / (constants::pi*15.9994*constants::amu));
 
-	upper_bound = my_planet.get_radius() + upper_bound;
-	lower_bound = my_planet.get_radius() + lower_bound;
-	double v_esc_upper = sqrt(2.0 * constants::G * my_planet.get_mass() / upper_bound);
+	r_upper = my_planet.get_radius() + options.upper_bound;
+	r_lower = my_planet.get_radius() + options.lower_bound;
+	two_GM = 2.0 * constants::G * my_planet.get_mass();
+	v_esc_upper = sqrt(two_GM / r_upper);
+	k_g = my_planet.get_k_g();
 	double global_rate = my_dist->get_global_rate();
-	double k = my_planet.get_k_g();
+	integrator = options.method;
+
+	// adaptive substeps: up to max_substeps (rounded down to a power of 2) per timestep
+	substep_tau = options.max_substep_tau;
+	max_substep_level = 0;
+	while ((2 << max_substep_level) <= options.max_substeps && max_substep_level < 30)
+	{
+		max_substep_level++;
+	}
+
+	sort_freq = options.sort_freq;
+	parallel_mode = options.parallel;
+
+	checking_energy = options.check_energy;
+	if (checking_energy)
+	{
+		flight_energy.resize(num_parts);
+		for (int i=0; i<num_parts; i++)
+		{
+			flight_energy[i] = my_parts[i].get_specific_energy(k_g);
+		}
+	}
+
+	// record birth states, and tally by birth altitude from here on, if asked
+	recording_births = options.record_births;
+	if (recording_births)
+	{
+		output_snapshot(options.output_stats_dir + "births.c3dp");
+		init_birth_record(dt, options.upper_bound, global_rate);
+	}
 
 	vector<int> active_indices;  // list of indices for active particles
 	active_indices.resize(num_parts);
@@ -298,6 +451,23 @@ void Atmosphere::run_simulation(double dt, int num_steps, double lower_bound, do
 		active_indices[i] = i;
 	}
 
+	// tally initial states; after this, each particle's new state is tallied by the transport kernel
+	// at the end of every step, which is equivalent to tallying at the beginning of the next step
+	// (the track-length estimator instead tallies each step's path, including the last step, so it skips this)
+	track_length = options.track_length_stats;
+	init_shards((parallel_mode == parallel_serial) ? 1 : num_threads);
+	Step_State s;
+	if (num_steps > 0 && !track_length)
+	{
+		for (int j=0; j<num_parts; j++)
+		{
+			get_step_state(j, s);
+			update_stats(shards[0], dt, j, s);
+		}
+	}
+
+	vector<Particle_Fate> step_fates(num_parts);  // fate of each particle in active_indices during the current step
+
 	cout << "Simulating Particle Transport...\n";
 
 	for (int i=0; i<num_steps; i++)
@@ -307,7 +477,7 @@ void Atmosphere::run_simulation(double dt, int num_steps, double lower_bound, do
 			break;
 		}
 
-		if (print_status_freq > 0 && (i+1) % print_status_freq == 0)
+		if (options.print_status_freq > 0 && (i+1) % options.print_status_freq == 0)
 		{
 			double hrs = (i+1)*dt/3600.0;
 			double min = (hrs - (int)hrs)*60.0;
@@ -315,9 +485,16 @@ void Atmosphere::run_simulation(double dt, int num_steps, double lower_bound, do
 			cout << (int)hrs << "h "<< (int)min << "m " << sec << "s " << "\tActive: " << active_parts << "\tDay escape: " << day_escape_count << "\tDay fraction: " << (double)day_escape_count / (double)(num_parts) << "\tNight escape: " << night_escape_count <<  "\tNight fraction: " << (double)night_escape_count / (double)(num_parts) <<endl;
 		}
 
-		if (output_pos_freq > 0 && (i+1) % output_pos_freq == 0)
+		if (options.output_pos_freq > 0 && (i+1) % options.output_pos_freq == 0)
 		{
-			output_positions(output_pos_dir + "positions" + to_string(i+1) + ".out");
+			if (options.output_pos_binary)
+			{
+				output_snapshot(options.output_pos_dir + "particles" + to_string(i+1) + ".c3dp");
+			}
+			else
+			{
+				output_positions(options.output_pos_dir + "positions" + to_string(i+1) + ".out");
+			}
 		}
 
 		if (num_traced > 0)
@@ -325,75 +502,98 @@ void Atmosphere::run_simulation(double dt, int num_steps, double lower_bound, do
 			output_trace_data();
 		}
 
-		for (int j=0; j<active_parts; j++)
+		if (sort_freq > 0 && i % sort_freq == 0 && parallel_mode != parallel_shells)
 		{
-			update_stats(dt, active_indices[j]);
-			my_parts[active_indices[j]]->do_timestep(dt, k);
+			sort_by_altitude(active_indices, active_parts);
+		}
+
+		// states reached on the final step are never tallied by the point estimator
+		bool tally = (i < num_steps-1) || track_length;
 
-			if (bg_species.check_collision(my_parts[active_indices[j]], dt))
+		// transport active particles in blocks, then compact the survivors to the front of active_indices
+		if (parallel_mode == parallel_serial)
+		{
+			for (int b=0; b<active_parts; b+=transport_block_size)
 			{
-				my_parts[active_indices[j]]->do_collision(bg_species.get_collision_target(), bg_species.get_collision_theta(), i*dt, my_planet.get_radius());
+				int n = min(transport_block_size, active_parts - b);
+				if (substep_tau > 0.0)
+				{
+					transport_block_adaptive(shards[0], &active_indices[b], n, dt, i*dt, tally, &step_fates[b]);
+				}
+				else
+				{
+					transport_block(shards[0], &active_indices[b], n, dt, i*dt, tally, &step_fates[b]);
+				}
 			}
+		}
+		else
+		{
+			transport_step_parallel(active_indices, active_parts, dt, i, tally, step_fates.data());
+		}
 
-			// escape velocity at current radius
-			v_esc_current = sqrt(2.0 * constants::G * my_planet.get_mass() / my_parts[active_indices[j]]->get_radius());
-
-			// thermalized threshold velocity; set to either v_esc_current, v_mp, v_rms, or v_avg
-			// v_esc_current defined just above; others defined at beginning of run_simulation function
-			v_thermal = v_esc_current;
-
-			// deactivation criteria from Justin's original Hot O simulation code (must also uncomment v_Obg declaration above to use)
-			//if (my_parts[active_indices[j]]->get_radius() < (my_planet.get_radius() + 900e5) && (my_parts[active_indices[j]]->get_total_v() + v_Obg) < sqrt(2.0*constants::G*my_planet.get_mass()*(my_parts[active_indices[j]]->get_inverse_radius()-1.0/(my_planet.get_radius()+900e5))))
-			//{
-			//	my_parts[active_indices[j]]->deactivate("\t\tParticle was thermalized.\n\n");
-			//	active_parts--;
-			//	active_indices.erase(active_indices.begin() + j);
-			//	j--;
-			//}
-
-			if (my_parts[active_indices[j]]->get_total_v() < v_thermal)
+		int num_kept = 0;
+		for (int k=0; k<active_parts; k++)
+		{
+			int idx = active_indices[k];
+			final_fates[idx] = step_fates[k];
+			if (step_fates[k] == fate_active)
 			{
-				my_parts[active_indices[j]]->deactivate(to_string(i*dt) + "\t\tParticle was thermalized.\n\n");
-				active_parts--;
-				active_indices.erase(active_indices.begin() + j);
-				j--;
+				active_indices[num_kept] = idx;
+				num_kept++;
 			}
-			else if (my_parts[active_indices[j]]->get_radius() >= upper_bound && my_parts[active_indices[j]]->get_total_v() >= v_esc_upper)
+			else if (step_fates[k] == fate_escaped_day)
 			{
-				if (my_parts[active_indices[j]]->get_x() > 0.0)
+				day_escape_count++;
+				source_escape_count[my_parts[idx].get_source()]++;
+				if (response)
 				{
-					my_parts[active_indices[j]]->deactivate(to_string(i*dt) + "\t\tReached upper bound on day side with at least escape velocity.\n\n");
-					active_parts--;
-					day_escape_count++;
+					response->count_escape(first_id + idx, true);
 				}
-				else
+				if (recording_births)
 				{
-					my_parts[active_indices[j]]->deactivate(to_string(i*dt) + "\t\tReached upper bound on night side with at least escape velocity.\n\n");
-					active_parts--;
-					night_escape_count++;
+					birth_record.escapes_day[birth_groups[idx]]++;
 				}
-
-				active_indices.erase(active_indices.begin() + j);
-				j--;
 			}
-			else if (my_parts[active_indices[j]]->get_radius() <= lower_bound)
+			else if (step_fates[k] == fate_escaped_night)
 			{
-				my_parts[active_indices[j]]->deactivate(to_string(i*dt) + "\t\tDropped below lower bound.\n\n");
-				active_parts--;
-				active_indices.erase(active_indices.begin() + j);
-				j--;
+				night_escape_count++;
+				source_escape_count[my_parts[idx].get_source()]++;
+				if (response)
+				{
+					response->count_escape(first_id + idx, false);
+				}
+				if (recording_births)
+				{
+					birth_record.escapes_night[birth_groups[idx]]++;
+				}
 			}
 		}
+		active_parts = num_kept;
 	}
 
+	stop_workers();
+	merge_shards();
+
 	if (num_traced > 0)
 	{
 		output_collision_data();
 	}
 
-	output_stats(dt, (global_rate / 2.0), num_parts, output_stats_dir);
+	// (the MLMC driver reads the tallies directly and passes no stats directory)
+	if (options.output_stats_dir != "")
+	{
+		output_stats(dt, (global_rate / 2.0), num_parts, options.output_stats_dir);
+	}
+	if (response)
+	{
+		response->output_table(first_id, num_parts, options.output_stats_dir + "escape_response.csv");
+	}
+	if (recording_births)
+	{
+		birth_record.write(options.output_stats_dir + "birth_record.bin");
+	}
 
-	cout << "Number of collisions: " << bg_species.get_num_collisions() << endl;
+	cout << "Number of collisions: " << num_collisions << endl;
 	cout << "Active particles remaining: " << active_parts << endl;
 	cout << "Number of day side escaped particles: " << day_escape_count << endl;
 	cout << "Number of night side escaped particles: " << night_escape_count << endl;
@@ -402,108 +602,1076 @@ void Atmosphere::run_simulation(double dt, int num_steps, double lower_bound, do
 	cout << "Night side fraction of escaped particles: " << (double)night_escape_count / (double)(num_parts) << endl;
 	cout << "Global production rate: " << global_rate << endl;
 	cout << "Total loss rate: " << ((double)day_escape_count / (double)(num_parts) + (double)night_escape_count / (double)(num_parts)) * (global_rate / 2.0) << endl;
+	if (substep_tau > 0.0)
+	{
+		cout << "Adaptive substeps taken: " << num_substeps_taken << endl;
+	}
+	if (checking_energy && num_checked_steps > 0)
+	{
+		cout << "Energy error per step (relative to kinetic energy): mean " << step_error_sum / (double)num_checked_steps << "\tmax " << step_error_max << endl;
+		cout << "Largest energy drift over a free flight (relative to kinetic energy): " << flight_drift_max << endl;
+	}
+	if (parallel_mode != parallel_serial && num_parallel_steps > 0)
+	{
+		cout << "Parallel transport: " << shards.size() << " workers, partitioned by " << ((parallel_mode == parallel_shells) ? "altitude shell" : "particle") << endl;
+		cout << "Particle steps per worker:";
+		for (const Transport_Shard &w : shards)
+		{
+			cout << " " << w.num_transported;
+		}
+		cout << endl;
+		cout << "Load imbalance (largest worker share / mean share, averaged over steps): " << imbalance_sum / (double)num_parallel_steps << endl;
+		cout << "Particles changing worker per step: " << (double)num_migrations / (double)num_parallel_steps << endl;
+		if (parallel_mode == parallel_shells)
+		{
+			cout << "Shell re-balances: " << num_rebalances << endl;
+		}
+	}
+
+	// every particle stands for the same share of the global rate, so the source loss rates add up to the total
+	if (num_sources > 1)
+	{
+		vector<int> source_count(num_sources, 0);
+		for (int j=0; j<num_parts; j++)
+		{
+			source_count[my_parts[j].get_source()]++;
+		}
+		for (int k=0; k<num_sources; k++)
+		{
+			cout << "Source " << my_dist->get_source_name(k) << ": particles spawned: " << source_count[k];
+			cout << "\tescaped: " << source_escape_count[k];
+			cout << "\tproduction rate: " << my_dist->get_source_rate(k);
+			cout << "\tloss rate: " << (double)source_escape_count[k] / (double)(num_parts) * (global_rate / 2.0) << endl;
+		}
+	}
 }
 
-void Atmosphere::update_stats(double dt, int i)
+void Atmosphere::set_coupled_collisions(bool on)
 {
-	double x = my_parts[i]->get_x();
-	double y = my_parts[i]->get_y();
-	double z = my_parts[i]->get_z();
-	int x_index = 0;
-	//int y_index = 0;
-	int z_index = 0;
-	int r_xz_index = 0;
-	//int r_xy_index = 0;
-	int r_3d_index = 0;
-	double e = 0.0;
-	int e_index = 0;
-	//double inverse_v_r = 0.0;
-	double cos_theta = 0.0;
-	int cos_index = 0;
+	coupled_collisions = on;
+	coupled_clock.assign(on ? num_parts : 0, 0.0);
+	coupled_events.assign(on ? num_parts : 0, 0);
+}
 
-	//inverse_v_r = abs(dt / (my_parts[i]->get_radius() - my_parts[i]->get_previous_radius()));
-	r_3d_index = (int)(1e-5*(my_parts[i]->get_radius()-my_planet.get_radius()));
+Particle_Fate Atmosphere::get_fate(int i) const
+{
+	return final_fates[i];
+}
 
-	if (r_3d_index >= 0 && r_3d_index <= 100000)
+// same normalization as output_tally
+vector<double> Atmosphere::get_density_profile(int side, double dt, double rate) const
+{
+	const vector<double> &counts = stats[0].dens_counts[side];
+	vector<double> dens(counts.size());
+	for (unsigned i=0; i<counts.size(); i++)
 	{
-		if (x > 0.0)  // increment dayside density count
+		double r_in_cm = my_planet.get_radius() + 1e5*(double)i;
+		double volume = 2.0*constants::pi/3.0 * (pow(r_in_cm+1e5, 3.0) - pow(r_in_cm, 3.0));
+		dens[i] = (dt*rate/(double)num_parts*counts[i]) / volume;
+	}
+	return dens;
+}
+
+// stable counting sort of indices[0..n) by 1-km altitude bin
+void Atmosphere::sort_by_altitude(vector<int> &indices, int n)
+{
+	int num_bins = min((int)(1e-5*(r_upper - my_planet.get_radius())) + 2, 100001);
+	sort_offsets.assign(num_bins + 1, 0);
+	sort_bins.resize(n);
+	sort_scratch.resize(n);
+	for (int k=0; k<n; k++)
+	{
+		int bin = (int)(1e-5*(my_parts[indices[k]].get_radius() - my_planet.get_radius()));
+		bin = min(max(bin, 0), num_bins-1);
+		sort_bins[k] = bin;
+		sort_offsets[bin+1]++;
+	}
+	for (int b=0; b<num_bins; b++)
+	{
+		sort_offsets[b+1] = sort_offsets[b+1] + sort_offsets[b];
+	}
+	for (int k=0; k<n; k++)
+	{
+		sort_scratch[sort_offsets[sort_bins[k]]++] = indices[k];
+	}
+	copy(sort_scratch.begin(), sort_scratch.end(), indices.begin());
+}
+
+void Atmosphere::init_shards(int num_workers)
+{
+	stop_workers();
+	shards.clear();
+	shards.resize(num_workers);
+	for (int w=0; w<num_workers; w++)
+	{
+		Transport_Shard &shard = shards[w];
+		shard.bg = &bg_species;
+		shard.stats = &stats;
+		shard.births = &birth_record;
+		shard.members.clear();
+		shard.outbox[0].assign(num_workers, vector<int>());
+		shard.outbox[1].assign(num_workers, vector<int>());
+		shard.num_collisions = 0;
+		shard.num_substeps_taken = 0;
+		shard.step_error_sum = 0.0;
+		shard.step_error_max = 0.0;
+		shard.flight_drift_max = 0.0;
+		shard.num_checked_steps = 0;
+		shard.num_transported = 0;
+		shard.num_migrations = 0;
+		shard.num_kept = 0;
+	}
+	worker_bounds.assign(num_workers + 1, 0);
+	shell_edges.assign(num_workers + 1, 0);
+	last_rebalance = 0;
+	num_rebalances = 0;
+	last_worker.assign(num_parts, -1);
+	if (parallel_mode == parallel_serial)
+	{
+		return;
+	}
+
+	numa::print_report(num_workers);
+
+	// replicate the atmosphere tables on each node that runs workers (on one node, they are simply shared)
+	bool replicate = numa::pinning() && numa::get_num_nodes() > 1;
+	node_species.assign(numa::get_num_nodes(), Background_Species());
+	vector<bool> node_done(numa::get_num_nodes(), false);
+	vector<thread> builders;
+	for (int w=0; w<num_workers && replicate; w++)
+	{
+		int node = numa::get_worker_node(w);
+		if (!node_done[node])
 		{
-			stats_dens_counts[0][r_3d_index] += 1;
+			node_done[node] = true;
+			builders.push_back(thread([this, w, node]()
+			{
+				numa::pin_thread(w);
+				node_species[node] = Background_Species(bg_species.get_database()->replicate());
+			}));
 		}
-		else  // increment nightside density count
+	}
+	for (thread &t : builders)
+	{
+		t.join();
+	}
+
+	// start the workers; each sets up its shard on its own CPU and then waits for the first step
+	atomic<long> pages_moved(0);
+	step_barrier.init(num_workers + 1);
+	parallel_step.stop = false;
+	for (int w=0; w<num_workers; w++)
+	{
+		workers.push_back(thread(&Atmosphere::run_worker, this, w, replicate, ref(pages_moved)));
+	}
+	step_barrier.wait();
+
+	if (parallel_mode == parallel_shells)
+	{
+		cout << "Atmosphere tables: replicated by each worker\n";
+	}
+	if (numa::pinning())
+	{
+		cout << "Tallies allocated by each worker on its own CPU\n";
+		if (parallel_mode == parallel_particles)
 		{
-			stats_dens_counts[1][r_3d_index] += 1;
+			cout << "Atmosphere tables: " << (replicate ? "replicated on each node" : "shared (single node)") << "\n";
+			cout << "Particle pages moved to their worker's node: " << pages_moved << "\n";
 		}
 	}
+}
 
-	// update dayside integrated column density count for current altitude
-	r_xz_index = (int)(1e-5*(sqrt(x*x + z*z) - my_planet.get_radius()));
-	if ((x >= 0.0) && (r_xz_index >= 0) && (r_xz_index <= 100000)) //&& (abs(my_parts[i]->get_y()) <= 500e5))
+// from may be a sparse shard's row or profile, shorter than into or empty
+static void add_counts(vector<double> &into, const vector<double> &from)
+{
+	for (unsigned i=0; i<from.size(); i++)
 	{
-		stats_coldens_counts[r_xz_index] += 1;
+		into[i] = into[i] + from[i];
 	}
+}
 
-	x_index = (int)(1e-5*x/100.0);
-	z_index = (int)(1e-5*z/100.0);
-	if ((abs(x_index) <= 512) && ((abs(z_index) <= 512)))
+void Atmosphere::merge_shards()
+{
+	for (unsigned w=0; w<shards.size(); w++)
 	{
-		x_index = x_index + 512;
-		stats_dens2d_counts[z_index + 512][x_index] = stats_dens2d_counts[z_index + 512][x_index] + 1;
+		const Transport_Shard &shard = shards[w];
+		num_collisions += shard.num_collisions;
+		num_substeps_taken += shard.num_substeps_taken;
+		step_error_sum += shard.step_error_sum;
+		step_error_max = max(step_error_max, shard.step_error_max);
+		flight_drift_max = max(flight_drift_max, shard.flight_drift_max);
+		num_checked_steps += shard.num_checked_steps;
+		num_migrations += shard.num_migrations;
+		if (shard.stats == &stats)
+		{
+			continue;
+		}
+
+		for (unsigned k=0; k<stats.size(); k++)
+		{
+			Stats_Tally &t = stats[k];
+			const Stats_Tally &from = shard.own_stats[k];
+			add_counts(t.dens_counts[0], from.dens_counts[0]);
+			add_counts(t.dens_counts[1], from.dens_counts[1]);
+			add_counts(t.coldens_counts, from.coldens_counts);
+			add_counts(t.angleavg_dens, from.angleavg_dens);
+			add_counts(t.loss_rates, from.loss_rates);
+			for (unsigned i=0; i<t.dens2d_counts.size(); i++)
+			{
+				add_counts(t.dens2d_counts[i], from.dens2d_counts[i]);
+			}
+			for (int side=0; side<2; side++)
+			{
+				for (unsigned j=0; j<t.EDFs[side].size(); j++)
+				{
+					for (unsigned e=0; e<t.EDFs[side][j].size(); e++)
+					{
+						add_counts(t.EDFs[side][j][e], from.EDFs[side][j][e]);
+					}
+				}
+			}
+		}
+		for (int k=0; k<3 && recording_births; k++)
+		{
+			vector<double> &counts = (k == 0) ? birth_record.dens_day : (k == 1) ? birth_record.dens_night : birth_record.coldens_day;
+			for (unsigned g=0; g<shard.own_births[k].size(); g++)
+			{
+				const vector<double> &row = shard.own_births[k][g];
+				for (unsigned bin=0; bin<row.size(); bin++)
+				{
+					counts[(size_t)g*birth_record.num_alt_bins + bin] += row[bin];
+				}
+			}
+		}
 	}
+}
 
-	for (int j=0; j<stats_num_EDFs; j++)
+void Step_Barrier::init(int threads)
+{
+	num_threads = threads;
+	num_waiting = 0;
+	round = 0;
+}
+
+void Step_Barrier::wait()
+{
+	unique_lock<mutex> guard(lock);
+	long long my_round = round;
+	num_waiting++;
+	if (num_waiting == num_threads)
 	{
-		if (r_3d_index == stats_EDF_alts[j])
+		num_waiting = 0;
+		round++;
+		released.notify_all();
+	}
+	else
+	{
+		released.wait(guard, [this, my_round]() { return round != my_round; });
+	}
+}
+
+// the worker is pinned once, sets up its shard (tallies are allocated as it bins into them, so on its own CPU), and
+// then transports its range of every step; it reseeds its generator with a stream for its (step, worker) pair, so a
+// run is reproducible for a given number of workers
+void Atmosphere::run_worker(int w, bool replicate, atomic<long> &pages_moved)
+{
+	numa::pin_thread(w);
+	Transport_Shard &shard = shards[w];
+	shard.own_stats.resize(stats.size());
+	for (Stats_Tally &t : shard.own_stats)
+	{
+		init_tally(t, true);
+	}
+	for (int k=0; k<3 && recording_births; k++)
+	{
+		shard.own_births[k].assign(birth_record.num_groups, vector<double>());
+	}
+	shard.stats = &shard.own_stats;
+	shard.births = NULL;
+	if (parallel_mode == parallel_shells)
+	{
+		shard.own_bg = Background_Species(bg_species.get_database()->replicate());
+		shard.bg = &shard.own_bg;
+	}
+	else if (replicate)
+	{
+		shard.bg = &node_species[numa::get_worker_node(w)];
+	}
+
+	// the worker's first share of the particles (particles mode only: altitude shells do not map to index ranges)
+	if (numa::pinning() && parallel_mode == parallel_particles)
+	{
+		int num_workers = shards.size();
+		int begin = (int)((long long)w*num_parts/num_workers);
+		int end = (int)((long long)(w+1)*num_parts/num_workers);
+		pages_moved += numa::move_to_node(&my_parts[begin], (end - begin)*sizeof(Particle), numa::get_worker_node(w));
+	}
+	step_barrier.wait();
+
+	while (true)
+	{
+		step_barrier.wait();
+		if (parallel_step.stop)
 		{
-			e = my_parts[i]->get_energy_in_eV();
-			e_index = (int)(20.0*e);
+			return;
+		}
 
-			cos_theta = my_parts[i]->get_cos_theta();
-			cos_index = (int)(100.0*abs(cos_theta));
+		const Parallel_Step &p = parallel_step;
+		int begin = worker_bounds[w];
+		int end = worker_bounds[w+1];
+		common::set_transport_stream(p.step, w);
 
-			if (cos_theta > 0.0)
+		// shells mode: take over the particles that crossed into this worker's shells on the previous step (each
+		// outbox is only written by its worker on odd or even steps and only emptied by its receiver on the others)
+		int parity = p.step % 2;
+		if (parallel_mode == parallel_shells)
+		{
+			for (Transport_Shard &from : shards)
 			{
-				cos_index += 100;
+				vector<int> &in = from.outbox[1 - parity][w];
+				shard.members.insert(shard.members.end(), in.begin(), in.end());
+				in.clear();
+			}
+			copy(shard.members.begin(), shard.members.end(), &p.indices[begin]);
+		}
+		for (int k=begin; k<end; k++)
+		{
+			int idx = p.indices[k];
+			if (last_worker[idx] >= 0 && last_worker[idx] != w)
+			{
+				shard.num_migrations++;
+			}
+			last_worker[idx] = w;
+		}
+		for (int b=begin; b<end; b+=transport_block_size)
+		{
+			int m = min(transport_block_size, end - b);
+			if (substep_tau > 0.0)
+			{
+				transport_block_adaptive(shard, &p.indices[b], m, p.dt, p.step*p.dt, p.tally, &p.fates[b]);
 			}
 			else
 			{
-				cos_index = abs(cos_index - 100);
+				transport_block(shard, &p.indices[b], m, p.dt, p.step*p.dt, p.tally, &p.fates[b]);
 			}
+		}
+		shard.num_transported += end - begin;
+		shard.num_kept = count(&p.fates[begin], &p.fates[end], fate_active);
 
-			double radial_v = abs((my_parts[i]->get_radius() - my_parts[i]->get_previous_radius()) / dt);
-			if ((e_index >= 0 && e_index <= 200) && (cos_index >= 0 && cos_index <= 200))
+		// shells mode: keep the survivors still in this worker's shells and hand the others over
+		if (parallel_mode == parallel_shells)
+		{
+			shard.members.clear();
+			for (int k=begin; k<end; k++)
 			{
-				if (x > 0.0)
+				if (p.fates[k] != fate_active)
+				{
+					continue;
+				}
+				int idx = p.indices[k];
+				int owner = get_shell_owner(idx);
+				if (owner == w)
 				{
-					stats_EDFs[0][j][e_index][cos_index] += 1;
+					shard.members.push_back(idx);
 				}
 				else
 				{
-					stats_EDFs[1][j][e_index][cos_index] += 1;
+					shard.outbox[parity][owner].push_back(idx);
 				}
 			}
-			stats_loss_rates[j] = stats_loss_rates[j] + radial_v;
 		}
+		step_barrier.wait();
 	}
-	
-	// for bg angle-averaged density calculation in constant x plane (limb observation)
-	for (int j=0; j<stats_num_EDFs; j++)
-	  {
-	    if ((int)(1e-5*(x-my_planet.get_radius())) == stats_EDF_alts[j]) // if particle in the slab where x = the chosen altitude (towards the Sun)
-	      {
-		if (sqrt(pow(y,2) + pow(z,2)) <= 1e5/2)
-	      {
-		stats_angleavg_dens[j] += 1;
-		  }
-		else if (sqrt(pow(y,2) + pow(z,2)) > 1e5/2)
-		{
-		  stats_angleavg_dens[j] += (2/constants::pi)*asin(1e5/(2*sqrt(pow(y,2) + pow(z,2))));
-		}
-		}
-	  }
 }
 
-void Atmosphere::output_stats(double dt, double rate, int total_parts, string output_dir)
+void Atmosphere::stop_workers()
+{
+	if (workers.empty())
+	{
+		return;
+	}
+	parallel_step.stop = true;
+	step_barrier.wait();
+	for (thread &t : workers)
+	{
+		t.join();
+	}
+	workers.clear();
+}
+
+// in particles mode, indices[0..n) is split into equal ranges; in shells mode, each worker's range is sized to hold its
+// members and the particles handed over to it, and the workers write them into indices themselves
+void Atmosphere::transport_step_parallel(vector<int> &indices, int n, double dt, int step, bool tally, Particle_Fate fates[])
+{
+	int num_workers = shards.size();
+	worker_bounds[0] = 0;
+	worker_bounds[num_workers] = n;
+	if (parallel_mode == parallel_shells)
+	{
+		int parity = step % 2;
+		int largest = 0;
+		for (int w=0; w<num_workers; w++)
+		{
+			int size = shards[w].members.size();
+			for (const Transport_Shard &from : shards)
+			{
+				size += from.outbox[1 - parity][w].size();
+			}
+			worker_bounds[w+1] = worker_bounds[w] + size;
+			largest = max(largest, size);
+		}
+		bool drifted = (n > 0 && (double)largest*num_workers/(double)n > shell_rebalance_imbalance && step - last_rebalance >= shell_rebalance_interval);
+		if (step == 0 || (sort_freq > 0 && step % sort_freq == 0) || drifted)
+		{
+			rebalance_shells(indices, n, step);
+		}
+	}
+	else
+	{
+		for (int w=1; w<num_workers; w++)
+		{
+			worker_bounds[w] = (int)((long long)w*n/num_workers);
+		}
+	}
+
+	int largest = 0;
+	for (int w=0; w<num_workers; w++)
+	{
+		largest = max(largest, worker_bounds[w+1] - worker_bounds[w]);
+	}
+	if (n > 0)
+	{
+		imbalance_sum += (double)largest*num_workers/(double)n;
+		num_parallel_steps++;
+	}
+
+	parallel_step.indices = indices.data();
+	parallel_step.fates = fates;
+	parallel_step.dt = dt;
+	parallel_step.step = step;
+	parallel_step.tally = tally;
+	step_barrier.wait();  // start of step
+	step_barrier.wait();  // all workers done
+}
+
+// after the sort, sort_offsets[b] is the end of altitude bin b in indices; each worker's shells end with the first bin
+// that ends at or past its equal share, and its members are its part of the sorted list (the particles still waiting
+// to be handed over are in that list too, so the outboxes are emptied)
+void Atmosphere::rebalance_shells(vector<int> &indices, int n, int step)
+{
+	int num_workers = shards.size();
+	sort_by_altitude(indices, n);
+	worker_bounds[0] = 0;
+	worker_bounds[num_workers] = n;
+	int bin = 0;
+	for (int w=1; w<num_workers; w++)
+	{
+		long long share = (long long)w*n/num_workers;
+		while (sort_offsets[bin] < share)
+		{
+			bin++;
+		}
+		worker_bounds[w] = sort_offsets[bin];
+		shell_edges[w] = bin + 1;
+	}
+	shell_edges[num_workers] = sort_offsets.size() - 1;
+	for (int w=0; w<num_workers; w++)
+	{
+		Transport_Shard &shard = shards[w];
+		shard.members.assign(indices.begin() + worker_bounds[w], indices.begin() + worker_bounds[w+1]);
+		for (int parity=0; parity<2; parity++)
+		{
+			for (vector<int> &out : shard.outbox[parity])
+			{
+				out.clear();
+			}
+		}
+	}
+	last_rebalance = step;
+	num_rebalances++;
+}
+
+// the first and last worker also own the particles below and above the binned altitudes
+int Atmosphere::get_shell_owner(int idx) const
+{
+	int bin = (int)(1e-5*(my_parts[idx].get_radius() - my_planet.get_radius()));
+	int num_workers = shards.size();
+	return upper_bound(shell_edges.begin() + 1, shell_edges.begin() + num_workers, bin) - (shell_edges.begin() + 1);
+}
+
+// fills derived per-step quantities for particle idx from its current state
+void Atmosphere::get_step_state(int idx, Step_State &s)
+{
+	s.r = my_parts[idx].get_radius();
+	s.inv_r = my_parts[idx].get_inverse_radius();
+	s.v = my_parts[idx].get_total_v();
+	s.v_esc = sqrt(two_GM * s.inv_r);
+	s.alt_bin = (int)(1e-5*(s.r - my_planet.get_radius()));
+}
+
+// fused transport kernel: timestep, collision check, deactivation check, and stats binning for a block of particles
+// collisions for the whole block are checked and applied in one batch; speed, radius, escape speed, and altitude bin
+// are computed once per particle and shared by all stages
+void Atmosphere::transport_block(Transport_Shard &w, const int indices[], int n, double dt, double time, bool tally, Particle_Fate fates[])
+{
+	Step_State states[transport_block_size];
+	advance_block(w, indices, n, dt, time, tally && track_length, 1.0, fates, states);
+
+	for (int k=0; k<n; k++)
+	{
+		if (fates[k] == fate_active && tally)
+		{
+			states[k].alt_bin = (int)(1e-5*(states[k].r - my_planet.get_radius()));
+			update_stats(w, dt, indices[k], states[k]);
+		}
+	}
+}
+
+// adaptive version of transport_block: each particle covers the timestep dt in 2^level substeps, with level chosen
+// from its estimated collision rate (so that the collision optical depth of a substep stays below substep_tau) and
+// its orbital time scale; particles of the same level are advanced together, and all of them end up at the end of
+// the timestep, where the point tallies are taken as usual
+void Atmosphere::transport_block_adaptive(Transport_Shard &w, const int indices[], int n, double dt, double time, bool tally, Particle_Fate fates[])
+{
+	w.block_parts.resize(n);
+	for (int k=0; k<n; k++)
+	{
+		const Particle &p = my_parts[indices[k]];
+		w.block_parts.species[k] = p.get_species();
+		w.block_parts.x[k] = p.get_x();
+		w.block_parts.y[k] = p.get_y();
+		w.block_parts.z[k] = p.get_z();
+		w.block_parts.vx[k] = p.get_vx();
+		w.block_parts.vy[k] = p.get_vy();
+		w.block_parts.vz[k] = p.get_vz();
+	}
+	double rates[transport_block_size];
+	w.bg->estimate_collision_rates(w.block_parts, rates);
+
+	int levels[transport_block_size];
+	int top_level = 0;
+	for (int k=0; k<n; k++)
+	{
+		double r = my_parts[indices[k]].get_radius();
+		double orbit_time = sqrt(r*r*r/(-k_g));
+		double num_substeps = max(rates[k]*dt/substep_tau, dt/(substep_orbit_fraction*orbit_time));
+		int level = 0;
+		while (level < max_substep_level && (double)(1 << level) < num_substeps)
+		{
+			level++;
+		}
+		levels[k] = level;
+		top_level = max(top_level, level);
+		w.num_substeps_taken += 1 << level;
+	}
+
+	int live[transport_block_size];      // particles of the current level still active
+	int live_pos[transport_block_size];  // their positions in indices
+	Particle_Fate sub_fates[transport_block_size];
+	Step_State sub_states[transport_block_size];
+	Step_State states[transport_block_size];
+	for (int level=0; level<=top_level; level++)
+	{
+		int m = 0;
+		for (int k=0; k<n; k++)
+		{
+			if (levels[k] == level)
+			{
+				live[m] = indices[k];
+				live_pos[m] = k;
+				m++;
+			}
+		}
+
+		double h = dt / (double)(1 << level);
+		for (int sub=0; sub<(1 << level) && m > 0; sub++)
+		{
+			advance_block(w, live, m, h, time + sub*h, tally && track_length, h/dt, sub_fates, sub_states);
+			int num_kept = 0;
+			for (int j=0; j<m; j++)
+			{
+				fates[live_pos[j]] = sub_fates[j];
+				states[live_pos[j]] = sub_states[j];
+				if (sub_fates[j] == fate_active)
+				{
+					live[num_kept] = live[j];
+					live_pos[num_kept] = live_pos[j];
+					num_kept++;
+				}
+			}
+			m = num_kept;
+		}
+
+		// the survivors are at the end of the timestep (the radial speed for EDF loss rates uses the last substep)
+		for (int j=0; j<m && tally; j++)
+		{
+			Step_State &st = states[live_pos[j]];
+			st.alt_bin = (int)(1e-5*(st.r - my_planet.get_radius()));
+			update_stats(w, h, live[j], st);
+		}
+	}
+}
+
+// advance n particles (indices) by one step of length h starting at the given time: timestep, batched collision check,
+// and deactivation check, writing each particle's fate and new state; if tally_paths is set, each step's path is
+// added to the track-length tallies with weight path_weight (the step's length in units of the tally timestep)
+void Atmosphere::advance_block(Transport_Shard &w, const int indices[], int n, double h, double time, bool tally_paths, double path_weight, Particle_Fate fates[], Step_State states[])
+{
+	// advance each particle and gather its new state for the batched collision check
+	double x0[transport_block_size], y0[transport_block_size], z0[transport_block_size];
+	w.block_parts.resize(n);
+	for (int k=0; k<n; k++)
+	{
+		Particle &p = my_parts[indices[k]];
+		x0[k] = p.get_x();
+		y0[k] = p.get_y();
+		z0[k] = p.get_z();
+		if (checking_energy)
+		{
+			double e_before = p.get_specific_energy(k_g);
+			p.do_timestep(h, k_g, integrator);
+			double e_after = p.get_specific_energy(k_g);
+			double kinetic = 0.5*p.get_total_v()*p.get_total_v();
+			double step_error = abs(e_after - e_before)/kinetic;
+			w.step_error_sum += step_error;
+			w.step_error_max = max(w.step_error_max, step_error);
+			w.flight_drift_max = max(w.flight_drift_max, abs(e_after - flight_energy[indices[k]])/kinetic);
+			w.num_checked_steps++;
+		}
+		else
+		{
+			p.do_timestep(h, k_g, integrator);
+		}
+		w.block_parts.species[k] = p.get_species();
+		w.block_parts.x[k] = p.get_x();
+		w.block_parts.y[k] = p.get_y();
+		w.block_parts.z[k] = p.get_z();
+		w.block_parts.vx[k] = p.get_vx();
+		w.block_parts.vy[k] = p.get_vy();
+		w.block_parts.vz[k] = p.get_vz();
+	}
+
+	if (coupled_collisions)
+	{
+		w.block_clock.resize(n);
+		w.block_events.resize(n);
+		for (int k=0; k<n; k++)
+		{
+			w.block_parts.id[k] = first_id + indices[k];
+			w.block_clock[k] = coupled_clock[indices[k]];
+			w.block_events[k] = coupled_events[indices[k]];
+		}
+		w.bg->collide_coupled(w.block_parts, h, w.block_clock.data(), w.block_events.data(), w.block_results);
+		for (int k=0; k<n; k++)
+		{
+			coupled_clock[indices[k]] = w.block_clock[k];
+			coupled_events[indices[k]] = w.block_events[k];
+		}
+	}
+	else
+	{
+		w.bg->check_collisions(w.block_parts, h, w.block_results);
+		w.bg->apply_collisions(w.block_parts, w.block_results);
+	}
+	w.num_collisions += w.block_results.num_collided;
+
+	for (int k=0; k<n; k++)
+	{
+		int idx = indices[k];
+		Particle &p = my_parts[idx];
+		Step_State &s = states[k];
+		s.r = p.get_radius();
+		s.inv_r = p.get_inverse_radius();
+		s.v = w.block_results.speed[k];
+
+		if (w.block_results.collided[k])
+		{
+			p.init_particle_vonly(w.block_parts.vx[k], w.block_parts.vy[k], w.block_parts.vz[k]);
+			p.log_collision(w.bg->get_target_species(w.block_results.target[k]), w.block_results.theta[k], s.v, time, my_planet.get_radius());
+			s.v = p.get_total_v();
+			if (checking_energy)
+			{
+				flight_energy[idx] = p.get_specific_energy(k_g);
+			}
+		}
+
+		// the path taken during this step counts toward the track-length tallies whatever the particle's fate
+		if (tally_paths)
+		{
+			update_track_stats(w, idx, x0[k], y0[k], z0[k], p.get_x(), p.get_y(), p.get_z(), path_weight);
+		}
+
+		// thermalized threshold velocity is the escape velocity at current radius
+		// (v_mp, v_rms, or v_avg could be substituted here; see commented definitions in run_simulation)
+		s.v_esc = sqrt(two_GM * s.inv_r);
+
+		// deactivation criteria from Justin's original Hot O simulation code (must also uncomment v_Obg declaration in run_simulation to use)
+		//if (s.r < (my_planet.get_radius() + 900e5) && (s.v + v_Obg) < sqrt(two_GM*(s.inv_r-1.0/(my_planet.get_radius()+900e5))))
+		//{
+		//	p.deactivate(to_string(time) + "\t\tParticle was thermalized.\n\n");
+		//	fates[k] = fate_thermalized;
+		//	continue;
+		//}
+
+		if (s.v < s.v_esc)
+		{
+			p.deactivate(to_string(time) + "\t\tParticle was thermalized.\n\n");
+			fates[k] = fate_thermalized;
+		}
+		else if (s.r >= r_upper && s.v >= v_esc_upper)
+		{
+			if (p.get_x() > 0.0)
+			{
+				p.deactivate(to_string(time) + "\t\tReached upper bound on day side with at least escape velocity.\n\n");
+				fates[k] = fate_escaped_day;
+			}
+			else
+			{
+				p.deactivate(to_string(time) + "\t\tReached upper bound on night side with at least escape velocity.\n\n");
+				fates[k] = fate_escaped_night;
+			}
+		}
+		else if (s.r <= r_lower)
+		{
+			p.deactivate(to_string(time) + "\t\tDropped below lower bound.\n\n");
+			fates[k] = fate_lower_bound;
+		}
+		else
+		{
+			fates[k] = fate_active;
+		}
+	}
+}
+
+void Atmosphere::update_stats(Transport_Shard &w, double dt, int i, const Step_State &s)
+{
+	update_tally((*w.stats)[0], dt, i, s);
+	if (stats.size() > 1)
+	{
+		update_tally((*w.stats)[1 + my_parts[i].get_source()], dt, i, s);
+	}
+	if (recording_births && !track_length)
+	{
+		update_birth_record(w, i, s);
+	}
+}
+
+// scratch list of bin boundary crossings along a step's path
+static thread_local vector<double> track_breaks;
+
+// adds the roots s in (0, 1) of |P0 + s*D|^2 = R^2 (in two or three dimensions) to breaks, for every bin boundary
+// R = radius + k*1e5 between the smallest and largest distance from the origin reached along the segment;
+// r0 is |P0|, a is |D|^2, b is P0.D, and r1 is |P0 + D|
+static void add_shell_crossings(vector<double> &breaks, double radius, double r0, double r1, double a, double b)
+{
+	double s_min = min(max(-b/a, 0.0), 1.0);
+	double r_min = sqrt(max(r0*r0 + s_min*(2.0*b + s_min*a), 0.0));
+	double r_max = max(r0, r1);
+	for (int k=(int)floor(1e-5*(r_min - radius)) + 1; radius + k*1e5 <= r_max; k++)
+	{
+		double R = radius + k*1e5;
+		double disc = b*b - a*(r0 - R)*(r0 + R);
+		if (disc < 0.0)
+		{
+			continue;
+		}
+		disc = sqrt(disc);
+		double roots[2] = {(-b - disc)/a, (-b + disc)/a};
+		for (double root : roots)
+		{
+			if (root > 0.0 && root < 1.0)
+			{
+				breaks.push_back(root);
+			}
+		}
+	}
+}
+
+// adds the fractions s in (0, 1) at which u0 + s*du crosses a multiple of width to breaks
+static void add_plane_crossings(vector<double> &breaks, double u0, double du, double width)
+{
+	if (du == 0.0)
+	{
+		return;
+	}
+	double u1 = u0 + du;
+	for (double m=floor(min(u0, u1)/width) + 1.0; m*width < max(u0, u1); m++)
+	{
+		breaks.push_back((m*width - u0)/du);
+	}
+}
+
+// the path within a step is taken to be straight; each piece between consecutive bin boundaries lies within a
+// single bin of every tally, which is found from its midpoint
+void Atmosphere::update_track_stats(Transport_Shard &w, int idx, double x0, double y0, double z0, double x1, double y1, double z1, double weight)
+{
+	vector<double> &breaks = track_breaks;
+	double dx = x1 - x0;
+	double dy = y1 - y0;
+	double dz = z1 - z0;
+	double radius = my_planet.get_radius();
+
+	breaks.clear();
+	breaks.push_back(0.0);
+	double a = dx*dx + dy*dy + dz*dz;
+	if (a > 0.0)
+	{
+		add_shell_crossings(breaks, radius, sqrt(x0*x0 + y0*y0 + z0*z0), sqrt(x1*x1 + y1*y1 + z1*z1), a, x0*dx + y0*dy + z0*dz);
+	}
+	double a_xz = dx*dx + dz*dz;
+	if (a_xz > 0.0)
+	{
+		add_shell_crossings(breaks, radius, sqrt(x0*x0 + z0*z0), sqrt(x1*x1 + z1*z1), a_xz, x0*dx + z0*dz);
+	}
+	add_plane_crossings(breaks, x0, dx, 100e5);  // image pixel edges; x = 0 also splits day from night
+	add_plane_crossings(breaks, z0, dz, 100e5);
+	breaks.push_back(1.0);
+	sort(breaks.begin(), breaks.end());
+
+	int source_tally = (stats.size() > 1) ? 1 + my_parts[idx].get_source() : 0;
+	for (unsigned j=1; j<breaks.size(); j++)
+	{
+		double piece = breaks[j] - breaks[j-1];
+		if (piece <= 0.0)
+		{
+			continue;
+		}
+		piece = piece*weight;
+		double s = 0.5*(breaks[j-1] + breaks[j]);
+		double x = x0 + s*dx;
+		double y = y0 + s*dy;
+		double z = z0 + s*dz;
+		int alt_bin = (int)(1e-5*(sqrt(x*x + y*y + z*z) - radius));
+		bin_position((*w.stats)[0], alt_bin, x, z, piece);
+		if (source_tally > 0)
+		{
+			bin_position((*w.stats)[source_tally], alt_bin, x, z, piece);
+		}
+		if (recording_births)
+		{
+			bin_birth_position(w, idx, alt_bin, x, z, piece);
+		}
+	}
+}
+
+// birth groups span the birth altitudes of the particles; output altitude bins reach the upper boundary
+void Atmosphere::init_birth_record(double dt, double upper_bound, double global_rate)
+{
+	int lowest = 100000;
+	int highest = 0;
+	for (int i=0; i<num_parts; i++)
+	{
+		int alt = (int)(1e-5*(my_parts[i].get_radius() - my_planet.get_radius()));
+		lowest = min(lowest, alt);
+		highest = max(highest, alt);
+	}
+	lowest = max(lowest, 0);
+	highest = max(highest, lowest);
+	int num_alt_bins = min((int)(1e-5*upper_bound) + 1, 100001);
+	birth_record.init(num_parts, lowest, highest - lowest + 1, num_alt_bins, dt, my_planet.get_radius(), global_rate);
+
+	birth_groups.resize(num_parts);
+	for (int i=0; i<num_parts; i++)
+	{
+		birth_groups[i] = birth_record.get_group(my_parts[i].get_radius() - my_planet.get_radius());
+		birth_record.births[birth_groups[i]]++;
+	}
+}
+
+void Atmosphere::update_birth_record(Transport_Shard &w, int i, const Step_State &s)
+{
+	bin_birth_position(w, i, s.alt_bin, my_parts[i].get_x(), my_parts[i].get_z(), 1.0);
+}
+
+// same binning as the density1d and column_density tallies in bin_position
+void Atmosphere::bin_birth_position(Transport_Shard &w, int i, int alt_bin, double x, double z, double weight)
+{
+	int g = birth_groups[i];
+	int num_alt_bins = birth_record.num_alt_bins;
+
+	if (alt_bin >= 0 && alt_bin < num_alt_bins)
+	{
+		if (x > 0.0)
+		{
+			birth_bin(w, 0, g, alt_bin) += weight;
+		}
+		else
+		{
+			birth_bin(w, 1, g, alt_bin) += weight;
+		}
+	}
+
+	int r_xz_index = (int)(1e-5*(sqrt(x*x + z*z) - my_planet.get_radius()));
+	if ((x >= 0.0) && (r_xz_index >= 0) && (r_xz_index < num_alt_bins))
+	{
+		birth_bin(w, 2, g, r_xz_index) += weight;
+	}
+}
+
+// a row of a sparse tally (see init_tally) is allocated the first time it is binned into
+static inline vector<double> &tally_row(vector<double> &row, int size)
+{
+	if (row.empty())
+	{
+		row.assign(size, 0.0);
+	}
+	return row;
+}
+
+// a profile of a sparse tally grows to the highest bin binned into
+static inline double &tally_bin(vector<double> &profile, int bin)
+{
+	if (bin >= (int)profile.size())
+	{
+		profile.resize(bin + 1, 0.0);
+	}
+	return profile[bin];
+}
+
+// the serial shard bins straight into birth_record; a parallel shard's rows are allocated like those of a sparse tally
+double &Atmosphere::birth_bin(Transport_Shard &w, int k, int g, int bin)
+{
+	if (w.births == NULL)
+	{
+		return tally_row(w.own_births[k][g], birth_record.num_alt_bins)[bin];
+	}
+	vector<double> &counts = (k == 0) ? w.births->dens_day : (k == 1) ? w.births->dens_night : w.births->coldens_day;
+	return counts[(size_t)g*w.births->num_alt_bins + bin];
+}
+
+void Atmosphere::update_tally(Stats_Tally &t, double dt, int i, const Step_State &s)
+{
+	Particle &p = my_parts[i];
+	double x = p.get_x();
+	double y = p.get_y();
+	double z = p.get_z();
+	int r_3d_index = s.alt_bin;
+	double e = 0.0;
+	int e_index = 0;
+	//double inverse_v_r = 0.0;
+	double cos_theta = 0.0;
+	int cos_index = 0;
+
+	//inverse_v_r = abs(dt / (s.r - p.get_previous_radius()));
+
+	// with the track-length estimator, these are binned from each step's path instead (see update_track_stats)
+	if (!track_length)
+	{
+		bin_position(t, r_3d_index, x, z, 1.0);
+	}
+
+	for (int j=0; j<stats_num_EDFs; j++)
+	{
+		if (r_3d_index == stats_EDF_alts[j])
+		{
+			e = 0.5*p.get_mass()*s.v*s.v/constants::ergev;
+			e_index = (int)(20.0*e);
+
+			// cosine of angle between particle trajectory and radial direction
+			cos_theta = ((p.get_vx()*x + p.get_vy()*y + p.get_vz()*z) / s.r) / s.v;
+			if (cos_theta > 1.0)
+			{
+				cos_theta = 1.0;
+			}
+			else if (cos_theta < -1.0)
+			{
+				cos_theta = -1.0;
+			}
+			cos_index = (int)(100.0*abs(cos_theta));
+
+			if (cos_theta > 0.0)
+			{
+				cos_index += 100;
+			}
+			else
+			{
+				cos_index = abs(cos_index - 100);
+			}
+
+			double radial_v = abs((s.r - p.get_previous_radius()) / dt);
+			if ((e_index >= 0 && e_index <= 200) && (cos_index >= 0 && cos_index <= 200))
+			{
+				if (x > 0.0)
+				{
+					tally_row(t.EDFs[0][j][e_index], 201)[cos_index] += 1;
+				}
+				else
+				{
+					tally_row(t.EDFs[1][j][e_index], 201)[cos_index] += 1;
+				}
+			}
+			t.loss_rates[j] = t.loss_rates[j] + radial_v;
+		}
+	}
+
+	// for bg angle-averaged density calculation in constant x plane (limb observation)
+	int x_alt_index = (int)(1e-5*(x-my_planet.get_radius()));
+	for (int j=0; j<stats_num_EDFs; j++)
+	{
+		if (x_alt_index == stats_EDF_alts[j]) // if particle in the slab where x = the chosen altitude (towards the Sun)
+		{
+			double r_yz = sqrt(y*y + z*z);
+			if (r_yz <= 1e5/2)
+			{
+				t.angleavg_dens[j] += 1;
+			}
+			else
+			{
+				t.angleavg_dens[j] += (2/constants::pi)*asin(1e5/(2*r_yz));
+			}
+		}
+	}
+}
+
+// add weight (in timesteps) to the density, column density, and image bins holding position (x, z) at altitude bin alt_bin
+void Atmosphere::bin_position(Stats_Tally &t, int alt_bin, double x, double z, double weight)
+{
+	int x_index = 0;
+	//int y_index = 0;
+	int z_index = 0;
+	int r_xz_index = 0;
+	//int r_xy_index = 0;
+
+	if (alt_bin >= 0 && alt_bin <= 100000)
+	{
+		if (x > 0.0)  // increment dayside density count
+		{
+			tally_bin(t.dens_counts[0], alt_bin) += weight;
+		}
+		else  // increment nightside density count
+		{
+			tally_bin(t.dens_counts[1], alt_bin) += weight;
+		}
+	}
+
+	// update dayside integrated column density count for current altitude
+	r_xz_index = (int)(1e-5*(sqrt(x*x + z*z) - my_planet.get_radius()));
+	if ((x >= 0.0) && (r_xz_index >= 0) && (r_xz_index <= 100000)) //&& (abs(y) <= 500e5))
+	{
+		tally_bin(t.coldens_counts, r_xz_index) += weight;
+	}
+
+	x_index = (int)(1e-5*x/100.0);
+	z_index = (int)(1e-5*z/100.0);
+	if ((abs(x_index) <= 512) && ((abs(z_index) <= 512)))
+	{
+		x_index = x_index + 512;
+		vector<double> &row = tally_row(t.dens2d_counts[z_index + 512], 1025);
+		row[x_index] = row[x_index] + weight;
+	}
+}
+
+// all particles represent the same production rate whatever their source, so per-source stats add up to the total
+void Atmosphere::output_stats(double dt, double rate, int total_parts, string output_dir)
+{
+	output_tally(stats[0], dt, rate, total_parts, output_dir);
+	for (unsigned k=1; k<stats.size(); k++)
+	{
+		output_tally(stats[k], dt, rate, total_parts, output_dir + my_dist->get_source_name(k-1) + "_");
+	}
+}
+
+void Atmosphere::output_tally(const Stats_Tally &t, double dt, double rate, int total_parts, string output_dir)
 {
 	double volume = 0.0;
 	double surface_upper = 0.0;
@@ -526,7 +1694,7 @@ void Atmosphere::output_stats(double dt, double rate, int total_parts, string ou
 	coldens_day_out << "#alt[km]\tcol density[cm-2]\n";
 	dens2d_out << "#this file contains a 1025 x 1025 grid of 2d integrated column densities for an observer viewing XZ plane from Y=infinity; each pixel represents a 100 square km area; density units are in particles per cm^2\n";
 
-	int size = stats_dens_counts[0].size();
+	int size = t.dens_counts[0].size();
 	for (int i=0; i<size; i++)
 	{
 		sum_day = 0.0;
@@ -534,8 +1702,8 @@ void Atmosphere::output_stats(double dt, double rate, int total_parts, string ou
 		r_in_cm = my_planet.get_radius() + 1e5*(double)i;
 		volume = 2.0*constants::pi/3.0 * (pow(r_in_cm+1e5, 3.0) - pow(r_in_cm, 3.0));
 
-		sum_day = (double)stats_dens_counts[0][i];
-		sum_night = (double)stats_dens_counts[1][i];
+		sum_day = (double)t.dens_counts[0][i];
+		sum_night = (double)t.dens_counts[1][i];
 
 		dens_day = (dt*rate/(double)total_parts*sum_day) / volume;
 	        dens_night = (dt*rate/(double)total_parts*sum_night) / volume;
@@ -551,7 +1719,7 @@ void Atmosphere::output_stats(double dt, double rate, int total_parts, string ou
 	{
 		r_in_cm = my_planet.get_radius() + 1e5*(double)i;
 		coldens_area = 0.5 * constants::pi * (pow(r_in_cm+1e5, 2.0) - pow(r_in_cm, 2.0));
-		coldens_day = (dt*rate/(double)total_parts*(double)stats_coldens_counts[i]) / coldens_area;
+		coldens_day = (dt*rate/(double)total_parts*(double)t.coldens_counts[i]) / coldens_area;
 		coldens_day_out << i << "\t\t" << coldens_day << "\n";
 	}
 	coldens_day_out.close();
@@ -561,7 +1729,7 @@ void Atmosphere::output_stats(double dt, double rate, int total_parts, string ou
 	{
 		for (int j=0; j<1025; j++)
 		{
-			dens2d_out << (dt*rate/(double)total_parts*(double)stats_dens2d_counts[i][j]) / 1.0e14 << "\t";
+			dens2d_out << (dt*rate/(double)total_parts*(double)t.dens2d_counts[i][j]) / 1.0e14 << "\t";
 		}
 		dens2d_out << "\n";
 	}
@@ -580,17 +1748,17 @@ void Atmosphere::output_stats(double dt, double rate, int total_parts, string ou
 		surface_upper = 2.0*constants::pi * (r_in_cm+1e5) * (r_in_cm+1e5);
 		volume = 2.0*constants::pi/3.0 * (pow(r_in_cm+1e5, 3.0) - pow(r_in_cm, 3.0));
 
-		angleavg_dens_out << stats_EDF_alts[i]  << "\t" << ( dt * rate * stats_angleavg_dens[i] ) /
+		angleavg_dens_out << stats_EDF_alts[i]  << "\t" << ( dt * rate * t.angleavg_dens[i] ) /
 		                                                   ((double)total_parts*1e5*1e5) << "\n";
 				
-		loss_rates_out << stats_EDF_alts[i] << "\t\t" << (stats_loss_rates[i] / volume) * (dt*rate/(double)total_parts) * surface_upper << "\n";
+		loss_rates_out << stats_EDF_alts[i] << "\t\t" << (t.loss_rates[i] / volume) * (dt*rate/(double)total_parts) * surface_upper << "\n";
 
 		for (int j=0; j<201; j++)
 		{
 			for (int k=0; k<201; k++)
 			{
-				EDF_day_out << ((dt*rate/(double)total_parts)*stats_EDFs[0][i][j][k]) / (volume*0.05*0.01) << "\t";
-				EDF_night_out << ((dt*rate/(double)total_parts)*stats_EDFs[1][i][j][k]) / (volume*0.05*0.01) << "\t";
+				EDF_day_out << ((dt*rate/(double)total_parts)*t.EDFs[0][i][j][k]) / (volume*0.05*0.01) << "\t";
+				EDF_night_out << ((dt*rate/(double)total_parts)*t.EDFs[1][i][j][k]) / (volume*0.05*0.01) << "\t";
 			}
 			EDF_day_out << "\n";
 			EDF_night_out << "\n";
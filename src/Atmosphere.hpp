@@ -10,49 +10,309 @@
 
 #include <vector>
 #include <iomanip>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "Background_Species.hpp"
 #include "Distribution_Hot_H.hpp"
 #include "Distribution_Hot_O.hpp"
 #include "Distribution_Import.hpp"
 #include "Distribution_MB.hpp"
+#include "Distribution_Response.hpp"
 #include "Common_Functions.hpp"
+#include "Birth_Record.hpp"
+#include "Numa_Topology.hpp"
 using namespace std;
 
+// fate of a particle after a single transport step
+enum Particle_Fate { fate_active, fate_thermalized, fate_escaped_day, fate_escaped_night, fate_lower_bound };
+
+// derived quantities of a particle's state, computed once per step and shared by
+// collision testing, deactivation checks, and stats binning
+struct Step_State {
+	double r;        // radius from center of planet [cm]
+	double inv_r;    // inverse radius [cm^-1]
+	double v;        // total speed [cm/s]
+	double v_esc;    // escape speed at current radius [cm/s]
+	int alt_bin;     // 1-km altitude bin above planet surface
+};
+
+// stats accumulated over a run, either for all particles or for the particles drawn from one production source
+// density, column density, and image counts are in timesteps spent in each bin (fractional with the track-length estimator)
+struct Stats_Tally {
+	vector<vector<double>> dens_counts;  // vector for accumulating particle density counts
+	vector<double> coldens_counts;  // vector for accumulating integrated dayside column density counts
+	vector<double> angleavg_dens;  // vector for accumulating angle-averaged column density counts in x=const. plane
+	vector<vector<double>> dens2d_counts;  // stores a 2d grid of dayside column density counts
+	vector<vector<vector<vector<double>>>> EDFs;  // EDF counts are accumulated here
+	vector<double> loss_rates;  // loss rates at each EDF altitude are calculated and stored here
+};
+
+// how the transport of active particles is spread over worker threads
+// parallel_serial: all particles on the calling thread
+// parallel_particles: each worker transports an equal contiguous share of the active particle list
+// parallel_shells: each worker owns a contiguous range of 1-km altitude shells and transports the particles in it; a
+// particle that ends a step in another worker's shells is handed over to that worker at the step barrier; the shell
+// edges are chosen to give every worker about an equal share of the particles at the first step, every sort_freq
+// steps, and whenever the shares drift apart (see shell_rebalance_imbalance)
+enum Parallel_Mode { parallel_serial, parallel_particles, parallel_shells };
+
+// parameters of Atmosphere::run_simulation, filled in from corona3d_2020.cfg by main (see there for their meaning)
+struct Run_Options {
+	double dt = 0.0;                      // timestep [s]
+	int num_steps = 0;
+	double lower_bound = 0.0;             // simulation boundaries [cm above surface]
+	double upper_bound = 0.0;
+	int print_status_freq = 0;            // print status every this many steps (0 = never)
+	int output_pos_freq = 0;              // write particle positions every this many steps (0 = never)
+	bool output_pos_binary = false;       // positions as binary snapshots instead of text
+	string output_pos_dir = "";
+	string output_stats_dir = "";         // "" writes no stats files (the tallies can still be read, e.g. by Mlmc_Driver)
+	bool record_births = false;           // also tally by birth altitude (Birth_Record)
+	bool track_length_stats = false;      // track-length instead of point estimator for density-type tallies
+	Integrator method = integrator_verlet;
+	bool check_energy = false;            // accumulate the energy drift diagnostic
+	double max_substep_tau = 0.0;         // adaptive substeps: largest collision optical depth of a substep (0 = fixed steps)
+	int max_substeps = 64;
+	int sort_freq = 0;                    // sort active particles by altitude (and re-balance shells) every this many steps
+	Parallel_Mode parallel = parallel_serial;
+};
+
+// reusable barrier for the parallel engine's persistent workers (and the thread driving them)
+struct Step_Barrier {
+	mutex lock;
+	condition_variable released;
+	int num_threads;      // threads taking part
+	int num_waiting;      // threads waiting in the current round
+	long long round;      // number of rounds completed
+
+	void init(int threads);
+
+	// block until all num_threads threads have called wait in this round
+	void wait();
+};
+
+// what the parallel engine's workers do in the current step (set by the driving thread between barriers)
+struct Parallel_Step {
+	int *indices;                 // active particle list; worker w transports [worker_bounds[w], worker_bounds[w+1])
+	Particle_Fate *fates;         // fates[k] is set to the fate of indices[k]
+	double dt;
+	int step;
+	bool tally;
+	bool stop;                    // set to make the workers exit
+};
+
+// per-worker state of the transport kernel: scratch space, tallies, and counters
+// in serial mode the single shard tallies straight into the Atmosphere's stats and birth record; in the parallel
+// engine every shard tallies into its own sparse copies of the stats (see Atmosphere::init_tally) and of the birth
+// record's rows, allocated by its worker as it first bins into them (so with pinned workers they sit in the worker's
+// NUMA node), which are added into the Atmosphere's at the end of the run
+struct Transport_Shard {
+	Particle_Store block_parts;         // SoA copy of the block of particles being transported
+	Collision_Results block_results;    // collision check results for block_parts
+	vector<double> block_clock;         // coupled collisions: coupled_clock and coupled_events of block_parts
+	vector<int> block_events;
+	const Background_Species *bg;       // background species (bg_species, a replica on the worker's NUMA node, or own_bg)
+	Background_Species own_bg;          // shells mode: the worker's own replica of the atmosphere tables
+	vector<Stats_Tally> *stats;         // tallies to update (Atmosphere::stats or own_stats)
+	Birth_Record *births;               // birth record to update (Atmosphere::birth_record), or NULL to use own_births
+	vector<Stats_Tally> own_stats;
+	vector<vector<double>> own_births[3];  // birth record dens_day, dens_night and coldens_day rows by birth group
+	vector<int> members;                // shells mode: particles in the worker's shells
+	vector<vector<int>> outbox[2];      // shells mode: [step parity][worker] particles that crossed into that worker's shells
+	int num_collisions;
+	long long num_substeps_taken;
+	double step_error_sum;
+	double step_error_max;
+	double flight_drift_max;
+	long long num_checked_steps;
+	long long num_transported;          // particle steps transported by this worker
+	long long num_migrations;           // particles this worker took over from another worker
+	int num_kept;                       // particles of the worker's range still active at the end of the step
+};
+
+// shells mode: the shell edges are re-balanced when the largest worker share exceeds the mean share by this factor,
+// at most once every shell_rebalance_interval steps (each re-balance sorts the whole active list on one thread)
+const double shell_rebalance_imbalance = 1.1;
+const int shell_rebalance_interval = 20;
+
+// number of active particles advanced together through the transport kernel
+const int transport_block_size = 256;
+
+// with adaptive substeps, a substep is also kept below this fraction of the particle's orbital time scale sqrt(r^3/GM)
+const double substep_orbit_fraction = 1e-3;
+
+// number of particles initialized together (with one random number stream) at startup
+const int init_chunk_size = 4096;
+
 class Atmosphere {
 public:
-	Atmosphere(int n, int num_to_trace, string trace_output_dir, Planet p, vector<shared_ptr<Particle>> parts, shared_ptr<Distribution> dist, Background_Species bg, int num_EDFs, int EDF_alts[]);
+	Atmosphere(int n, int num_to_trace, string trace_output_dir, Planet p, const vector<Particle> &parts, shared_ptr<Distribution> dist, const Background_Species &bg, int num_EDFs, int EDF_alts[], int threads, int first_id = 0);
 	virtual ~Atmosphere();
 
 	void output_positions(string datapath);
+	void output_snapshot(string datapath);
 	void output_altitude_distro(double bin_width, string datapath);
 	void output_velocity_distro(double bin_width, string datapath);
 	void output_alt_energy_distro(double alt_in_cm, double e_bin_width, string datapath);
-	void run_simulation(double dt, int num_steps, double lower_bound, double upper_bound, int print_status_freq, int output_pos_freq, string output_pos_dir, string output_stats_dir);
+	// collide particles with Background_Species::collide_coupled, so that runs of the same particles with different
+	// timesteps are coupled (used by Mlmc_Driver; not with substeps)
+	void set_coupled_collisions(bool on);
+
+	// fate of particle i at the end of run_simulation (fate_active if it was still active)
+	Particle_Fate get_fate(int i) const;
+
+	// day (side 0) or night (side 1) density profile [cm^-3] in 1-km bins, as written to density1d_*.out by run_simulation
+	vector<double> get_density_profile(int side, double dt, double rate) const;
+
+	void run_simulation(const Run_Options &options);
 
 private:
 	int num_parts;                      // number of particles initially spawned
+	int first_id;                       // id of the first particle (particle i is particle first_id + i of the distribution)
 	int num_traced;                     // number of particles to output trace data on
 	string trace_dir;                   // directory to output particle trace data to
 	int active_parts;                   // number of active particles
 	Planet my_planet;                   // contains planet mass and radius
-	vector<shared_ptr<Particle>> my_parts;         // array of particles to be tracked
+	vector<Particle> my_parts;          // array of particles to be tracked
+	vector<int> part_ids;               // id of each particle (first_id + i, or the id it had in an imported particle file)
 	shared_ptr<Distribution> my_dist;              // distribution class to initialize particles
 	Background_Species bg_species;      // background species used for collisions
 	vector<int> traced_parts;           // indices of randomly selected trace particles
+	int num_collisions;                 // total number of collisions during simulation
+	int num_threads;                    // number of worker threads
 
-	vector<vector<int>> stats_dens_counts;  // vector for accumulating particle density counts
-	vector<int> stats_coldens_counts;  // vector for accumulating integrated dayside column density counts
-        vector<double> stats_angleavg_dens;  // vector for accumulating angle-averaged column density counts in x=const. plane
-	vector<vector<int>> stats_dens2d_counts;  // stores a 2d grid of dayside column density counts
 	int stats_num_EDFs;  // number of altitude EDFs to track; populated from corona3d_2020.cfg
 	vector<int> stats_EDF_alts;  // holds list of altitudes that (in km above surface) that EDFs are tracked at
-	vector<vector<vector<vector<double>>>> stats_EDFs;  // EDF counts are accumulated here
-	vector<double> stats_loss_rates;  // loss rates at each EDF altitude are calculated and stored here
+	vector<Stats_Tally> stats;  // stats[0] is tallied over all particles; with several sources, stats[1+k] over source k
+	bool recording_births;      // whether stats are also tallied by birth altitude into birth_record
+	Birth_Record birth_record;  // tallies by birth altitude group, for reweighting to other source profiles
+	vector<int> birth_groups;   // birth group of each particle
+	bool track_length;          // whether density, column density, and image tallies use the track-length estimator
+
+	// run parameters used by the transport kernel; set at the beginning of run_simulation
+	double k_g;                         // planet's gravitational constant (-G*mass) [cm^3/s^2]
+	double two_GM;                      // 2*G*mass, used for escape speeds [cm^3/s^2]
+	double r_lower;                     // radius of simulation lower boundary [cm]
+	double r_upper;                     // radius of simulation upper boundary [cm]
+	double v_esc_upper;                 // escape speed at simulation upper boundary [cm/s]
+	Integrator integrator;              // orbit integrator used by do_timestep
+	double substep_tau;                 // adaptive substeps: largest collision optical depth of a substep (0 = fixed steps)
+	int max_substep_level;              // adaptive substeps: at most 2^max_substep_level substeps per timestep
+	long long num_substeps_taken;       // adaptive substeps: total number of particle substeps
+	bool coupled_collisions;            // whether collisions use Background_Species::collide_coupled
+	vector<double> coupled_clock;       // coupled collisions: optical depth of each particle since its last candidate collision
+	vector<int> coupled_events;         // coupled collisions: number of candidate collisions of each particle so far
+	vector<Particle_Fate> final_fates;  // fate of each particle, filled in by run_simulation
+	int sort_freq;                      // altitude sorting: reorder active particles by altitude every sort_freq steps (0 = never)
+	vector<int> sort_bins;              // altitude sorting: altitude bin of each active particle
+	vector<int> sort_offsets;           // altitude sorting: number of particles in lower bins, for each bin
+	vector<int> sort_scratch;           // altitude sorting: reordered indices
+	Parallel_Mode parallel_mode;        // how transport is spread over worker threads
+	vector<Transport_Shard> shards;     // one per worker (just one in serial mode)
+	vector<thread> workers;             // parallel engine: persistent worker threads, started by init_shards
+	Step_Barrier step_barrier;          // parallel engine: start and end of each step for the workers and the driving thread
+	Parallel_Step parallel_step;        // parallel engine: the step the workers transport next
+	vector<Background_Species> node_species;  // pinned parallel engine: replica of bg_species for each NUMA node used
+	vector<int> worker_bounds;          // parallel engine: worker w transports active particles [worker_bounds[w], worker_bounds[w+1])
+	vector<int> shell_edges;            // shells mode: worker w owns altitude bins [shell_edges[w], shell_edges[w+1]) (the
+	                                    // first and last worker also own everything below and above)
+	int last_rebalance;                 // shells mode: step the shell edges were last chosen
+	int num_rebalances;                 // shells mode: number of times the shell edges were chosen
+	vector<int> last_worker;            // parallel engine: worker that last transported each particle
+	long long num_migrations;           // parallel engine: particles transported by a different worker than on their previous step
+	double imbalance_sum;               // parallel engine: sum over steps of the largest worker share over the mean share
+	int num_parallel_steps;             // parallel engine: number of steps taken
+
+	// energy drift diagnostic: the orbital energy of a particle only changes in collisions, so any change during a
+	// step is integration error; errors are relative to the particle's kinetic energy (the orbital energy itself
+	// is near zero for particles close to escape speed)
+	bool checking_energy;               // whether to accumulate the diagnostic
+	vector<double> flight_energy;       // specific orbital energy of each particle after its last collision [erg/g]
+	double step_error_sum;              // sum of relative energy errors over all steps
+	double step_error_max;              // largest relative energy error of a single step
+	double flight_drift_max;            // largest relative energy drift accumulated over a free flight
+	long long num_checked_steps;        // number of steps checked
+
+	// initialize my_parts from parts using the distribution, in chunks of init_chunk_size spread over num_threads
+	// threads; chunk c uses random number stream c (offset by first_id/init_chunk_size), so the result does not
+	// depend on the number of threads
+	void init_particles(const vector<Particle> &parts);
+
+	// stable counting sort of indices[0..n) by 1-km altitude bin, so that particles transported together look up
+	// the same density and cross section table rows and tally into the same bins (particles in the same bin keep
+	// their relative order, which keeps the particle data reads as close to sequential as the sort allows)
+	void sort_by_altitude(vector<int> &indices, int n);
+
+	// set up shards for the given number of workers and, in the parallel engine, start one persistent worker thread
+	// per shard; called after stats and the birth record are initialized
+	// with pinned workers (see numa::init), each worker is pinned once at its start, the worker's initial share of the
+	// particles is moved to its NUMA node, and the atmosphere tables are replicated per node
+	void init_shards(int num_workers);
+
+	// body of worker thread w: transports its range of each step between two step_barrier waits until told to stop
+	void run_worker(int w, bool replicate, atomic<long> &pages_moved);
+
+	// make the worker threads exit and join them (does nothing if none are running)
+	void stop_workers();
+
+	// add the tallies and counters of all shards into the Atmosphere's own, and report on the parallel engine
+	void merge_shards();
+
+	// one timestep of the parallel engine for the n active particles: each worker transports its range of indices
+	// in blocks with its own shard and random number stream, and fates[k] is set to the fate of indices[k]; in
+	// particles mode indices[0..n) is split into equal ranges, in shells mode each worker writes its members into
+	// its range of indices (see Parallel_Mode)
+	void transport_step_parallel(vector<int> &indices, int n, double dt, int step, bool tally, Particle_Fate fates[]);
+
+	// shells mode: sort indices[0..n) by altitude and choose shell edges that split it into equal shares
+	void rebalance_shells(vector<int> &indices, int n, int step);
+
+	// shells mode: worker owning the shell of particle idx
+	int get_shell_owner(int idx) const;
+
+	// fills derived per-step quantities for particle idx from its current state
+	void get_step_state(int idx, Step_State &s);
+
+	// fused transport kernel for a block of n particles (indices), using worker shard w: advances each by one timestep, checks and
+	// applies collisions for the block in one batch, then classifies deactivation into fates[],
+	// and (if tally is set) bins each particle's new state into stats
+	void transport_block(Transport_Shard &w, const int indices[], int n, double dt, double time, bool tally, Particle_Fate fates[]);
+
+	// same as transport_block, but each particle covers dt in 2^level substeps chosen from its collision rate and
+	// orbital time scale; point tallies are still taken at the end of dt
+	void transport_block_adaptive(Transport_Shard &w, const int indices[], int n, double dt, double time, bool tally, Particle_Fate fates[]);
+
+	// one step of length h for n particles: timestep, collision check, and deactivation check, writing each particle's
+	// fate and new state (without its altitude bin); paths go to the track-length tallies if tally_paths is set
+	void advance_block(Transport_Shard &w, const int indices[], int n, double h, double time, bool tally_paths, double path_weight, Particle_Fate fates[], Step_State states[]);
+
+	// track-length estimator: splits the straight path from (x0, y0, z0) to (x1, y1, z1) taken by particle idx
+	// during one step at every density, column density, and image bin boundary, and tallies each piece into the
+	// bins it lies in, weighted by its share of the step times weight
+	void update_track_stats(Transport_Shard &w, int idx, double x0, double y0, double z0, double x1, double y1, double z1, double weight);
 
 	// these two modules are where stats are accumulated and then output at the end of a simulation
-	void update_stats(double dt, int idx);
+	void update_stats(Transport_Shard &w, double dt, int idx, const Step_State &s);
 	void output_stats(double dt, double rate, int total_parts, string output_dir);
 
+	// size and zero, accumulate into, and output a single stats tally (output file names start with output_dir)
+	// a sparse tally (as kept by parallel shards) leaves the EDF and image rows empty until something is binned into
+	// them, and its density and column density profiles grow to the highest bin binned into
+	void init_tally(Stats_Tally &t, bool sparse = false);
+	void update_tally(Stats_Tally &t, double dt, int idx, const Step_State &s);
+	void bin_position(Stats_Tally &t, int alt_bin, double x, double z, double weight);
+	void output_tally(const Stats_Tally &t, double dt, double rate, int total_parts, string output_dir);
+
+	// set up birth_record from the particles' current (birth) states, and add a particle's state to it
+	void init_birth_record(double dt, double upper_bound, double global_rate);
+	void update_birth_record(Transport_Shard &w, int idx, const Step_State &s);
+	void bin_birth_position(Transport_Shard &w, int idx, int alt_bin, double x, double z, double weight);
+
+	// bin of birth record tally k (0 = dens_day, 1 = dens_night, 2 = coldens_day) for birth group g to update
+	double &birth_bin(Transport_Shard &w, int k, int g, int bin);
+
 	// output test particle trace data for selected particles
 	void output_collision_data();
 	void output_trace_data();
@@ -0,0 +1,477 @@
+/*
+ * Atmosphere_Database.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Atmosphere_Database.hpp"
+
+Atmosphere_Database::Atmosphere_Database(int num_parts, string config_files[], Planet p, double ref_T, double ref_h, string temp_profile_filename, string dens_profile_filename, double profile_bottom, double profile_top)
+{
+	num_species = num_parts;
+	my_planet = p;
+	ref_temp = ref_T;
+	ref_height = ref_h;
+	profile_bottom_alt = profile_bottom;
+	profile_top_alt = profile_top;
+	ref_g = (constants::G * my_planet.get_mass()) / (pow(my_planet.get_radius()+ref_height, 2.0));
+
+	if (temp_profile_filename != "")
+	{
+		use_temp_profile = true;
+	}
+	else
+	{
+		use_temp_profile = false;
+	}
+
+	if (dens_profile_filename != "")
+	{
+		use_dens_profile = true;
+	}
+	else
+	{
+		use_dens_profile = false;
+	}
+
+	bg_ids.resize(num_species);
+	bg_masses.resize(num_species);
+	bg_densities.resize(num_species);
+	dens_interp.resize(num_species);
+	bg_sigma_defaults.resize(num_species);
+	bg_sigma_tables.resize(num_species);
+	sigma_interp.resize(num_species);
+	bg_scaleheights.resize(num_species);
+	bg_avg_v.resize(num_species);
+	avg_v_interp.resize(num_species);
+	diff_sigma_energies.resize(num_species);
+	diff_sigma_CDFs.resize(num_species);
+	for (int i=0; i<num_species; i++)
+	{
+		int num_energies = 0;
+		int energies_index = 0;
+		bg_sigma_tables[i].resize(2);
+		diff_sigma_CDFs[i].resize(2);
+
+		ifstream infile;
+		infile.open(config_files[i]);
+		if (!infile.good())
+		{
+			cout << "Background species configuration file " + to_string(i+1) + " not found!\n";
+			exit(1);
+		}
+		string line, param, val;
+		vector<string> parameters;
+		vector<string> values;
+		int num_params = 0;
+
+		while (getline(infile, line))
+		{
+			if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
+			{
+				continue;
+			}
+			else
+			{
+				stringstream str(line);
+				str >> param >> val;
+				parameters.push_back(param);
+				values.push_back(val);
+				num_params++;
+				param = "";
+				val = "";
+			}
+		}
+		infile.close();
+
+		for (int j=0; j<num_params; j++)
+		{
+			if (parameters[j] == "type")
+			{
+				bg_ids[i] = set_particle_type(values[j]);
+				bg_masses[i] = species_table[bg_ids[i]].mass;
+			}
+			else if (parameters[j] == "ref_dens")
+			{
+				bg_densities[i].push_back(stod(values[j]));
+			}
+			else if (parameters[j] == "total_sigma_default")
+			{
+				bg_sigma_defaults[i] = stod(values[j]);
+			}
+			else if (parameters[j] == "total_sigma_file")
+			{
+				if (values[j] != "")
+				{
+					bg_sigma_defaults[i] = 0.0;
+					bg_sigma_tables[i] = common::read_csv(values[j], 2).columns;
+					sigma_interp[i] = make_shared<Interpolator>(bg_sigma_tables[i][0], bg_sigma_tables[i][1]);
+				}
+			}
+			else if (parameters[j] == "num_diff_energies")
+			{
+				num_energies = stoi(values[j]);
+				energies_index = j+1;
+				diff_sigma_CDFs[i].resize(num_energies);
+			}
+		}
+		bg_scaleheights[i].push_back(constants::k_b*ref_temp/(bg_masses[i]*ref_g));
+		bg_avg_v[i].push_back(sqrt(constants::k_b*ref_temp/bg_masses[i]));
+
+		// scattering CDFs depend only on the differential cross section files, so reuse them from the
+		// derived table cache if possible (which also skips reading those files)
+		Derived_Cache cache(string("diff_sigma_CDFs_") + species_table[bg_ids[i]].name);
+		for (int j=0; j<num_energies; j++)
+		{
+			cache.add_file(values[energies_index + num_energies + j]);
+		}
+		vector<vector<double>> cached;
+		bool use_cached = cache.load(cached);
+
+		for (int j=0; j<num_energies; j++)
+		{
+			diff_sigma_CDFs[i][j].resize(4);
+			diff_sigma_energies[i].push_back(stod(values[energies_index + j]));
+			if (use_cached)
+			{
+				for (int k=0; k<4; k++)
+				{
+					diff_sigma_CDFs[i][j][k] = cached[4*j + k];
+				}
+			}
+			else
+			{
+				vector<vector<double>> diff_sigma_PDF = common::read_csv(values[energies_index + num_energies + j], 2).columns;
+				make_new_CDF(i, j, diff_sigma_PDF[0], diff_sigma_PDF[1]);
+			}
+		}
+		if (!use_cached && num_energies > 0)
+		{
+			vector<vector<double>> rows;
+			for (int j=0; j<num_energies; j++)
+			{
+				rows.insert(rows.end(), diff_sigma_CDFs[i][j].begin(), diff_sigma_CDFs[i][j].end());
+			}
+			cache.store(rows);
+		}
+	}
+
+	// read in temperature profile (if available) and set avg_v for each alt bin for each species
+	if (use_temp_profile)
+	{
+		// columns are used by position: altitude, neutral, ion, and electron temperature
+		Csv_Table temp_csv = common::read_csv(temp_profile_filename, 4);
+		temp_alt_bins = temp_csv.columns[0];
+		Tn = temp_csv.columns[1];
+		Ti = temp_csv.columns[2];
+		Te = temp_csv.columns[3];
+		Tn_interp = make_shared<Interpolator>(temp_alt_bins, Tn);
+		Ti_interp = make_shared<Interpolator>(temp_alt_bins, Ti);
+		Te_interp = make_shared<Interpolator>(temp_alt_bins, Te);
+		int num_alt_bins = temp_alt_bins.size();
+		for (int i=0; i<num_species; i++)
+		{
+			// clear avg_v based on ref_temp and populate with values based on temp profile
+			bg_avg_v[i].clear();
+			double mass = bg_masses[i];
+			for (int j=0; j<num_alt_bins; j++)
+			{
+				bg_avg_v[i].push_back(sqrt(constants::k_b*Tn[j]/mass));
+			}
+
+			// generate interpolator for bg_avg_v for each species
+			avg_v_interp[i] = make_shared<Interpolator>(temp_alt_bins, bg_avg_v[i]);
+		}
+	}
+
+	// read in density profile (if available)
+	if (use_dens_profile)
+	{
+		for (int i=0; i<num_species; i++)
+		{
+			// clear out default densities and scale heights in order to use profile derived values
+			bg_densities[i].clear();
+			bg_scaleheights[i].clear();
+			bg_scaleheights[i].resize(2);
+		}
+		// first column is altitude; each species' densities are found by name in the header line
+		// (e.g. "CO2(cm-3)"), or taken in config order from the following columns if the file has no header
+		Csv_Table dens_csv = common::read_csv(dens_profile_filename, 2);
+		dens_alt_bins = dens_csv.columns[0];
+		for (int i=0; i<num_species; i++)
+		{
+			int col = i+1;
+			if (!dens_csv.names.empty())
+			{
+				col = dens_csv.find_column(species_table[bg_ids[i]].name);
+			}
+			if (col < 0 || col >= dens_csv.get_num_cols())
+			{
+				cout << "Density profile " << dens_profile_filename << " has no column for background species " << species_table[bg_ids[i]].name << "!\n";
+				exit(1);
+			}
+			bg_densities[i] = dens_csv.columns[col];
+		}
+
+		double bottom_local_g = (constants::G * my_planet.get_mass()) / (pow(my_planet.get_radius()+profile_bottom_alt, 2.0));
+		double top_local_g = (constants::G * my_planet.get_mass()) / (pow(my_planet.get_radius()+profile_top_alt, 2.0));
+		for (int i=0; i<num_species; i++)
+		{
+			// generate interpolator for each density profile
+			dens_interp[i] = make_shared<Interpolator>(dens_alt_bins, bg_densities[i]);
+
+			// calc top and bottom scale height to be used for extrapolating densities
+			bg_scaleheights[i][0] = constants::k_b*Tn_interp->loglinterp(profile_bottom_alt)/(bg_masses[i]*bottom_local_g);
+			bg_scaleheights[i][1] = constants::k_b*Tn_interp->loglinterp(profile_top_alt)/(bg_masses[i]*top_local_g);
+		}
+	}
+}
+
+
+Atmosphere_Database::~Atmosphere_Database() {
+
+}
+
+int Atmosphere_Database::get_num_species() const
+{
+	return num_species;
+}
+
+// species id (index into species_table) of background species index
+int Atmosphere_Database::get_bg_species(int index) const
+{
+	return bg_ids[index];
+}
+
+double Atmosphere_Database::get_mass(int index) const
+{
+	return bg_masses[index];
+}
+
+Planet Atmosphere_Database::get_planet() const
+{
+	return my_planet;
+}
+
+double Atmosphere_Database::get_ref_temp() const
+{
+	return ref_temp;
+}
+
+double Atmosphere_Database::get_ref_height() const
+{
+	return ref_height;
+}
+
+bool Atmosphere_Database::uses_temp_profile() const
+{
+	return use_temp_profile;
+}
+
+bool Atmosphere_Database::uses_dens_profile() const
+{
+	return use_dens_profile;
+}
+
+// true if species index uses a total cross section table rather than its default sigma
+bool Atmosphere_Database::has_sigma_table(int index) const
+{
+	return bg_sigma_defaults[index] == 0.0;
+}
+
+double Atmosphere_Database::get_sigma_default(int index) const
+{
+	return bg_sigma_defaults[index];
+}
+
+// total cross section of species index at collision energy (in eV) from its lookup table
+double Atmosphere_Database::get_sigma(int index, double energy) const
+{
+	return sigma_interp[index]->linterp(energy);
+}
+
+// upper bound of get_sigma over all energies (the lookup table is interpolated linearly and clamped at its ends),
+// or the default sigma of a species without a table
+double Atmosphere_Database::get_sigma_max(int index) const
+{
+	if (!has_sigma_table(index))
+	{
+		return bg_sigma_defaults[index];
+	}
+	return *max_element(bg_sigma_tables[index][1].begin(), bg_sigma_tables[index][1].end());
+}
+
+// density of species index at reference height (or bottom of density profile)
+double Atmosphere_Database::get_ref_density(int index) const
+{
+	return bg_densities[index][0];
+}
+
+// scale height of species index at reference height (or bottom of density profile)
+double Atmosphere_Database::get_ref_scaleheight(int index) const
+{
+	return bg_scaleheights[index][0];
+}
+
+// average thermal velocity of species index at reference temperature (or bottom of temperature profile)
+double Atmosphere_Database::get_ref_avg_v(int index) const
+{
+	return bg_avg_v[index][0];
+}
+
+// calculates new density of background particle based on radial position and scale height
+double Atmosphere_Database::calc_new_density(double ref_density, double scale_height, double r_moved) const
+{
+	return ref_density*exp(r_moved/scale_height);
+}
+
+// average thermal velocity of background species at given altitude (from temperature profile if available)
+double Atmosphere_Database::get_avg_v(double alt, int index) const
+{
+	if (!use_temp_profile || alt < profile_bottom_alt)
+	{
+		return bg_avg_v[index][0];
+	}
+	else if (alt > profile_top_alt)
+	{
+		return bg_avg_v[index].back();
+	}
+	else
+	{
+		return avg_v_interp[index]->loglinterp(alt);
+	}
+}
+
+// deep copy allocated by the calling thread (for a replica in its NUMA node's memory)
+shared_ptr<const Atmosphere_Database> Atmosphere_Database::replicate() const
+{
+	shared_ptr<Atmosphere_Database> copy = make_shared<Atmosphere_Database>(*this);
+	auto clone = [](shared_ptr<Interpolator> &interp)
+	{
+		if (interp)
+		{
+			interp = make_shared<Interpolator>(*interp);
+		}
+	};
+	clone(copy->Tn_interp);
+	clone(copy->Ti_interp);
+	clone(copy->Te_interp);
+	for (int i=0; i<num_species; i++)
+	{
+		clone(copy->dens_interp[i]);
+		clone(copy->sigma_interp[i]);
+		clone(copy->avg_v_interp[i]);
+	}
+	return copy;
+}
+
+// scans imported differential scattering CDF for new collision theta; also sets its cosine and sine
+double Atmosphere_Database::find_new_theta(int part_index, double energy, double &cos_theta, double &sin_theta) const
+{
+	return find_new_theta(part_index, energy, common::get_rand(), cos_theta, sin_theta);
+}
+
+// same, with the uniform random number u used to search the CDF given by the caller
+double Atmosphere_Database::find_new_theta(int part_index, double energy, double u, double &cos_theta, double &sin_theta) const
+{
+	// get energy index
+	int energy_index = 0;
+	int num_energies = diff_sigma_energies[part_index].size();
+	if (energy <= diff_sigma_energies[part_index][0])
+	{
+		energy_index = 0;
+	}
+	else if (energy >= diff_sigma_energies[part_index].back())
+	{
+		energy_index = num_energies - 1;
+	}
+	else
+	{
+		double difference = INFINITY;
+		for (int i=0; i<num_energies; i++)
+		{
+			double new_diff = abs(energy - diff_sigma_energies[part_index][i]);
+			if (new_diff < difference)
+			{
+				difference = new_diff;
+				energy_index = i;
+			}
+		}
+	}
+
+	// search CDF for angle
+	int k = 0;
+	while (diff_sigma_CDFs[part_index][energy_index][0][k] < u)
+	{
+		k++;
+	}
+	cos_theta = diff_sigma_CDFs[part_index][energy_index][2][k];
+	sin_theta = diff_sigma_CDFs[part_index][energy_index][3][k];
+	return diff_sigma_CDFs[part_index][energy_index][1][k];
+}
+
+// get density from imported density profile
+double Atmosphere_Database::get_density(double alt, int index) const
+{
+	double current_dens = 0.0;
+
+	// if outside of profile boundaries, need to extrapolate using a scale height
+	if (alt < profile_bottom_alt)
+	{
+		current_dens = calc_new_density(bg_densities[index][0], bg_scaleheights[index][0], profile_bottom_alt - alt);
+	}
+	else if (alt > profile_top_alt)
+	{
+		current_dens = calc_new_density(bg_densities[index].back(), bg_scaleheights[index][1], profile_top_alt - alt);
+	}
+	else
+	{
+		current_dens = dens_interp[index]->loglinterp(alt);
+	}
+
+	return current_dens;
+}
+
+// make a new differential cross section CDF and store at diff_sigma_CDFs[part_index][energy_index]
+void Atmosphere_Database::make_new_CDF(int part_index, int energy_index, vector<double> &angle, vector<double> &sigma)
+{
+	int num_angles = angle.size();
+	diff_sigma_CDFs[part_index][energy_index][0].resize(num_angles);
+	diff_sigma_CDFs[part_index][energy_index][1].resize(num_angles);
+	diff_sigma_CDFs[part_index][energy_index][2].resize(num_angles);
+	diff_sigma_CDFs[part_index][energy_index][3].resize(num_angles);
+
+	double sig_total = 0.0;
+	for (int i=0; i<num_angles; i++)
+	{
+		diff_sigma_CDFs[part_index][energy_index][1][i] = angle[i] * (constants::pi / 180.0);
+		diff_sigma_CDFs[part_index][energy_index][2][i] = cos(diff_sigma_CDFs[part_index][energy_index][1][i]);
+		diff_sigma_CDFs[part_index][energy_index][3][i] = sin(diff_sigma_CDFs[part_index][energy_index][1][i]);
+		sigma[i] = sigma[i] * sin(angle[i]*constants::pi/180.0);
+		sig_total = sig_total + sigma[i];
+	}
+	for (int i=0; i<num_angles; i++)
+	{
+		if (i == 0)
+		{
+			diff_sigma_CDFs[part_index][energy_index][0][i] = sigma[i] / sig_total;
+		}
+		else
+		{
+			diff_sigma_CDFs[part_index][energy_index][0][i] = (sigma[i] / sig_total) + diff_sigma_CDFs[part_index][energy_index][0][i-1];
+		}
+	}
+}
+
+//subroutine to set particle types
+int Atmosphere_Database::set_particle_type(string type)
+{
+	int id = get_species_id(type);
+	if (id < 0)
+	{
+		cout << "Invalid particle type specified! Please check configuration file.\n";
+		exit(1);
+	}
+	return id;
+}
@@ -0,0 +1,107 @@
+/*
+ * Atmosphere_Database.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef ATMOSPHERE_DATABASE_HPP_
+#define ATMOSPHERE_DATABASE_HPP_
+
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include "Species.hpp"
+#include "Planet.hpp"
+#include "Common_Functions.hpp"
+#include "Interpolator.hpp"
+#include "Derived_Cache.hpp"
+using namespace std;
+
+// tabulated background atmosphere and cross section data (densities, temperatures, total and differential
+// cross sections, and their interpolators), loaded once from the background species configuration files
+// never modified after construction; hold as shared_ptr<const Atmosphere_Database> so any number of
+// Background_Species (one per engine, thread, or configuration) can share one copy
+class Atmosphere_Database {
+public:
+	Atmosphere_Database(int num_parts, string config_files[], Planet p, double ref_T, double ref_h, string temp_profile_filename, string dens_profile_filename, double profile_bottom, double profile_top);
+	virtual ~Atmosphere_Database();
+
+	int get_num_species() const;
+	int get_bg_species(int index) const;
+	double get_mass(int index) const;
+	Planet get_planet() const;
+	double get_ref_temp() const;
+	double get_ref_height() const;
+	bool uses_temp_profile() const;
+	bool uses_dens_profile() const;
+
+	// total cross sections: species without a lookup table use their default sigma
+	bool has_sigma_table(int index) const;
+	double get_sigma_default(int index) const;
+	double get_sigma(int index, double energy) const;
+	double get_sigma_max(int index) const;   // largest total cross section of species index at any energy
+
+	// reference (lowest) density, scale height, and average thermal velocity for each species
+	double get_ref_density(int index) const;
+	double get_ref_scaleheight(int index) const;
+	double get_ref_avg_v(int index) const;
+
+	// calculates new density of background particle based on radial position and scale height
+	double calc_new_density(double ref_density, double scale_height, double r_moved) const;
+
+	// average thermal velocity of background species at given altitude (from temperature profile if available)
+	double get_avg_v(double alt, int index) const;
+
+	// get density from imported density profile
+	double get_density(double alt, int index) const;
+
+	// scans imported differential scattering CDF for new collision theta; also sets its cosine and sine
+	double find_new_theta(int part_index, double energy, double &cos_theta, double &sin_theta) const;
+	double find_new_theta(int part_index, double energy, double u, double &cos_theta, double &sin_theta) const;
+
+	// deep copy (interpolators included) allocated by the calling thread, so that a thread pinned to a NUMA node
+	// can place a replica of the tables in that node's memory
+	shared_ptr<const Atmosphere_Database> replicate() const;
+
+private:
+	bool use_temp_profile;       // flag for whether or not temperature profile is available
+	bool use_dens_profile;       // flag for whether or not density profile is available
+	int num_species;             // number of background species in atmosphere
+	Planet my_planet;            // contains planet mass, radius, and gravitational constant
+	double ref_temp;             // temperature (in Kelvin) at reference height
+	double ref_height;           // height (in cm above planet surface) to extrapolate densities from if no profile available
+	double ref_g;                // acceleration due to gravity (G*M/r^2) at reference height
+	vector<int> bg_ids;                   // species id (index into species_table) of each background species
+	vector<double> bg_masses;             // mass of each background species [g]
+	double profile_bottom_alt;            // altitude above surface (cm) where atmospheric profiles begin
+	double profile_top_alt;               // altitude above surface (cm) where atmospheric profiles end
+	vector<double> temp_alt_bins;         // altitude bins from imported temperature profile
+	vector<double> Tn;                    // neutral species temperature profile
+	shared_ptr<Interpolator> Tn_interp;   // interpolator for neutral temp profile
+	vector<double> Ti;                    // ionic species temperature profile
+	shared_ptr<Interpolator> Ti_interp;   // interpolator for ion temp profile
+	vector<double> Te;                    // electron temperature profile
+	shared_ptr<Interpolator> Te_interp;   // interpolator for electron temp profile
+	vector<double> dens_alt_bins;         // array of altitude bins imported along with densities
+	vector<vector<double>> bg_densities;  // array of densities for each background species
+	vector<shared_ptr<Interpolator>> dens_interp;  // density interpolator objects
+	vector<double> bg_sigma_defaults;     // array of default total cross sections for each particle
+	vector<vector<vector<double>>> bg_sigma_tables;  // lookup tables for total cross sections
+	vector<shared_ptr<Interpolator>> sigma_interp;  // total sigma interpolator objects
+	vector<vector<double>> bg_scaleheights;       // array of scale heights for each particle type
+	vector<vector<double>> bg_avg_v;      // array of average (thermal) velocities for each particle
+	vector<shared_ptr<Interpolator>> avg_v_interp;   // avg_v interpolator objects
+	vector<vector<double>> diff_sigma_energies;              // array of available differential cross section energies for each species
+	vector<vector<vector<vector<double>>>> diff_sigma_CDFs;  // CDFs built from imported differential cross section tables; used for looking up scattering angles
+	                                                         // (rows are CDF, angle, cos(angle), sin(angle))
+
+	// make a new differential cross section CDF and store at diff_sigma_CDFs[index]
+	void make_new_CDF(int part_index, int energy_index, vector<double> &angle, vector<double> &sigma);
+
+	//subroutine to set particle type; returns species id
+	int set_particle_type(string type);
+};
+
+#endif /* ATMOSPHERE_DATABASE_HPP_ */
@@ -8,437 +8,569 @@
 #include "Background_Species.hpp"
 
 Background_Species::Background_Species() {
-	use_temp_profile = false;
-	use_dens_profile = false;
-	profile_bottom_alt = 0.0;
-	profile_top_alt = 0.0;
 	num_collisions = 0;
 	num_species = 0;
-	ref_temp = 0.0;
-	ref_height = 0.0;
-	ref_g = 0.0;
 	collision_target = -1;
 	collision_theta = 0.0;
-	my_dist = NULL;
+	db = NULL;
+	collision_kernel = &Background_Species::check_collisions_kernel<0, 0x0, false, false>;
 }
 
-Background_Species::Background_Species(int num_parts, string config_files[], Planet p, double ref_T, double ref_h, string temp_profile_filename, string dens_profile_filename, double profile_bottom, double profile_top)
+Background_Species::Background_Species(shared_ptr<const Atmosphere_Database> database)
 {
+	db = database;
 	num_collisions = 0;
-	num_species = num_parts;
-	my_planet = p;
-	ref_temp = ref_T;
-	ref_height = ref_h;
-	my_dist = make_shared<Distribution_MB>(my_planet, ref_height, ref_temp);
-	profile_bottom_alt = profile_bottom;
-	profile_top_alt = profile_top;
+	num_species = db->get_num_species();
 	collision_target = -1;   // set to -1 when no collision happening
 	collision_theta = 0.0;
-	ref_g = (constants::G * my_planet.get_mass()) / (pow(my_planet.get_radius()+ref_height, 2.0));
 
-	if (temp_profile_filename != "")
-	{
-		use_temp_profile = true;
-	}
-	else
+	bg_parts.resize(num_species);
+	for (int i=0; i<num_species; i++)
 	{
-		use_temp_profile = false;
+		bg_parts[i] = Particle(db->get_bg_species(i));
 	}
 
-	if (dens_profile_filename != "")
+	select_collision_kernel();
+}
+
+Background_Species::~Background_Species() {
+
+}
+
+// size all per-particle output and scratch arrays for a batch of n particles and num_species background species
+void Collision_Results::resize(int n, int num_species)
+{
+	num_collided = 0;
+	collided.resize(n);
+	target.resize(n);
+	theta.resize(n);
+	cos_theta.resize(n);
+	sin_theta.resize(n);
+	target_vx.resize(n);
+	target_vy.resize(n);
+	target_vz.resize(n);
+	speed.resize(n);
+	preset_azimuth = false;
+	azimuth.resize(n);
+	alt.resize(n);
+	tau.resize(n);
+	u.resize(n);
+	sigma.resize(n);
+	partner_v_avg.resize(n);
+	dens.resize(n*num_species);
+	energy.resize(n*num_species);
+	partner_vx.resize(n*num_species);
+	partner_vy.resize(n*num_species);
+	partner_vz.resize(n*num_species);
+	col_index.resize(n);
+	col_vx.resize(n);
+	col_vy.resize(n);
+	col_vz.resize(n);
+	col_tvx.resize(n);
+	col_tvy.resize(n);
+	col_tvz.resize(n);
+	col_mfrac.resize(n);
+	col_cos_theta.resize(n);
+	col_sin_theta.resize(n);
+	col_cos_phi.resize(n);
+	col_sin_phi.resize(n);
+}
+
+// returns collision energy in eV between particles of mass m1 and m2 with relative velocity dv
+// (kinetic energy in the center-of-mass frame, 0.5*mu*|dv|^2)
+double Background_Species::calc_collision_e(double m1, double m2, double dvx, double dvy, double dvz) const
+{
+	double mu = m1*m2 / (m1 + m2);
+	return 0.5*mu*(dvx*dvx + dvy*dvy + dvz*dvz) / constants::ergev;
+}
+
+// check a batch of particles for collisions during a timestep of length dt
+// collision flags, targets, angles, and partner velocities are written to results; nothing in this object changes
+void Background_Species::check_collisions(const Particle_Store &parts, double dt, Collision_Results &results) const
+{
+	(this->*collision_kernel)(parts, dt, results);
+}
+
+// estimated collision rate [s^-1] of each particle in parts, for choosing step sizes: the sum over species of
+// density*sigma*speed as in check_collisions, but with cross sections at the particle's energy relative to a
+// partner at rest, so that no random numbers are drawn
+void Background_Species::estimate_collision_rates(const Particle_Store &parts, double rates[]) const
+{
+	const int n = parts.size;
+	const double planet_r = db->get_planet().get_radius();
+	const double ref_height = db->get_ref_height();
+	for (int i=0; i<n; i++)
 	{
-		use_dens_profile = true;
+		double alt = sqrt(parts.x[i]*parts.x[i] + parts.y[i]*parts.y[i] + parts.z[i]*parts.z[i]) - planet_r;
+		double speed = sqrt(parts.vx[i]*parts.vx[i] + parts.vy[i]*parts.vy[i] + parts.vz[i]*parts.vz[i]);
+		double rate = 0.0;
+		for (int s=0; s<num_species; s++)
+		{
+			double dens = db->uses_dens_profile() ? db->get_density(alt, s) : db->calc_new_density(db->get_ref_density(s), db->get_ref_scaleheight(s), ref_height - alt);
+			double sigma = db->get_sigma_default(s);
+			if (db->has_sigma_table(s))
+			{
+				sigma = db->get_sigma(s, calc_collision_e(species_table[parts.species[i]].mass, db->get_mass(s), parts.vx[i], parts.vy[i], parts.vz[i]));
+			}
+			rate += dens*sigma*speed;
+		}
+		rates[i] = rate;
 	}
-	else
+}
+
+// coupled collisions for multilevel Monte Carlo (see Mlmc_Driver.hpp): the collision physics of check_collisions
+// (Maxwellian partners, total cross sections at the partner energy, target in proportion to density), made as a
+// null-collision process so that every random number belongs to a numbered candidate collision instead of a timestep:
+// - candidates come at the majorant rate speed * sum over species of density*sigma_max, so each step adds
+//   speed*dt*sum(density*sigma_max) of optical depth to clock[i], and candidate events[i] comes when the clock
+//   passes an exponential threshold
+// - a candidate draws a partner of every species and is a collision with probability
+//   sum(density*sigma)/sum(density*sigma_max), so collisions come at the rate of check_collisions as dt -> 0;
+//   the target species, angle and azimuth are drawn as in check_collisions
+// all draws come from common::get_keyed_rand(parts.id[i], candidate, draw), so runs of the same particles with
+// different timesteps meet the same candidates with the same partners and angles, and differ only in when they meet
+// them and in the state they are in; a particle collides at most once per step (the optical depth left over after a
+// collision stays in its clock, so a second collision comes at the start of the next step rather than being lost)
+// clock[i] and events[i] are particle i's optical depth since its last candidate and number of candidates so far
+// (both 0 at the start of a run) and are updated here
+void Background_Species::collide_coupled(Particle_Store &parts, double dt, double clock[], int events[], Collision_Results &results) const
+{
+	const int n = parts.size;
+	const double planet_r = db->get_planet().get_radius();
+	const double ref_height = db->get_ref_height();
+	const bool temp = db->uses_temp_profile();
+	results.resize(n, num_species);
+	results.preset_azimuth = true;
+
+	vector<double> sigma_max(num_species);
+	for (int s=0; s<num_species; s++)
 	{
-		use_dens_profile = false;
+		sigma_max[s] = db->get_sigma_max(s);
 	}
 
-	bg_parts.resize(num_species);
-	bg_densities.resize(num_species);
-	dens_interp.resize(num_species);
-	bg_sigma_defaults.resize(num_species);
-	bg_sigma_tables.resize(num_species);
-	sigma_interp.resize(num_species);
-	bg_scaleheights.resize(num_species);
-	bg_avg_v.resize(num_species);
-	avg_v_interp.resize(num_species);
-	diff_sigma_energies.resize(num_species);
-	diff_sigma_CDFs.resize(num_species);
-	for (int i=0; i<num_species; i++)
+	int num_collided = 0;
+	for (int i=0; i<n; i++)
 	{
-		int num_energies = 0;
-		int energies_index = 0;
-		bg_sigma_tables[i].resize(2);
-		diff_sigma_CDFs[i].resize(2);
-
-		ifstream infile;
-		infile.open(config_files[i]);
-		if (!infile.good())
-		{
-			cout << "Background species configuration file " + to_string(i+1) + " not found!\n";
-			exit(1);
-		}
-		string line, param, val;
-		vector<string> parameters;
-		vector<string> values;
-		int num_params = 0;
+		double alt = sqrt(parts.x[i]*parts.x[i] + parts.y[i]*parts.y[i] + parts.z[i]*parts.z[i]) - planet_r;
+		double speed = sqrt(parts.vx[i]*parts.vx[i] + parts.vy[i]*parts.vy[i] + parts.vz[i]*parts.vz[i]);
+		double mass = species_table[parts.species[i]].mass;
+		long long id = parts.id[i];
+		results.speed[i] = speed;
+		results.collided[i] = 0;
+		results.target[i] = -1;
 
-		while (getline(infile, line))
+		double total_dens = 0.0;
+		double major = 0.0;   // sum of density*sigma_max
+		for (int s=0; s<num_species; s++)
 		{
-			if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
-			{
-				continue;
-			}
-			else
-			{
-				stringstream str(line);
-				str >> param >> val;
-				parameters.push_back(param);
-				values.push_back(val);
-				num_params++;
-				param = "";
-				val = "";
-			}
+			double dens = db->uses_dens_profile() ? db->get_density(alt, s) : db->calc_new_density(db->get_ref_density(s), db->get_ref_scaleheight(s), ref_height - alt);
+			results.dens[s*n + i] = dens;
+			total_dens += dens;
+			major += dens*sigma_max[s];
 		}
-		infile.close();
+		clock[i] += speed*dt*major;
 
-		for (int j=0; j<num_params; j++)
+		// candidate c uses draws 0 (threshold), 1 (accept), 2 (target), 3 (angle), 4 (azimuth), and 5+4s .. 8+4s
+		// (Maxwellian partner of species s from two Box-Muller pairs)
+		while (!results.collided[i])
 		{
-			if (parameters[j] == "type")
+			long long c = events[i];
+			double threshold = -log(1.0 - common::get_keyed_rand(id, c, 0));
+			if (clock[i] < threshold)
 			{
-				bg_parts[i] = set_particle_type(values[j]);
+				break;
 			}
-			else if (parameters[j] == "ref_dens")
+			clock[i] -= threshold;
+			events[i]++;
+
+			double sum_sigma = 0.0;
+			for (int s=0; s<num_species; s++)
 			{
-				bg_densities[i].push_back(stod(values[j]));
+				int k = s*n + i;
+				double v_avg = temp ? db->get_avg_v(alt, s) : db->get_ref_avg_v(s);
+				double r1 = v_avg*sqrt(-2.0*log(1.0 - common::get_keyed_rand(id, c, 5+4*s)));
+				double phi1 = constants::twopi*common::get_keyed_rand(id, c, 6+4*s);
+				double r2 = v_avg*sqrt(-2.0*log(1.0 - common::get_keyed_rand(id, c, 7+4*s)));
+				double phi2 = constants::twopi*common::get_keyed_rand(id, c, 8+4*s);
+				results.partner_vx[k] = r1*cos(phi1);
+				results.partner_vy[k] = r1*sin(phi1);
+				results.partner_vz[k] = r2*cos(phi2);
+				results.energy[k] = calc_collision_e(mass, db->get_mass(s), parts.vx[i]-results.partner_vx[k], parts.vy[i]-results.partner_vy[k], parts.vz[i]-results.partner_vz[k]);
+
+				double sigma = db->has_sigma_table(s) ? db->get_sigma(s, results.energy[k]) : db->get_sigma_default(s);
+				sum_sigma += sigma*results.dens[k];
 			}
-			else if (parameters[j] == "total_sigma_default")
+			if (common::get_keyed_rand(id, c, 1)*major >= sum_sigma)
 			{
-				bg_sigma_defaults[i] = stod(values[j]);
+				continue;   // null collision
 			}
-			else if (parameters[j] == "total_sigma_file")
+			results.collided[i] = 1;
+			num_collided++;
+
+			// target species in proportion to density, as in check_collisions
+			double r = common::get_keyed_rand(id, c, 2);
+			double frac = 0.0;
+			int target = num_species-1;
+			for (int s=0; s<num_species; s++)
 			{
-				if (values[j] != "")
+				frac += results.dens[s*n + i] / total_dens;
+				if (r < frac)
 				{
-					bg_sigma_defaults[i] = 0.0;
-					common::import_csv(values[j], bg_sigma_tables[i][0], bg_sigma_tables[i][1]);
-					sigma_interp[i] = make_shared<Interpolator>(bg_sigma_tables[i][0], bg_sigma_tables[i][1]);
+					target = s;
+					break;
 				}
 			}
-			else if (parameters[j] == "num_diff_energies")
-			{
-				num_energies = stoi(values[j]);
-				energies_index = j+1;
-				diff_sigma_CDFs[i].resize(num_energies);
-			}
-		}
-		bg_scaleheights[i].push_back(constants::k_b*ref_temp/(bg_parts[i]->get_mass()*ref_g));
-		bg_avg_v[i].push_back(sqrt(constants::k_b*ref_temp/bg_parts[i]->get_mass()));
-
-		for (int j=0; j<num_energies; j++)
-		{
-			diff_sigma_CDFs[i][j].resize(2);
-			vector<vector<double>> diff_sigma_PDF;
-			diff_sigma_PDF.resize(2);
-			diff_sigma_energies[i].push_back(stod(values[energies_index + j]));
-			common::import_csv(values[energies_index + num_energies + j], diff_sigma_PDF[0], diff_sigma_PDF[1]);
-			make_new_CDF(i, j, diff_sigma_PDF[0], diff_sigma_PDF[1]);
+			results.target[i] = target;
+
+			int k = target*n + i;
+			results.target_vx[i] = results.partner_vx[k];
+			results.target_vy[i] = results.partner_vy[k];
+			results.target_vz[i] = results.partner_vz[k];
+			results.theta[i] = db->find_new_theta(target, results.energy[k], common::get_keyed_rand(id, c, 3), results.cos_theta[i], results.sin_theta[i]);
+			results.azimuth[i] = constants::twopi*common::get_keyed_rand(id, c, 4);
 		}
 	}
+	results.num_collided = num_collided;
 
-	// read in temperature profile (if available) and set avg_v for each alt bin for each species
-	if (use_temp_profile)
-	{
-		common::import_csv(temp_profile_filename, temp_alt_bins, Tn, Ti, Te);
-		Tn_interp = make_shared<Interpolator>(temp_alt_bins, Tn);
-		Ti_interp = make_shared<Interpolator>(temp_alt_bins, Ti);
-		Te_interp = make_shared<Interpolator>(temp_alt_bins, Te);
-		int num_alt_bins = temp_alt_bins.size();
-		for (int i=0; i<num_species; i++)
-		{
-			// clear avg_v based on ref_temp and populate with values based on temp profile
-			bg_avg_v[i].clear();
-			double mass = bg_parts[i]->get_mass();
-			for (int j=0; j<num_alt_bins; j++)
-			{
-				bg_avg_v[i].push_back(sqrt(constants::k_b*Tn[j]/mass));
-			}
+	apply_collisions(parts, results);
+}
 
-			// generate interpolator for bg_avg_v for each species
-			avg_v_interp[i] = make_shared<Interpolator>(temp_alt_bins, bg_avg_v[i]);
-		}
+// check to see if a single particle collided and initialize target particle if so
+// (batch of one through check_collisions; the result is kept for get_collision_target and get_collision_theta)
+bool Background_Species::check_collision(const Particle &p, double dt)
+{
+	single_part.resize(1);
+	single_part.species[0] = p.get_species();
+	single_part.x[0] = p.get_x();
+	single_part.y[0] = p.get_y();
+	single_part.z[0] = p.get_z();
+	single_part.vx[0] = p.get_vx();
+	single_part.vy[0] = p.get_vy();
+	single_part.vz[0] = p.get_vz();
+	check_collisions(single_part, dt, single_results);
+
+	if (single_results.collided[0])
+	{
+		num_collisions++;
+		collision_target = single_results.target[0];
+		collision_theta = single_results.theta[0];
+		bg_parts[collision_target].init_particle_vonly(single_results.target_vx[0], single_results.target_vy[0], single_results.target_vz[0]);
+		return true;
 	}
-
-	// read in density profile (if available)
-	if (use_dens_profile)
+	else
 	{
-		for (int i=0; i<num_species; i++)
-		{
-			// clear out default densities and scale heights in order to use profile derived values
-			bg_densities[i].clear();
-			bg_scaleheights[i].clear();
-			bg_scaleheights[i].resize(2);
-		}
-		if (num_species == 5)
-		{
-			common::import_csv(dens_profile_filename, dens_alt_bins, bg_densities[0], bg_densities[1], bg_densities[2], bg_densities[3], bg_densities[4]);
-		}
-		else if (num_species == 4)
-		{
-			common::import_csv(dens_profile_filename, dens_alt_bins, bg_densities[0], bg_densities[1], bg_densities[2], bg_densities[3]);
-		}
-		else if (num_species == 3)
-		{
-			common::import_csv(dens_profile_filename, dens_alt_bins, bg_densities[0], bg_densities[1], bg_densities[2]);
-		}
-		else if (num_species == 2)
-		{
-			common::import_csv(dens_profile_filename, dens_alt_bins, bg_densities[0], bg_densities[1]);
-		}
-		else if (num_species == 1)
-		{
-			common::import_csv(dens_profile_filename, dens_alt_bins, bg_densities[0]);
-		}
-
-		double bottom_local_g = (constants::G * my_planet.get_mass()) / (pow(my_planet.get_radius()+profile_bottom_alt, 2.0));
-		double top_local_g = (constants::G * my_planet.get_mass()) / (pow(my_planet.get_radius()+profile_top_alt, 2.0));
-		for (int i=0; i<num_species; i++)
-		{
-			// generate interpolator for each density profile
-			dens_interp[i] = make_shared<Interpolator>(dens_alt_bins, bg_densities[i]);
-
-			// calc top and bottom scale height to be used for extrapolating densities
-			bg_scaleheights[i][0] = constants::k_b*Tn_interp->loglinterp(profile_bottom_alt)/(bg_parts[i]->get_mass()*bottom_local_g);
-			bg_scaleheights[i][1] = constants::k_b*Tn_interp->loglinterp(profile_top_alt)/(bg_parts[i]->get_mass()*top_local_g);
-		}
+		collision_target = -1;
+		return false;
 	}
 }
 
-
-Background_Species::~Background_Species() {
-
-}
-
-// returns collision energy in eV between particle 1 and particle 2
-double Background_Species::calc_collision_e(shared_ptr<Particle> p1, shared_ptr<Particle> p2)
+// batched collision check, done as a series of passes over the batch so the arithmetic passes vectorize
+// when N > 0, the species loop is fixed at compile time: bit i of table_mask is set if species i uses a total
+// cross section table rather than its default sigma, and temp_profile and dens_profile mirror the database's
+// uses_temp_profile() and uses_dens_profile(); when N is 0 all of these are read at runtime (generic kernel)
+template<int N, unsigned table_mask, bool temp_profile, bool dens_profile>
+void Background_Species::check_collisions_kernel(const Particle_Store &parts, double dt, Collision_Results &results) const
 {
-	double e = 0.0;
-	double p1_mass = p1->get_mass();
-	double p2_mass = p2->get_mass();
-	Matrix<double, 3, 1> p1_v = {p1->get_vx(), p1->get_vy(), p1->get_vz()};
-	Matrix<double, 3, 1> p2_v = {p2->get_vx(), p2->get_vy(), p2->get_vz()};
-	Matrix<double, 3, 1> vcm;
-	vcm = (p1_mass*p1_v.array() + p2_mass*p2_v.array()) / (p1_mass + p2_mass);
-	Matrix<double, 3, 1> p1_vcm = p1_v.array() - vcm.array();    // particle 1 c-o-m velocity
-	Matrix<double, 3, 1> p2_vcm = p2_v.array() - vcm.array();    // particle 2 c-o-m velocity
-	double p1_vcm_tot = sqrt(p1_vcm[0]*p1_vcm[0] + p1_vcm[1]*p1_vcm[1] + p1_vcm[2]*p1_vcm[2]);  // particle 1 c-o-m scalar velocity
-	double p2_vcm_tot = sqrt(p2_vcm[0]*p2_vcm[0] + p2_vcm[1]*p2_vcm[1] + p2_vcm[2]*p2_vcm[2]);  // particle 2 c-o-m scalar velocity
-	e = (0.5*p1_mass*p1_vcm_tot*p1_vcm_tot + 0.5*p2_mass*p2_vcm_tot*p2_vcm_tot) / constants::ergev;
-
-	return e;
-}
-
-// calculates new density of background particle based on radial position and scale height
-double Background_Species::calc_new_density(double ref_density, double scale_height, double r_moved)
-{
-	return ref_density*exp(r_moved/scale_height);
-}
+	const int n = parts.size;
+	const int ns = (N > 0) ? N : num_species;
+	const bool temp = (N > 0) ? temp_profile : db->uses_temp_profile();
+	const bool dprof = (N > 0) ? dens_profile : db->uses_dens_profile();
+	const double planet_r = db->get_planet().get_radius();
+	const double ref_height = db->get_ref_height();
+	results.resize(n, ns);
+
+	const double *x = parts.x.data();
+	const double *y = parts.y.data();
+	const double *z = parts.z.data();
+	const double *vx = parts.vx.data();
+	const double *vy = parts.vy.data();
+	const double *vz = parts.vz.data();
+	double *speed = results.speed.data();
+	double *alt = results.alt.data();
+	double *tau = results.tau.data();
+	double *u = results.u.data();
+	double *sigma = results.sigma.data();
+
+	// pass 1: altitude and speed of each particle
+	for (int i=0; i<n; i++)
+	{
+		alt[i] = sqrt(x[i]*x[i] + y[i]*y[i] + z[i]*z[i]) - planet_r;
+		speed[i] = sqrt(vx[i]*vx[i] + vy[i]*vy[i] + vz[i]*vz[i]);
+		tau[i] = 0.0;
+	}
 
-// check to see if a collision occurred and initialize target particle if so
-bool Background_Species::check_collision(shared_ptr<Particle> p, double dt)
-{
-	vector<double> energy;
-	energy.resize(num_species);
-	double r = p->get_radius();
-	double my_total_v = p->get_total_v();
-	double alt = r - my_planet.get_radius();
-	double r_moved = my_planet.get_radius() + ref_height - r;
-
-	// get densities at current location
-	vector<double> dens;
-	dens.resize(num_species);
-
-	if (use_dens_profile)  // get new density from imported density profile
+	// pass 2: for each species, density and total cross section at each particle, accumulated into optical depth
+	for (int s=0; s<ns; s++)
 	{
-		for (int i=0; i<num_species; i++)
+		double *dens = &results.dens[s*n];
+		double *energy = &results.energy[s*n];
+		double *pvx = &results.partner_vx[s*n];
+		double *pvy = &results.partner_vy[s*n];
+		double *pvz = &results.partner_vz[s*n];
+		bool table = (N > 0) ? ((table_mask & (1u << s)) != 0) : db->has_sigma_table(s);
+
+		if (dprof)  // get new density from imported density profile
 		{
-			dens[i] = get_density(alt, i);
+			for (int i=0; i<n; i++)
+			{
+				dens[i] = db->get_density(alt[i], s);
+			}
 		}
-	}
-	else  // calculate new density based on reference scale height
-	{
-		for (int i=0; i<num_species; i++)
+		else  // calculate new density based on reference scale height
 		{
-			dens[i] = calc_new_density(bg_densities[i][0], bg_scaleheights[i][0], r_moved);
+			double ref_dens = db->get_ref_density(s);
+			double scaleheight = db->get_ref_scaleheight(s);
+			for (int i=0; i<n; i++)
+			{
+				dens[i] = db->calc_new_density(ref_dens, scaleheight, ref_height - alt[i]);
+			}
 		}
-	}
-
-	// look up total cross sections to use for each species, or use default if no table available
-	vector<double> total_sig;
-	total_sig.resize(num_species);
-	for (int i=0; i<num_species; i++)
-	{
-		double avg_v = 0.0;
 
-		// if default sigma is zero, then table is available, must initialize a particle to get energy
-		if (bg_sigma_defaults[i] == 0.0)
+		if (table)
 		{
-			if (use_temp_profile)
+			// sample a partner for every particle to get collision energies; partners are kept so
+			// a particle that collides with this species uses the partner it was tested against
+			double *v_avg = results.partner_v_avg.data();
+			for (int i=0; i<n; i++)
 			{
-				if (alt < profile_bottom_alt)
-				{
-					avg_v = bg_avg_v[i][0];
-				}
-				else if (alt > profile_top_alt)
-				{
-					avg_v = bg_avg_v[i].back();
-				}
-				else
-				{
-					avg_v = avg_v_interp[i]->loglinterp(alt);
-				}
+				v_avg[i] = temp ? db->get_avg_v(alt[i], s) : db->get_ref_avg_v(s);
 			}
-			else  // use reference temp avg_v
+			sampling::gen_gaussian3(n, v_avg, pvx, pvy, pvz);
+
+			double bg_mass = db->get_mass(s);
+			for (int i=0; i<n; i++)
 			{
-				avg_v = bg_avg_v[i][0];
+				energy[i] = calc_collision_e(species_table[parts.species[i]].mass, bg_mass, vx[i]-pvx[i], vy[i]-pvy[i], vz[i]-pvz[i]);
 			}
-			my_dist->init_vonly(bg_parts[i], avg_v);
 
-			// calculate collision energy and look up cross section
-			energy[i] = calc_collision_e(p, bg_parts[i]);
-			total_sig[i] = sigma_interp[i]->linterp(energy[i]);
+			for (int i=0; i<n; i++)
+			{
+				sigma[i] = db->get_sigma(s, energy[i]);
+			}
 		}
 		else  // just use default sigma if no lookup table available
 		{
-			total_sig[i] = bg_sigma_defaults[i];
+			double sigma_default = db->get_sigma_default(s);
+			for (int i=0; i<n; i++)
+			{
+				sigma[i] = sigma_default;
+			}
+		}
+
+		for (int i=0; i<n; i++)
+		{
+			tau[i] += speed[i]*dt*sigma[i]*dens[i];
 		}
 	}
 
-	// determine if test particle collided
-	double u = common::get_rand();
-	double tau = 0.0;
-	for (int i=0; i<num_species; i++)
+	// pass 3: determine which particles collided
+	for (int i=0; i<n; i++)
 	{
-		tau += 	my_total_v*dt*total_sig[i]*dens[i];
+		u[i] = common::get_rand();
 	}
-	if (u > exp(-tau))
+	int num_collided = 0;
+	for (int i=0; i<n; i++)
 	{
-		num_collisions++;
+		results.collided[i] = (u[i] > exp(-tau[i]));
+		num_collided += results.collided[i];
+	}
+	results.num_collided = num_collided;
+
+	// pass 4: pick target species and scattering angle for each collided particle
+	for (int i=0; i<n; i++)
+	{
+		if (!results.collided[i])
+		{
+			results.target[i] = -1;
+			continue;
+		}
 
-		// pick target species for collision
-		u = common::get_rand();
 		double total_dens = 0.0;
-		for (int i=0; i<num_species; i++)
+		for (int s=0; s<ns; s++)
 		{
-			total_dens += dens[i];
+			total_dens += results.dens[s*n + i];
 		}
+		double r = common::get_rand();
 		double frac = 0.0;
-		collision_target = 0;
+		int target = ns-1;
+		for (int s=0; s<ns; s++)
+		{
+			frac += results.dens[s*n + i] / total_dens;
+			if (r < frac)
+			{
+				target = s;
+				break;
+			}
+		}
+		results.target[i] = target;
 
-		do
+		double e = 0.0;
+		int k = target*n + i;
+		bool table = (N > 0) ? ((table_mask & (1u << target)) != 0) : db->has_sigma_table(target);
+		if (table)
+		{
+			results.target_vx[i] = results.partner_vx[k];
+			results.target_vy[i] = results.partner_vy[k];
+			results.target_vz[i] = results.partner_vz[k];
+			e = results.energy[k];
+		}
+		else  // partner needs to be initialized
 		{
-			frac += dens[collision_target] / total_dens;
-			collision_target++;
+			double v[] = {0.0, 0.0, 0.0};
+			sampling::gen_gaussian3(temp ? db->get_avg_v(alt[i], target) : db->get_ref_avg_v(target), v);
+			results.target_vx[i] = v[0];
+			results.target_vy[i] = v[1];
+			results.target_vz[i] = v[2];
+			e = calc_collision_e(species_table[parts.species[i]].mass, db->get_mass(target), vx[i]-v[0], vy[i]-v[1], vz[i]-v[2]);
 		}
-		while (u >= frac && collision_target < num_species);
+		results.theta[i] = db->find_new_theta(target, e, results.cos_theta[i], results.sin_theta[i]);
+	}
+}
 
-		// subtract the extra added integer, and initialize collision target if necessary
-		collision_target--;
+// elastic collision kinematics for every collided particle in parts, using the targets, angles, and partner
+// velocities found by check_collisions; each particle's velocity relative to the center of mass is deflected by
+// theta about its original direction with a uniformly sampled azimuth
+// the deflection uses an orthonormal basis built directly from the relative velocity, cos/sin theta from the
+// scattering tables, and an azimuth from common::get_rand_azimuth, so the arithmetic pass needs no trig
+void Background_Species::apply_collisions(Particle_Store &parts, Collision_Results &results) const
+{
+	const int n = parts.size;
+	int m = 0;
 
-		if (bg_sigma_defaults[collision_target] != 0.0)  // particle needs to be initialized
+	// pass 1: gather collided particles into packed arrays and draw their azimuths
+	for (int i=0; i<n; i++)
+	{
+		if (results.collided[i])
 		{
-			if (use_temp_profile)
+			double targ_mass = db->get_mass(results.target[i]);
+			results.col_index[m] = i;
+			results.col_vx[m] = parts.vx[i];
+			results.col_vy[m] = parts.vy[i];
+			results.col_vz[m] = parts.vz[i];
+			results.col_tvx[m] = results.target_vx[i];
+			results.col_tvy[m] = results.target_vy[i];
+			results.col_tvz[m] = results.target_vz[i];
+			results.col_mfrac[m] = targ_mass / (species_table[parts.species[i]].mass + targ_mass);
+			results.col_cos_theta[m] = results.cos_theta[i];
+			results.col_sin_theta[m] = results.sin_theta[i];
+			if (results.preset_azimuth)
 			{
-				double avg_v = 0.0;
-				if (alt < profile_bottom_alt)
-				{
-					avg_v = bg_avg_v[collision_target][0];
-				}
-				else if (alt > profile_top_alt)
-				{
-					avg_v = bg_avg_v[collision_target].back();
-				}
-				else
-				{
-					avg_v = avg_v_interp[collision_target]->loglinterp(alt);
-				}
-				my_dist->init_vonly(bg_parts[collision_target], avg_v);
+				results.col_cos_phi[m] = cos(results.azimuth[i]);
+				results.col_sin_phi[m] = sin(results.azimuth[i]);
 			}
 			else
 			{
-				my_dist->init_vonly(bg_parts[collision_target], bg_avg_v[collision_target][0]);
+				common::get_rand_azimuth(results.col_cos_phi[m], results.col_sin_phi[m]);
 			}
-			energy[collision_target] = calc_collision_e(p, bg_parts[collision_target]);
+			m++;
 		}
-		collision_theta = find_new_theta(collision_target, energy[collision_target]);
-		return true;
 	}
-	else
-	{
-		collision_target = -1;
-		return false;
-	}
-}
 
-// scans imported differential scattering CDF for new collision theta
-double Background_Species::find_new_theta(int part_index, double energy)
-{
-	// get energy index
-	int energy_index = 0;
-	int num_energies = diff_sigma_energies[part_index].size();
-	if (energy <= diff_sigma_energies[part_index][0])
+	double *vx = results.col_vx.data();
+	double *vy = results.col_vy.data();
+	double *vz = results.col_vz.data();
+	const double *tvx = results.col_tvx.data();
+	const double *tvy = results.col_tvy.data();
+	const double *tvz = results.col_tvz.data();
+	const double *mfrac = results.col_mfrac.data();
+	const double *ct = results.col_cos_theta.data();
+	const double *st = results.col_sin_theta.data();
+	const double *cp = results.col_cos_phi.data();
+	const double *sp = results.col_sin_phi.data();
+
+	// pass 2: new velocities (vectorizable)
+	for (int j=0; j<m; j++)
 	{
-		energy_index = 0;
+		// velocity relative to center of mass, w = (m2/(m1+m2))*(v1 - v2)
+		double wx = mfrac[j]*(vx[j] - tvx[j]);
+		double wy = mfrac[j]*(vy[j] - tvy[j]);
+		double wz = mfrac[j]*(vz[j] - tvz[j]);
+		double w = sqrt(wx*wx + wy*wy + wz*wz);
+		double v = sqrt(vx[j]*vx[j] + vy[j]*vy[j] + vz[j]*vz[j]);
+		double inv_v = (v > 0.0) ? 1.0/v : 0.0;
+
+		// unit vector along the particle's velocity (theta is measured from it), and two unit vectors orthogonal to it
+		double ux = vx[j]*inv_v;
+		double uy = vy[j]*inv_v;
+		double uz = vz[j]*inv_v;
+		double sign = copysign(1.0, uz);
+		double a = -1.0 / (sign + uz);
+		double b = ux*uy*a;
+		double e1x = 1.0 + sign*ux*ux*a;
+		double e1y = sign*b;
+		double e1z = -sign*ux;
+		double e2x = b;
+		double e2y = sign + uy*uy*a;
+		double e2z = -uy;
+
+		// new velocity is center-of-mass velocity plus w turned to angle theta from the original direction
+		double dx = ct[j]*ux + st[j]*(cp[j]*e1x + sp[j]*e2x);
+		double dy = ct[j]*uy + st[j]*(cp[j]*e1y + sp[j]*e2y);
+		double dz = ct[j]*uz + st[j]*(cp[j]*e1z + sp[j]*e2z);
+		vx[j] = vx[j] - wx + w*dx;
+		vy[j] = vy[j] - wy + w*dy;
+		vz[j] = vz[j] - wz + w*dz;
 	}
-	else if (energy >= diff_sigma_energies[part_index].back())
+
+	// pass 3: scatter new velocities back
+	for (int j=0; j<m; j++)
 	{
-		energy_index = num_energies - 1;
+		int i = results.col_index[j];
+		parts.vx[i] = vx[j];
+		parts.vy[i] = vy[j];
+		parts.vz[i] = vz[j];
 	}
-	else
+}
+
+// resolve the background species set into a batched collision kernel; specialized kernels exist for
+// the standard atmospheres (1 to 5 species with cross section tables and imported profiles, or
+// all default cross sections with reference scale heights), anything else uses the generic kernel
+void Background_Species::select_collision_kernel()
+{
+	unsigned table_mask = 0;
+	for (int i=0; i<num_species; i++)
 	{
-		double difference = INFINITY;
-		for (int i=0; i<num_energies; i++)
+		if (db->has_sigma_table(i))
 		{
-			double new_diff = abs(energy - diff_sigma_energies[part_index][i]);
-			if (new_diff < difference)
-			{
-				difference = new_diff;
-				energy_index = i;
-			}
+			table_mask |= (1u << i);
 		}
 	}
+	unsigned all_tables = (1u << num_species) - 1;
+	bool temp_profile = db->uses_temp_profile();
+	bool dens_profile = db->uses_dens_profile();
 
-	// search CDF for angle
-	double u = common::get_rand();
-	int k = 0;
-	while (diff_sigma_CDFs[part_index][energy_index][0][k] < u)
+	collision_kernel = &Background_Species::check_collisions_kernel<0, 0x0, false, false>;
+	if (temp_profile && dens_profile && table_mask == all_tables)
 	{
-		k++;
+		switch (num_species)
+		{
+		case 1: collision_kernel = &Background_Species::check_collisions_kernel<1, 0x1, true, true>; break;
+		case 2: collision_kernel = &Background_Species::check_collisions_kernel<2, 0x3, true, true>; break;
+		case 3: collision_kernel = &Background_Species::check_collisions_kernel<3, 0x7, true, true>; break;
+		case 4: collision_kernel = &Background_Species::check_collisions_kernel<4, 0xF, true, true>; break;
+		case 5: collision_kernel = &Background_Species::check_collisions_kernel<5, 0x1F, true, true>; break;
+		}
 	}
-	return diff_sigma_CDFs[part_index][energy_index][1][k];
-}
-
-// get density from imported density profile
-double Background_Species::get_density(double alt, int index)
-{
-	double current_dens = 0.0;
-
-	// if outside of profile boundaries, need to extrapolate using a scale height
-	if (alt < profile_bottom_alt)
+	else if (!temp_profile && !dens_profile && table_mask == 0)
 	{
-		current_dens = calc_new_density(bg_densities[index][0], bg_scaleheights[index][0], profile_bottom_alt - alt);
+		switch (num_species)
+		{
+		case 1: collision_kernel = &Background_Species::check_collisions_kernel<1, 0x0, false, false>; break;
+		case 2: collision_kernel = &Background_Species::check_collisions_kernel<2, 0x0, false, false>; break;
+		case 3: collision_kernel = &Background_Species::check_collisions_kernel<3, 0x0, false, false>; break;
+		case 4: collision_kernel = &Background_Species::check_collisions_kernel<4, 0x0, false, false>; break;
+		case 5: collision_kernel = &Background_Species::check_collisions_kernel<5, 0x0, false, false>; break;
+		}
 	}
-	else if (alt > profile_top_alt)
+
+	if (collision_kernel == &Background_Species::check_collisions_kernel<0, 0x0, false, false>)
 	{
-		current_dens = calc_new_density(bg_densities[index].back(), bg_scaleheights[index][1], profile_top_alt - alt);
+		cout << "Using generic collision kernel for " << num_species << " background species\n";
 	}
 	else
 	{
-		current_dens = dens_interp[index]->loglinterp(alt);
+		cout << "Using specialized collision kernel for " << num_species << " background species\n";
 	}
-
-	return current_dens;
 }
 
 int Background_Species::get_num_collisions()
@@ -446,7 +578,7 @@ int Background_Species::get_num_collisions()
 	return num_collisions;
 }
 
-shared_ptr<Particle> Background_Species::get_collision_target()
+const Particle &Background_Species::get_collision_target() const
 {
 	return bg_parts[collision_target];
 }
@@ -456,62 +588,13 @@ double Background_Species::get_collision_theta()
 	return collision_theta;
 }
 
-// make a new differential cross section CDF and store at diff_sigma_CDFs[part_index][energy_index]
-void Background_Species::make_new_CDF(int part_index, int energy_index, vector<double> &angle, vector<double> &sigma)
+// species id (index into species_table) of background species target
+int Background_Species::get_target_species(int target) const
 {
-	int num_angles = angle.size();
-	diff_sigma_CDFs[part_index][energy_index][0].resize(num_angles);
-	diff_sigma_CDFs[part_index][energy_index][1].resize(num_angles);
-
-	double sig_total = 0.0;
-	for (int i=0; i<num_angles; i++)
-	{
-		diff_sigma_CDFs[part_index][energy_index][1][i] = angle[i] * (constants::pi / 180.0);
-		sigma[i] = sigma[i] * sin(angle[i]*constants::pi/180.0);
-		sig_total = sig_total + sigma[i];
-	}
-	for (int i=0; i<num_angles; i++)
-	{
-		if (i == 0)
-		{
-			diff_sigma_CDFs[part_index][energy_index][0][i] = sigma[i] / sig_total;
-		}
-		else
-		{
-			diff_sigma_CDFs[part_index][energy_index][0][i] = (sigma[i] / sig_total) + diff_sigma_CDFs[part_index][energy_index][0][i-1];
-		}
-	}
+	return db->get_bg_species(target);
 }
 
-//subroutine to set particle types
-shared_ptr<Particle> Background_Species::set_particle_type(string type)
+shared_ptr<const Atmosphere_Database> Background_Species::get_database() const
 {
-	shared_ptr<Particle> p;
-
-	if (type == "H")
-	{
-		p = make_shared<Particle_H>();
-	}
-	else if (type == "O")
-	{
-		p = make_shared<Particle_O>();
-	}
-	else if (type == "N2")
-	{
-		p = make_shared<Particle_N2>();
-	}
-	else if (type == "CO")
-	{
-		p = make_shared<Particle_CO>();
-	}
-	else if (type == "CO2")
-	{
-		p = make_shared<Particle_CO2>();
-	}
-	else
-	{
-		cout << "Invalid particle type specified! Please check configuration file.\n";
-		exit(1);
-	}
-	return p;
+	return db;
 }
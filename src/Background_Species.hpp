@@ -12,78 +12,84 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
-#include "Particle_CO.hpp"
-#include "Particle_CO2.hpp"
-#include "Particle_H.hpp"
-#include "Particle_N2.hpp"
-#include "Particle_O.hpp"
-#include "Distribution_MB.hpp"
-#include "Planet.hpp"
-#include "Common_Functions.hpp"
-#include "Interpolator.hpp"
+#include "Particle.hpp"
+#include "Sampling.hpp"
+#include "Atmosphere_Database.hpp"
+#include "Particle_Store.hpp"
 using namespace std;
 
+// per-particle outputs of Background_Species::check_collisions, plus scratch space for its batched passes
+// each caller owns its own instance, so checking a batch leaves no state behind in Background_Species
+struct Collision_Results {
+	int num_collided;             // number of particles in the batch that collided
+	vector<char> collided;        // 1 if particle collided during this step
+	vector<int> target;           // index of background species collided with (-1 if no collision)
+	vector<double> theta;         // scattering angle [rad]
+	vector<double> cos_theta;     // cosine and sine of scattering angle, from precomputed tables
+	vector<double> sin_theta;
+	vector<double> target_vx;     // velocity of sampled collision partner [cm/s]
+	vector<double> target_vy;
+	vector<double> target_vz;
+	vector<double> speed;         // total speed of each particle at time of check [cm/s]
+	bool preset_azimuth;          // if set, apply_collisions deflects by azimuth[i] instead of drawing one
+	vector<double> azimuth;       // deflection azimuth of each particle [rad] (coupled collisions only)
+
+	// scratch space; per-species arrays are indexed [species*n + particle]
+	vector<double> alt, tau, u, sigma, partner_v_avg;
+	vector<double> dens, energy, partner_vx, partner_vy, partner_vz;
+
+	// scratch space for apply_collisions, packed over collided particles only
+	vector<int> col_index;
+	vector<double> col_vx, col_vy, col_vz, col_tvx, col_tvy, col_tvz, col_mfrac;
+	vector<double> col_cos_theta, col_sin_theta, col_cos_phi, col_sin_phi;
+
+	void resize(int n, int num_species);
+};
+
+class Background_Species;
+
+// batched collision check kernel selected at startup for the configured background species set
+typedef void (Background_Species::*Collision_Kernel)(const Particle_Store &parts, double dt, Collision_Results &results) const;
+
+// per-run collision state and kernels for a background atmosphere; the tabulated data lives in a shared,
+// read-only Atmosphere_Database, so copying a Background_Species is cheap
 class Background_Species {
 public:
 	Background_Species();
-	Background_Species(int num_parts, string config_files[], Planet p, double ref_T, double ref_h, string temp_profile_filename, string dens_profile_filename, double profile_bottom, double profile_top);
+	Background_Species(shared_ptr<const Atmosphere_Database> database);
 	virtual ~Background_Species();
-	bool check_collision(shared_ptr<Particle> p, double dt);
+	void check_collisions(const Particle_Store &parts, double dt, Collision_Results &results) const;
+	void apply_collisions(Particle_Store &parts, Collision_Results &results) const;
+	void estimate_collision_rates(const Particle_Store &parts, double rates[]) const;
+	void collide_coupled(Particle_Store &parts, double dt, double clock[], int events[], Collision_Results &results) const;
+	bool check_collision(const Particle &p, double dt);
 	int get_num_collisions();
-	shared_ptr<Particle> get_collision_target();
+	const Particle &get_collision_target() const;
 	double get_collision_theta();
+	int get_target_species(int target) const;
+	shared_ptr<const Atmosphere_Database> get_database() const;
 
 private:
-	bool use_temp_profile;       // flag for whether or not temperature profile is available
-	bool use_dens_profile;       // flag for whether or not density profile is available
-	int num_species;             // number of background species in atmosphere
-	int num_collisions;          // tracks total number of collisions during simulation
-	int collision_target;        // index of particle in bg_parts to be used for next collision
-	Planet my_planet;            // contains planet mass, radius, and gravitational constant
-	double collision_theta;      // angle (in radians) to be used for next collision
-	double ref_temp;             // temperature (in Kelvin) at reference height
-	double ref_height;           // height (in cm above planet surface) to extrapolate densities from if no profile available
-	double ref_g;                // acceleration due to gravity (G*M/r^2) at reference height
-	shared_ptr<Distribution_MB> my_dist;    // distribution to be used for initialization of bg particles
-	vector<shared_ptr<Particle>> bg_parts;  // array of pointers to child particle classes
-	double profile_bottom_alt;            // altitude above surface (cm) where atmospheric profiles begin
-	double profile_top_alt;               // altitude above surface (cm) where atmospheric profiles end
-	vector<double> temp_alt_bins;         // altitude bins from imported temperature profile
-	vector<double> Tn;                    // neutral species temperature profile
-	shared_ptr<Interpolator> Tn_interp;   // interpolator for neutral temp profile
-	vector<double> Ti;                    // ionic species temperature profile
-	shared_ptr<Interpolator> Ti_interp;   // interpolator for ion temp profile
-	vector<double> Te;                    // electron temperature profile
-	shared_ptr<Interpolator> Te_interp;   // interpolator for electron temp profile
-	vector<double> dens_alt_bins;         // array of altitude bins imported along with densities
-	vector<vector<double>> bg_densities;  // array of densities for each particle in bg_parts
-	vector<shared_ptr<Interpolator>> dens_interp;  // density interpolator objects
-	vector<double> bg_sigma_defaults;     // array of default total cross sections for each particle
-	vector<vector<vector<double>>> bg_sigma_tables;  // lookup tables for total cross sections
-	vector<shared_ptr<Interpolator>> sigma_interp;  // total sigma interpolator objects
-	vector<vector<double>> bg_scaleheights;       // array of scale heights for each particle type
-	vector<vector<double>> bg_avg_v;      // array of average (thermal) velocities for each particle
-	vector<shared_ptr<Interpolator>> avg_v_interp;   // avg_v interpolator objects
-	vector<vector<double>> diff_sigma_energies;              // array of available differential cross section energies for each species
-	vector<vector<vector<vector<double>>>> diff_sigma_CDFs;  // CDFs built from imported differential cross section tables; used for looking up scattering angles
-
-	// returns collision energy in eV between particle 1 and particle 2
-	double calc_collision_e(shared_ptr<Particle> p1, shared_ptr<Particle> p2);
-
-	// calculates new density of background particle based on radial position and scale height
-	double calc_new_density(double ref_density, double scale_height, double r_moved);
-
-	// scans imported differential scattering CDF for new collision theta
-	double find_new_theta(int part_index, double energy);
+	shared_ptr<const Atmosphere_Database> db;   // tabulated atmosphere and cross section data, shared read-only
+	int num_species;             // number of background species in atmosphere (from db)
+	int num_collisions;          // tracks number of collisions found through check_collision
+	int collision_target;        // index of particle in bg_parts to be used for next collision (check_collision only)
+	double collision_theta;      // angle (in radians) to be used for next collision (check_collision only)
+	vector<Particle> bg_parts;             // one particle of each background species, reinitialized as a collision partner
+	Collision_Kernel collision_kernel;    // kernel used by check_collisions; set by select_collision_kernel
+	Particle_Store single_part;           // batch of one used by check_collision
+	Collision_Results single_results;     // results for single_part
 
-	// get density from imported density profile if available
-	double get_density(double alt, int index);
+	// batched collision check; specialized at compile time for N background species
+	// (bit i of table_mask set if species i uses a total cross section table), or generic when N is 0
+	template<int N, unsigned table_mask, bool temp_profile, bool dens_profile>
+	void check_collisions_kernel(const Particle_Store &parts, double dt, Collision_Results &results) const;
 
-	// make a new differential cross section CDF and store at diff_sigma_CDFs[index]
-	void make_new_CDF(int part_index, int energy_index, vector<double> &angle, vector<double> &sigma);
+	// resolve the background species set into a specialized collision kernel, or the generic one
+	void select_collision_kernel();
 
-	//subroutine to set particle type
-	shared_ptr<Particle> set_particle_type(string type);
+	// returns collision energy in eV between particles of mass m1 and m2 with relative velocity dv
+	double calc_collision_e(double m1, double m2, double dvx, double dvy, double dvz) const;
 };
 
 #endif /* BACKGROUND_SPECIES_HPP_ */
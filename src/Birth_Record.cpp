@@ -0,0 +1,114 @@
+/*
+ * Birth_Record.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Birth_Record.hpp"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+void Birth_Record::init(int parts, int first, int groups, int alt_bins, double step, double radius, double rate)
+{
+	num_parts = parts;
+	first_group = first;
+	num_groups = groups;
+	num_alt_bins = alt_bins;
+	dt = step;
+	planet_radius = radius;
+	global_rate = rate;
+	births.assign(num_groups, 0.0);
+	escapes_day.assign(num_groups, 0.0);
+	escapes_night.assign(num_groups, 0.0);
+	dens_day.assign((size_t)num_groups*num_alt_bins, 0.0);
+	dens_night.assign((size_t)num_groups*num_alt_bins, 0.0);
+	coldens_day.assign((size_t)num_groups*num_alt_bins, 0.0);
+}
+
+int Birth_Record::get_group(double alt) const
+{
+	int g = (int)(1e-5*alt) - first_group;
+	return max(0, min(g, num_groups-1));
+}
+
+void Birth_Record::write(string filename) const
+{
+	Birth_Record_Header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, birth_record_magic, sizeof(birth_record_magic));
+	h.version = birth_record_version;
+	h.num_parts = num_parts;
+	h.first_group = first_group;
+	h.num_groups = num_groups;
+	h.num_alt_bins = num_alt_bins;
+	h.dt = dt;
+	h.planet_radius = planet_radius;
+	h.global_rate = global_rate;
+
+	ofstream outfile(filename, ios::binary);
+	if (!outfile.good())
+	{
+		cout << "Could not open \"" << filename << "\" for writing!\n";
+		return;
+	}
+	outfile.write((const char *)&h, sizeof(h));
+	for (const vector<double> *v : {&births, &escapes_day, &escapes_night, &dens_day, &dens_night, &coldens_day})
+	{
+		outfile.write((const char *)v->data(), v->size()*sizeof(double));
+	}
+	outfile.close();
+}
+
+// returns false and sets error if filename is missing, not a birth record of this version, or not the size its
+// header gives (checked before anything is allocated from the header's counts)
+bool Birth_Record::read(string filename, string &error)
+{
+	ifstream infile(filename, ios::binary);
+	if (!infile.good())
+	{
+		error = "not found";
+		return false;
+	}
+	infile.seekg(0, ios::end);
+	streamoff file_size = infile.tellg();
+	infile.seekg(0, ios::beg);
+
+	Birth_Record_Header h;
+	infile.read((char *)&h, sizeof(h));
+	if (!infile.good() || memcmp(h.magic, birth_record_magic, sizeof(birth_record_magic)) != 0)
+	{
+		error = "not a birth record";
+		return false;
+	}
+	if (h.version != birth_record_version)
+	{
+		error = "birth record version " + to_string(h.version) + ", expected " + to_string(birth_record_version);
+		return false;
+	}
+	if (h.num_groups < 1 || h.num_alt_bins < 1)
+	{
+		error = "header has " + to_string(h.num_groups) + " birth groups and " + to_string(h.num_alt_bins) + " altitude bins";
+		return false;
+	}
+	uint64_t num_values = 3*(uint64_t)h.num_groups + 3*(uint64_t)h.num_groups*(uint64_t)h.num_alt_bins;
+	if ((uint64_t)file_size != sizeof(h) + num_values*sizeof(double))
+	{
+		error = "file size " + to_string(file_size) + " bytes does not match the header (" + to_string(h.num_groups) + " birth groups, "
+				+ to_string(h.num_alt_bins) + " altitude bins)";
+		return false;
+	}
+
+	init(h.num_parts, h.first_group, h.num_groups, h.num_alt_bins, h.dt, h.planet_radius, h.global_rate);
+	for (vector<double> *v : {&births, &escapes_day, &escapes_night, &dens_day, &dens_night, &coldens_day})
+	{
+		infile.read((char *)v->data(), v->size()*sizeof(double));
+	}
+	if (!infile.good())
+	{
+		error = "read error";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,69 @@
+/*
+ * Birth_Record.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef BIRTH_RECORD_HPP_
+#define BIRTH_RECORD_HPP_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+using namespace std;
+
+// tallies of a run split by the birth altitude of the particles that made them, so that corona3d_reweight can
+// recompute the outputs for a different source altitude profile by weighting each birth group with the ratio of its
+// new to its recorded share of births (valid when the source's energy and direction distributions at a given
+// altitude are unchanged, e.g. for a different ion density profile of the same mechanism)
+//
+// birth groups are 1 km altitude bins starting at first_group [km above surface]; output altitude bins are the 1 km
+// bins of density1d and column_density from 0 to num_alt_bins-1
+//
+// file layout (native byte order): Birth_Record_Header, then births, escapes_day and escapes_night (num_groups
+// doubles each), then dens_day, dens_night and coldens_day (num_groups x num_alt_bins doubles each, group-major)
+const char birth_record_magic[8] = {'C', '3', 'D', 'B', 'R', 'E', 'C', '\0'};
+const uint32_t birth_record_version = 1;
+
+struct Birth_Record_Header {
+	char magic[8];            // birth_record_magic
+	uint32_t version;         // birth_record_version
+	int32_t num_parts;        // particles in the run
+	int32_t first_group;      // birth altitude of group 0 [km]
+	int32_t num_groups;       // number of birth groups
+	int32_t num_alt_bins;     // number of output altitude bins
+	int32_t padding;
+	double dt;                // time step of the run [s]
+	double planet_radius;     // [cm]
+	double global_rate;       // global production rate of the run [s^-1]
+};
+
+struct Birth_Record {
+	int num_parts;
+	int first_group;
+	int num_groups;
+	int num_alt_bins;
+	double dt;
+	double planet_radius;
+	double global_rate;
+	vector<double> births;          // particles born in each group
+	vector<double> escapes_day;     // escapes of the particles born in each group
+	vector<double> escapes_night;
+	vector<double> dens_day;        // density1d counts by group and altitude bin: [group*num_alt_bins + bin]
+	vector<double> dens_night;
+	vector<double> coldens_day;     // dayside column density counts by group and altitude bin
+
+	// set sizes and zero all tallies
+	void init(int parts, int first, int groups, int alt_bins, double step, double radius, double rate);
+
+	// returns birth group of a particle born at altitude alt [cm], clamped to the record's groups
+	int get_group(double alt) const;
+
+	void write(string filename) const;
+
+	// returns false and sets error if filename is missing, not a birth record of this version, or truncated
+	bool read(string filename, string &error);
+};
+
+#endif /* BIRTH_RECORD_HPP_ */
@@ -6,6 +6,10 @@
  */
 
 #include "Common_Functions.hpp"
+#include "Table_Bundle.hpp"
+#include <charconv>
+#include <cstring>
+#include <sys/stat.h>
 
 // function to check if custom random seed exists in local file "rng_seed"
 // if file does not exist, uses system clock to generate seed
@@ -31,193 +35,274 @@ static long long get_seed()
 // seed random number generator using get_seed() function above
 // to access externally, must include "Common_Functions.hpp" and call
 // using common::get_rand() (will return uniform real between 0 and 1)
+// each thread has its own generator; threads other than the main thread must call common::set_rand_stream
+// before drawing numbers, or they would repeat the main thread's sequence
 static long long seed = get_seed();
-static mt19937 rand_generator(seed);   // Mersenne Twister PRNG (apparently, pretty good)
-static uniform_real_distribution<double> rand_dist(0.0, 1.0);  // dist to be used with get_rand()
-
-namespace constants {
-	const double pi    = M_PI;            // pi [unitless]
-	const double twopi = 2*pi;             // 2*pi [unitless]
-	const double k_b   = 1.380649e-16;     // Boltzmann's Constant [erg/K]
-	const double c     = 29979245800.0;    // Speed of Light in Vacuum [cm/s]
-	const double G     = 6.67430e-8;       // Gravitational Constant [cm^3/g/s^2]
-	const double amu   = 1.660538782e-24;  // Atomic Mass Unit [g]
-	const double m_e   = 9.10938215e-28;   // Electron Mass [g]
-	const double q_e   = 1.602176487e-19;  // Elementary Charge [C]
-	const double jev   = q_e;              // Joules/Electron Volt [unitless]
-	const double ergev = jev*1.0e7;        // ergs/Electron Volt [unitless]
-}
+static thread_local mt19937 rand_generator(seed);   // Mersenne Twister PRNG (apparently, pretty good)
+static thread_local uniform_real_distribution<double> rand_dist(0.0, 1.0);  // dist to be used with get_rand()
 
-namespace common {
+// bundle of pre-packed input tables (see corona3d_pack), if one is in use
+static shared_ptr<Table_Bundle> table_bundle;
 
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2)
+// fill table from the table bundle, if one is in use and holds an up-to-date copy of filename;
+// returns false if the table has to be read from the csv file instead
+static bool read_from_bundle(const string &filename, Csv_Table &table)
+{
+	if (!table_bundle)
 	{
-		ifstream infile;
-		infile.open(filename);
-		if (!infile.good())
+		return false;
+	}
+	int index = table_bundle->find(filename);
+	if (index < 0)
+	{
+		return false;
+	}
+	if (!table_bundle->is_current(index))
+	{
+		cout << "\"" << filename << "\" has changed since table bundle was packed; reading csv file instead\n";
+		return false;
+	}
+
+	int num_rows = table_bundle->get_num_rows(index);
+	int num_cols = table_bundle->get_num_cols(index);
+	table.names = table_bundle->get_column_names(index);
+	table.columns.resize(num_cols);
+	for (int i=0; i<num_cols; i++)
+	{
+		const double *col = table_bundle->get_column(index, i);
+		table.columns[i].assign(col, col + num_rows);
+	}
+	return true;
+}
+
+// split a '#' header line such as "#alt(cm),O(cm-3),N2(cm-3)" into trimmed column names
+static vector<string> split_header(const char *begin, const char *end)
+{
+	vector<string> names;
+	begin++;  // skip '#'
+	while (true)
+	{
+		const char *comma = (const char *)memchr(begin, ',', end - begin);
+		const char *field_end = (comma == NULL) ? end : comma;
+		const char *b = begin;
+		const char *e = field_end;
+		while (b < e && isspace((unsigned char)*b))
 		{
-			cout << "\"" << filename << "\" not found!\n";
-			exit(1);
+			b++;
 		}
-		string line, word;
-		vector<string> row;
-		while (getline(infile, line))
+		while (e > b && isspace((unsigned char)*(e-1)))
 		{
-			row.clear();
-			if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
-			{
-				continue;
-			}
-			else
-			{
-				stringstream str(line);
-				while(getline(str, word, ','))
-				{
-					row.push_back(word);
-				}
-				col1.push_back(stod(row[0]));
-				col2.push_back(stod(row[1]));
-			}
+			e--;
 		}
-		infile.close();
+		names.push_back(string(b, e));
+		if (comma == NULL)
+		{
+			break;
+		}
+		begin = comma + 1;
 	}
+	return names;
+}
+
+// parse csv text in buf into table; on failure sets error to a description and returns false
+// comment lines start with '#'; the last comment line containing commas before the first data row
+// is taken as the header of column names; the number of columns is set by the first data row
+static bool parse_csv(const string &buf, Csv_Table &table, string &error)
+{
+	const char *p = buf.data();
+	const char *end = p + buf.size();
+	int num_cols = 0;
+	int line_num = 0;
 
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3)
+	while (p < end)
 	{
-		ifstream infile;
-		infile.open(filename);
-		if (!infile.good())
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+		if (eol == NULL)
 		{
-			cout << "\"" << filename << "\" not found!\n";
-			exit(1);
+			eol = end;
+		}
+		const char *line_end = eol;
+		if (line_end > p && *(line_end-1) == '\r')
+		{
+			line_end--;
 		}
-		string line, word;
-		vector<string> row;
-		while (getline(infile, line))
+		line_num++;
+
+		const char *q = p;
+		while (q < line_end && isspace((unsigned char)*q))
 		{
-			row.clear();
-			if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
+			q++;
+		}
+		if (q == line_end)  // blank line
+		{
+			p = eol + 1;
+			continue;
+		}
+		if (*q == '#')
+		{
+			if (num_cols == 0 && memchr(q, ',', line_end - q) != NULL)
+			{
+				table.names = split_header(q, line_end);
+			}
+			p = eol + 1;
+			continue;
+		}
+
+		int col = 0;
+		while (true)
+		{
+			while (q < line_end && (*q == ' ' || *q == '\t'))
+			{
+				q++;
+			}
+			if (q == line_end && col > 0)  // trailing comma
+			{
+				break;
+			}
+			if (q < line_end && *q == '+')
+			{
+				q++;
+			}
+			double val = 0.0;
+			from_chars_result r = from_chars(q, line_end, val);
+			if (r.ec != errc())
 			{
-				continue;
+				error = "invalid number on line " + to_string(line_num);
+				return false;
 			}
-			else
+
+			if (num_cols == 0)
 			{
-				stringstream str(line);
-				while(getline(str, word, ','))
-				{
-					row.push_back(word);
-				}
-				col1.push_back(stod(row[0]));
-				col2.push_back(stod(row[1]));
-				col3.push_back(stod(row[2]));
+				table.columns.push_back(vector<double>());
 			}
+			if (num_cols == 0 || col < num_cols)
+			{
+				table.columns[col].push_back(val);
+			}
+			col++;
+
+			// only whitespace may separate a number from the next comma or the end of the line
+			q = r.ptr;
+			while (q < line_end && (*q == ' ' || *q == '\t'))
+			{
+				q++;
+			}
+			if (q == line_end)
+			{
+				break;
+			}
+			if (*q != ',')
+			{
+				error = "unexpected characters after number on line " + to_string(line_num);
+				return false;
+			}
+			q++;
 		}
-		infile.close();
+
+		if (num_cols == 0)
+		{
+			num_cols = col;
+		}
+		else if (col < num_cols)
+		{
+			error = "line " + to_string(line_num) + " has fewer than " + to_string(num_cols) + " columns";
+			return false;
+		}
+		p = eol + 1;
 	}
+	return true;
+}
+
+int Csv_Table::get_num_rows() const
+{
+	return columns.empty() ? 0 : columns[0].size();
+}
 
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3, vector<double> &col4)
+int Csv_Table::get_num_cols() const
+{
+	return columns.size();
+}
+
+// index of column whose header name is name, either exactly or ignoring a trailing unit in () or []
+// (so "O" finds "O(cm-3)"); returns -1 if there is no such column
+int Csv_Table::find_column(string name) const
+{
+	int num_names = names.size();
+	for (int i=0; i<num_names && i<get_num_cols(); i++)
 	{
-		ifstream infile;
-		infile.open(filename);
-		if (!infile.good())
+		string col_name = names[i].substr(0, names[i].find_first_of("(["));
+		if (names[i] == name || col_name == name)
 		{
-			cout << "\"" << filename << "\" not found!\n";
-			exit(1);
+			return i;
 		}
-		string line, word;
-		vector<string> row;
-		while (getline(infile, line))
+	}
+	return -1;
+}
+
+namespace common {
+
+	// read csv file (or its copy in the table bundle, if one is in use) into a column-major table; exits
+	// if the file is missing, malformed, or has fewer than min_cols columns
+	Csv_Table read_csv(string filename, int min_cols)
+	{
+		Csv_Table table;
+		if (!read_from_bundle(filename, table))
 		{
-			row.clear();
-			if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
+			string error;
+			if (!try_read_csv(filename, table, error))
 			{
-				continue;
-			}
-			else
-			{
-				stringstream str(line);
-				while(getline(str, word, ','))
-				{
-					row.push_back(word);
-				}
-				col1.push_back(stod(row[0]));
-				col2.push_back(stod(row[1]));
-				col3.push_back(stod(row[2]));
-				col4.push_back(stod(row[3]));
+				cout << "\"" << filename << "\": " << error << "!\n";
+				exit(1);
 			}
 		}
-		infile.close();
+		if (table.get_num_cols() < min_cols)
+		{
+			cout << "\"" << filename << "\" has fewer than " << min_cols << " columns!\n";
+			exit(1);
+		}
+		return table;
 	}
 
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3, vector<double> &col4, vector<double> &col5)
+	// read csv file into table without using the table bundle; returns false and sets error on failure
+	bool try_read_csv(string filename, Csv_Table &table, string &error)
 	{
-		ifstream infile;
-		infile.open(filename);
+		// size from stat, so that a directory, pipe or other non-regular file is treated like a missing file
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			error = "not found";
+			return false;
+		}
+		ifstream infile(filename, ios::binary);
 		if (!infile.good())
 		{
-			cout << "\"" << filename << "\" not found!\n";
-			exit(1);
+			error = "not found";
+			return false;
 		}
-		string line, word;
-		vector<string> row;
-		while (getline(infile, line))
+		string buf(st.st_size, '\0');
+		infile.read(&buf[0], buf.size());
+		if (infile.gcount() != (streamsize)buf.size())
 		{
-			row.clear();
-			if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
-			{
-				continue;
-			}
-			else
-			{
-				stringstream str(line);
-				while(getline(str, word, ','))
-				{
-					row.push_back(word);
-				}
-				col1.push_back(stod(row[0]));
-				col2.push_back(stod(row[1]));
-				col3.push_back(stod(row[2]));
-				col4.push_back(stod(row[3]));
-				col5.push_back(stod(row[4]));
-			}
+			error = "could not be read";
+			return false;
 		}
 		infile.close();
+
+		table.names.clear();
+		table.columns.clear();
+		return parse_csv(buf, table, error);
 	}
 
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3, vector<double> &col4, vector<double> &col5, vector<double> &col6)
+	// use the table bundle in filename (written by corona3d_pack) for any table it holds
+	void use_table_bundle(string filename)
 	{
-		ifstream infile;
-		infile.open(filename);
-		if (!infile.good())
+		table_bundle = make_shared<Table_Bundle>();
+		if (!table_bundle->open(filename))
 		{
-			cout << "\"" << filename << "\" not found!\n";
+			cout << "Table bundle \"" << filename << "\" not found or not a valid bundle! Rebuild it with corona3d_pack.\n";
 			exit(1);
 		}
-		string line, word;
-		vector<string> row;
-		while (getline(infile, line))
-		{
-			row.clear();
-			if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
-			{
-				continue;
-			}
-			else
-			{
-				stringstream str(line);
-				while(getline(str, word, ','))
-				{
-					row.push_back(word);
-				}
-				col1.push_back(stod(row[0]));
-				col2.push_back(stod(row[1]));
-				col3.push_back(stod(row[2]));
-				col4.push_back(stod(row[3]));
-				col5.push_back(stod(row[4]));
-				col6.push_back(stod(row[5]));
-			}
-		}
-		infile.close();
+		cout << "Using table bundle " << filename << " (" << table_bundle->get_num_tables() << " tables)\n";
 	}
 
 	// returns interpolated value at x from parallel arrays (x_data, y_data)
@@ -282,10 +367,75 @@ namespace common {
 		return rand_dist(rand_generator);
 	}
 
+	// seed of this run (from file "rng_seed" if present, otherwise from the clock)
+	long long get_run_seed()
+	{
+		return seed;
+	}
+
+	// reseed the calling thread's generator with independent stream number stream derived from the run seed
+	void set_rand_stream(int stream)
+	{
+		seed_seq seq{(unsigned)(seed & 0xffffffff), (unsigned)((unsigned long long)seed >> 32), (unsigned)stream, 0x5eedu};
+		rand_generator.seed(seq);
+		rand_dist.reset();
+	}
+
+	void set_transport_stream(int step, int worker)
+	{
+		seed_seq seq{(unsigned)(seed & 0xffffffff), (unsigned)((unsigned long long)seed >> 32), (unsigned)step, (unsigned)worker, 0x7a5eu};
+		rand_generator.seed(seq);
+		rand_dist.reset();
+	}
+
+	// uniformly distributed number from interval [0, 1) determined only by the run seed and (a, b, c)
+	// (counter-based: each key is hashed with splitmix64 finalizers, and the top 53 bits give the number)
+	double get_keyed_rand(long long a, long long b, int c)
+	{
+		auto mix = [](unsigned long long x)
+		{
+			x += 0x9e3779b97f4a7c15ULL;
+			x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+			x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+			return x ^ (x >> 31);
+		};
+		unsigned long long h = mix((unsigned long long)seed);
+		h = mix(h ^ (unsigned long long)a);
+		h = mix(h ^ (unsigned long long)b);
+		h = mix(h ^ (unsigned long long)(unsigned)c);
+		return (h >> 11)*(1.0/9007199254740992.0);
+	}
+
+	// fills u[0..n) with uniformly distributed random numbers from interval [0, 1)
+	void fill_rand(int n, double u[])
+	{
+		for (int i=0; i<n; i++)
+		{
+			u[i] = rand_dist(rand_generator);
+		}
+	}
+
 	// returns uniformly distributed random integer between lower and upper (inclusive)
 	int get_rand_int(int lower, int upper)
 	{
 		uniform_int_distribution<int> dist(lower, upper);
 		return dist(rand_generator);
 	}
+
+	// sets cos_phi and sin_phi for a uniformly distributed angle phi in [0, 2pi) without trig calls
+	// (point (a, b) is sampled uniformly in the unit disk; then phi is twice its polar angle)
+	void get_rand_azimuth(double &cos_phi, double &sin_phi)
+	{
+		double a, b, s;
+		do
+		{
+			a = 2.0*get_rand() - 1.0;
+			b = 2.0*get_rand() - 1.0;
+			s = a*a + b*b;
+		}
+		while (s >= 1.0 || s == 0.0);
+
+		cos_phi = (a*a - b*b) / s;
+		sin_phi = 2.0*a*b / s;
+	}
 }
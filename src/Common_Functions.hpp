@@ -19,26 +19,44 @@
 #include <cmath>
 using namespace std;
 
+// physical constants are constexpr so that expressions using them (e.g. species masses) can be folded at compile time
 namespace constants {
-	extern const double pi;       // pi [unitless]
-	extern const double twopi;    // 2*pi [unitless]
-	extern const double k_b;      // Boltzmann's Constant [erg/K]
-	extern const double c;        // Speed of Light in Vacuum [cm/s]
-	extern const double G;        // Gravitational Constant [cm^3/g/s^2]
-	extern const double amu;      // Atomic Mass Unit [g]
-	extern const double m_e;      // Electron Mass [g]
-	extern const double q_e;      // Elementary Charge [C]
-	extern const double jev;      // Joules/Electron Volt [unitless]
-	extern const double ergev;    // ergs/Electron Volt [unitless]
+	constexpr double pi    = M_PI;             // pi [unitless]
+	constexpr double twopi = 2*pi;             // 2*pi [unitless]
+	constexpr double k_b   = 1.380649e-16;     // Boltzmann's Constant [erg/K]
+	constexpr double c     = 29979245800.0;    // Speed of Light in Vacuum [cm/s]
+	constexpr double G     = 6.67430e-8;       // Gravitational Constant [cm^3/g/s^2]
+	constexpr double amu   = 1.660538782e-24;  // Atomic Mass Unit [g]
+	constexpr double m_e   = 9.10938215e-28;   // Electron Mass [g]
+	constexpr double q_e   = 1.602176487e-19;  // Elementary Charge [C]
+	constexpr double jev   = q_e;              // Joules/Electron Volt [unitless]
+	constexpr double ergev = jev*1.0e7;        // ergs/Electron Volt [unitless]
 }
 
+// column-major table of doubles read from a csv file, with column names from its '#' header line if present
+struct Csv_Table {
+	vector<string> names;            // column names from header line, e.g. "alt(cm)", "O(cm-3)"; may be empty
+	vector<vector<double>> columns;  // columns[i][row]
+
+	int get_num_rows() const;
+	int get_num_cols() const;
+
+	// index of column whose header name is name, either exactly or ignoring a trailing unit in () or []
+	// (so "O" finds "O(cm-3)"); returns -1 if there is no such column
+	int find_column(string name) const;
+};
+
 namespace common {
-	// functions for importing double type data from 2, 3, 4, 5, or 6-column csv files
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2);
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3);
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3, vector<double> &col4);
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3, vector<double> &col4, vector<double> &col5);
-	void import_csv(string filename, vector<double> &col1, vector<double> &col2, vector<double> &col3, vector<double> &col4, vector<double> &col5, vector<double> &col6);
+	// read csv file (or its copy in the table bundle, if one is in use) into a column-major table; exits
+	// if the file is missing, malformed, or has fewer than min_cols columns
+	Csv_Table read_csv(string filename, int min_cols = 1);
+
+	// read csv file into table without using the table bundle; returns false and sets error on failure
+	bool try_read_csv(string filename, Csv_Table &table, string &error);
+
+	// use the table bundle in filename (written by corona3d_pack) for any table it holds;
+	// read_csv then copies those tables straight out of the memory-mapped bundle instead of parsing them
+	void use_table_bundle(string filename);
 
 	// returns interpolated value at x from parallel arrays (x_data, y_data)
 	double interpolate(vector<double> &x_data, vector<double> &y_data, double x);
@@ -49,8 +67,29 @@ namespace common {
 	// returns uniformly distributed random number from interval [0, 1)
 	double get_rand();
 
+	// seed of this run (from file "rng_seed" if present, otherwise from the clock)
+	long long get_run_seed();
+
+	// reseed the calling thread's generator with independent stream number stream derived from the run seed
+	// (the same stream always gives the same numbers, whichever thread uses it)
+	void set_rand_stream(int stream);
+
+	// reseed the calling thread's generator for worker worker's share of transport step step (streams independent of
+	// those of set_rand_stream)
+	void set_transport_stream(int step, int worker);
+
+	// uniformly distributed number from interval [0, 1) determined only by the run seed and (a, b, c): draws keyed to,
+	// e.g., a particle and its n-th collision come out the same however many other numbers are drawn in between
+	double get_keyed_rand(long long a, long long b, int c);
+
+	// fills u[0..n) with uniformly distributed random numbers from interval [0, 1)
+	void fill_rand(int n, double u[]);
+
 	// returns uniformly distributed random integer between lower and upper (inclusive)
 	int get_rand_int(int lower, int upper);
+
+	// sets cos_phi and sin_phi for a uniformly distributed angle phi in [0, 2pi) without trig calls
+	void get_rand_azimuth(double &cos_phi, double &sin_phi);
 };
 
 #endif /* COMMON_FUNCTIONS_HPP_ */
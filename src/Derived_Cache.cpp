@@ -0,0 +1,228 @@
+/*
+ * Derived_Cache.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Derived_Cache.hpp"
+#include "Table_Bundle.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// directory holding cache files; empty if caching is off
+static string cache_dir = "";
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t i=0; i<size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+Derived_Cache::Derived_Cache(string name) {
+	this->name = name;
+	key = 14695981039346656037ULL;
+	usable = true;
+	add_bytes(&derived_cache_version, sizeof(derived_cache_version));
+	add_input(name);
+}
+
+Derived_Cache::~Derived_Cache() {
+
+}
+
+void Derived_Cache::add_bytes(const void *data, size_t size)
+{
+	key = hash_bytes(key, data, size);
+}
+
+void Derived_Cache::add_input(double value)
+{
+	add_bytes(&value, sizeof(value));
+}
+
+void Derived_Cache::add_input(const string &value)
+{
+	uint64_t size = value.size();
+	add_bytes(&size, sizeof(size));
+	add_bytes(value.data(), size);
+}
+
+void Derived_Cache::add_input(const vector<double> &values)
+{
+	uint64_t size = values.size();
+	add_bytes(&size, sizeof(size));
+	add_bytes(values.data(), size*sizeof(double));
+}
+
+void Derived_Cache::add_input(const vector<vector<double>> &table)
+{
+	uint64_t size = table.size();
+	add_bytes(&size, sizeof(size));
+	for (const vector<double> &values : table)
+	{
+		add_input(values);
+	}
+}
+
+// add the contents of a file to the key; if the file cannot be read, this entry is not cached
+void Derived_Cache::add_file(const string &filename)
+{
+	ifstream infile(filename);
+	if (!infile.good())
+	{
+		usable = false;
+		return;
+	}
+	infile.close();
+	add_input(filename);
+	uint64_t checksum = Table_Bundle::checksum_file(filename);
+	add_bytes(&checksum, sizeof(checksum));
+}
+
+string Derived_Cache::get_filename() const
+{
+	stringstream filename;
+	filename << cache_dir << "/" << name << "_" << hex << setw(16) << setfill('0') << key << ".cache";
+	return filename.str();
+}
+
+// fill tables from the cache entry for this key; returns false if caching is off or there is no valid entry
+bool Derived_Cache::load(vector<vector<double>> &tables) const
+{
+	if (cache_dir == "" || !usable)
+	{
+		return false;
+	}
+	struct stat st;
+	if (stat(get_filename().c_str(), &st) != 0)
+	{
+		return false;
+	}
+	ifstream infile(get_filename(), ios::binary);
+	if (!infile.good())
+	{
+		return false;
+	}
+
+	char magic[8];
+	uint32_t version = 0;
+	uint32_t num_tables = 0;
+	uint64_t file_key = 0;
+	infile.read(magic, sizeof(magic));
+	infile.read((char *)&version, sizeof(version));
+	infile.read((char *)&num_tables, sizeof(num_tables));
+	infile.read((char *)&file_key, sizeof(file_key));
+	if (!infile.good() || memcmp(magic, derived_cache_magic, sizeof(magic)) != 0 || version != derived_cache_version || file_key != key)
+	{
+		return false;
+	}
+
+	// the sizes must account for the file exactly (header, size list, data and hash) before anything is allocated
+	uint64_t header_size = sizeof(magic) + sizeof(version) + sizeof(num_tables) + sizeof(file_key);
+	uint64_t file_size = st.st_size;
+	if (file_size < header_size + sizeof(uint64_t) || num_tables > (file_size - header_size - sizeof(uint64_t))/sizeof(uint64_t))
+	{
+		cout << "Derived table cache entry " << get_filename() << " is damaged; rebuilding it\n";
+		return false;
+	}
+	vector<uint64_t> sizes(num_tables);
+	infile.read((char *)sizes.data(), num_tables*sizeof(uint64_t));
+	uint64_t data_values = (file_size - header_size - sizeof(uint64_t) - num_tables*sizeof(uint64_t)) / sizeof(double);
+	bool sizes_match = infile.good() && (file_size - header_size - sizeof(uint64_t)) % sizeof(double) == 0;
+	for (uint32_t i=0; i<num_tables && sizes_match; i++)
+	{
+		sizes_match = (sizes[i] <= data_values);
+		data_values = sizes_match ? data_values - sizes[i] : 0;
+	}
+	if (!sizes_match || data_values != 0)
+	{
+		cout << "Derived table cache entry " << get_filename() << " is damaged; rebuilding it\n";
+		return false;
+	}
+
+	vector<vector<double>> data(num_tables);
+	uint64_t data_hash = 14695981039346656037ULL;
+	for (uint32_t i=0; i<num_tables && infile.good(); i++)
+	{
+		data[i].resize(sizes[i]);
+		infile.read((char *)data[i].data(), sizes[i]*sizeof(double));
+		data_hash = hash_bytes(data_hash, data[i].data(), sizes[i]*sizeof(double));
+	}
+	uint64_t file_hash = 0;
+	infile.read((char *)&file_hash, sizeof(file_hash));
+	if (!infile.good() || file_hash != data_hash)
+	{
+		cout << "Derived table cache entry " << get_filename() << " is damaged; rebuilding it\n";
+		return false;
+	}
+	tables = data;
+	return true;
+}
+
+// write tables to the cache entry for this key (does nothing if caching is off)
+void Derived_Cache::store(const vector<vector<double>> &tables) const
+{
+	if (cache_dir == "" || !usable)
+	{
+		return;
+	}
+
+	// write to a temporary file first so that concurrent runs never see a partly written entry
+	string filename = get_filename();
+	string tmp_filename = filename + "." + to_string(getpid());
+	ofstream outfile(tmp_filename, ios::binary);
+	if (!outfile.good())
+	{
+		cout << "Could not write derived table cache entry " << filename << "\n";
+		return;
+	}
+	uint32_t version = derived_cache_version;
+	uint32_t num_tables = tables.size();
+	outfile.write(derived_cache_magic, sizeof(derived_cache_magic));
+	outfile.write((const char *)&version, sizeof(version));
+	outfile.write((const char *)&num_tables, sizeof(num_tables));
+	outfile.write((const char *)&key, sizeof(key));
+	for (const vector<double> &table : tables)
+	{
+		uint64_t size = table.size();
+		outfile.write((const char *)&size, sizeof(size));
+	}
+	uint64_t data_hash = 14695981039346656037ULL;
+	for (const vector<double> &table : tables)
+	{
+		outfile.write((const char *)table.data(), table.size()*sizeof(double));
+		data_hash = hash_bytes(data_hash, table.data(), table.size()*sizeof(double));
+	}
+	outfile.write((const char *)&data_hash, sizeof(data_hash));
+	outfile.close();
+	if (!outfile.good() || rename(tmp_filename.c_str(), filename.c_str()) != 0)
+	{
+		cout << "Could not write derived table cache entry " << filename << "\n";
+		remove(tmp_filename.c_str());
+	}
+}
+
+// directory for cache files (created if missing); caching is off until this is called
+void Derived_Cache::set_directory(string dir)
+{
+	struct stat st;
+	if (stat(dir.c_str(), &st) != 0 && mkdir(dir.c_str(), 0755) != 0)
+	{
+		cout << "Could not create derived table cache directory \"" << dir << "\"!\n";
+		exit(1);
+	}
+	cache_dir = dir;
+	cout << "Using derived table cache in " << dir << "\n";
+}
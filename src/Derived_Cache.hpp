@@ -0,0 +1,63 @@
+/*
+ * Derived_Cache.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef DERIVED_CACHE_HPP_
+#define DERIVED_CACHE_HPP_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+using namespace std;
+
+// on-disk cache of tables derived at startup from input tables and parameters (source CDFs, scattering CDFs)
+// each entry is keyed by a hash of everything it was derived from, so an entry is only reused when all of its
+// inputs are unchanged; anything else (or a damaged entry) is simply rebuilt and rewritten
+//
+// usage:  Derived_Cache cache("name");  cache.add_input(...) for every input;
+//         if (!cache.load(tables)) { build tables; cache.store(tables); }
+//
+// cache file layout (native byte order):
+//   magic "C3DCACHE", uint32 version, uint32 num_tables, uint64 key, num_tables x uint64 table sizes,
+//   table data (doubles), uint64 FNV-1a hash of table data
+const char derived_cache_magic[8] = {'C', '3', 'D', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t derived_cache_version = 1;   // bump whenever the code deriving any cached table changes
+
+class Derived_Cache {
+public:
+	// name identifies the kind of table (and names the cache file); it is part of the key
+	Derived_Cache(string name);
+	virtual ~Derived_Cache();
+
+	// add an input to the key
+	void add_input(double value);
+	void add_input(const string &value);
+	void add_input(const vector<double> &values);
+	void add_input(const vector<vector<double>> &table);
+
+	// add the contents of a file to the key; if the file cannot be read, this entry is not cached
+	void add_file(const string &filename);
+
+	// fill tables from the cache entry for this key; returns false if caching is off or there is no valid entry
+	// (an entry whose sizes do not match its file size or whose data hash differs is treated as damaged)
+	bool load(vector<vector<double>> &tables) const;
+
+	// write tables to the cache entry for this key (does nothing if caching is off)
+	void store(const vector<vector<double>> &tables) const;
+
+	// directory for cache files (created if missing); caching is off until this is called
+	static void set_directory(string dir);
+
+private:
+	string name;     // kind of table
+	uint64_t key;    // FNV-1a hash of name and all inputs
+	bool usable;     // false if an input could not be hashed
+
+	void add_bytes(const void *data, size_t size);
+	string get_filename() const;
+};
+
+#endif /* DERIVED_CACHE_HPP_ */
@@ -18,19 +18,39 @@ Distribution::~Distribution() {
 
 }
 
-void Distribution::gen_mb(double vavg, double v_in[])
+// initialize positions and velocities of entries begin..end-1 of parts using random number stream rng_stream
+// with quasi-random initial conditions on, particle parts.id[i] takes point parts.id[i] of the sequence
+// init() only reads the distribution's tables, so this is thread safe for distributions that keep no per-particle state
+void Distribution::init_batch(Particle_Store &parts, int begin, int end, int rng_stream)
 {
-	double randnum1 = common::get_rand();
-	double randnum2 = common::get_rand();
-	double randnum3 = common::get_rand();
-	double randnum4 = common::get_rand();
-
-	randnum1 = vavg*sqrt(-2.0*log(1.0-randnum1));
-	randnum2 = constants::twopi*randnum2;
-	randnum3 = vavg*sqrt(-2.0*log(1.0-randnum3));
-	randnum4 = constants::twopi*randnum4;
-
-	v_in[0] = randnum1*cos(randnum2);
-	v_in[1] = randnum1*sin(randnum2);
-	v_in[2] = randnum3*cos(randnum4);
+	common::set_rand_stream(rng_stream);
+	for (int i=begin; i<end; i++)
+	{
+		Particle p(parts.species[i]);
+		sampling::set_qmc_point(parts.id[i]);
+		init(p);
+		parts.x[i] = p.get_x();
+		parts.y[i] = p.get_y();
+		parts.z[i] = p.get_z();
+		parts.vx[i] = p.get_vx();
+		parts.vy[i] = p.get_vy();
+		parts.vz[i] = p.get_vz();
+		parts.source[i] = p.get_source();
+	}
+}
+
+// by default, a distribution has a single source producing particles at the global rate
+int Distribution::get_num_sources()
+{
+	return 1;
+}
+
+string Distribution::get_source_name(int /*source_id*/)
+{
+	return "";
+}
+
+double Distribution::get_source_rate(int /*source_id*/)
+{
+	return get_global_rate();
 }
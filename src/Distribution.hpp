@@ -10,23 +10,32 @@
 
 #include <memory>
 #include "Particle.hpp"
+#include "Particle_Store.hpp"
 #include "Planet.hpp"
 
 class Distribution {
 public:
 	Distribution(Planet my_p, double ref_h, double ref_T);
 	virtual ~Distribution();
-	virtual void init(shared_ptr<Particle> p) = 0;
+	virtual void init(Particle &p) = 0;
+
+	// initialize positions and velocities of entries begin..end-1 of parts (id and species must be set; source is set here,
+	// and an imported distribution may replace species and id with those of the imported particles), using
+	// random number stream rng_stream on the calling thread; safe to call from several threads at once
+	virtual void init_batch(Particle_Store &parts, int begin, int end, int rng_stream);
 	virtual double get_global_rate() = 0;
 
+	// distributions may mix several production sources, drawing each particle's source in proportion to the
+	// source production rates; the source index is stored on the particle (Particle::get_source)
+	virtual int get_num_sources();
+	virtual string get_source_name(int source_id);
+	virtual double get_source_rate(int source_id);
+
 protected:
 	Planet my_planet;
 	double ref_height;
 	double ref_radius;
 	double ref_temp;
-
-	// sets v_in[] to a Maxwell-Boltzmann velocity vector based on vavg (average velocity)
-	void gen_mb(double vavg, double v_in[]);
 };
 
 #endif /* DISTRIBUTION_HPP_ */
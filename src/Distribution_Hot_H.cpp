@@ -14,8 +14,9 @@ Distribution_Hot_H::Distribution_Hot_H(Planet my_p, double ref_h, double ref_T)
 	m_Hplus = 1.00728*constants::amu;
 	m_HCOplus = 29.0175*constants::amu;
 	m_CO = 28.0101*constants::amu;
-	source = "";
+	string source = "";
 	global_rate = 0.0;
+	alt_bin_size = 10000.0;
 
 	temp_profile.resize(4);
 	H_profile.resize(2);
@@ -120,23 +121,69 @@ Distribution_Hot_H::Distribution_Hot_H(Planet my_p, double ref_h, double ref_T)
 		    
 	}
 	
-	common::import_csv(temp_prof_filename, temp_profile[0], temp_profile[1], temp_profile[2], temp_profile[3]);
-	common::import_csv(H_prof_filename, H_profile[0], H_profile[1]);
-	common::import_csv(Hplus_prof_filename, Hplus_profile[0], Hplus_profile[1]);
-	common::import_csv(HCOplus_prof_filename, HCOplus_profile[0], HCOplus_profile[1]);
-	common::import_csv(electron_prof_filename, electron_profile[0], electron_profile[1]);
-
-	if (source == "H_Hplus")
+	temp_profile = common::read_csv(temp_prof_filename, 4).columns;
+	H_profile = common::read_csv(H_prof_filename, 2).columns;
+	Hplus_profile = common::read_csv(Hplus_prof_filename, 2).columns;
+	HCOplus_profile = common::read_csv(HCOplus_prof_filename, 2).columns;
+	electron_profile = common::read_csv(electron_prof_filename, 2).columns;
+
+	// source may list several comma-separated sources, which are then mixed in one run
+	stringstream source_list(source);
+	string name;
+	while (getline(source_list, name, ','))
 	{
-		make_H_Hplus_CDF(profile_bottom, profile_top);
+		// each make_*_CDF sets global_rate to the rate of its own source (any_mechanism_prob has none)
+		global_rate = 0.0;
+		source_names.push_back(name);
+		if (name == "H_Hplus")
+		{
+			make_H_Hplus_CDF(profile_bottom, profile_top);
+			H_Hplus_sampler.init_from_CDF(H_Hplus_CDF[0]);
+			sources.push_back(source_H_Hplus);
+		}
+		else if (name == "HCOplus_DR")
+		{
+			make_HCOplus_DR_CDF(profile_bottom, profile_top);
+			HCOplus_DR_sampler.init_from_CDF(HCOplus_DR_CDF[0]);
+			sources.push_back(source_HCOplus_DR);
+		}
+		else if (name == "any_mechanism_prob")
+		{
+			make_any_mechanism_prob_CDF(profile_bottom, profile_top);
+			any_mechanism_prob_sampler.init_from_CDF(any_mechanism_prob_CDF[0]);
+			sources.push_back(source_any_mechanism_prob);
+		}
+		else
+		{
+			cout << "Unknown hot H source \"" << name << "\" in Hot_H.cfg!\n";
+			exit(1);
+		}
+		source_rates.push_back(global_rate);
 	}
-	else if (source == "HCOplus_DR")
+	if (sources.empty())
 	{
-		make_HCOplus_DR_CDF(profile_bottom, profile_top);
+		cout << "No hot H source set in Hot_H.cfg!\n";
+		exit(1);
 	}
-	else if (source == "any_mechanism_prob")
+
+	global_rate = 0.0;
+	for (double rate : source_rates)
+	{
+		global_rate = global_rate + rate;
+	}
+	if (sources.size() > 1)
 	{
-		make_any_mechanism_prob_CDF(profile_bottom, profile_top);
+		// any_mechanism_prob has no production rate, so it cannot be weighed against other sources
+		for (int id : sources)
+		{
+			if (id == source_any_mechanism_prob)
+			{
+				cout << "Source any_mechanism_prob cannot be combined with other hot H sources!\n";
+				exit(1);
+			}
+		}
+		source_sampler.init(source_rates);
+		cout << "Total global hot H production rate:\n" << global_rate << " per second\n";
 	}
 }
 
@@ -144,24 +191,40 @@ Distribution_Hot_H::~Distribution_Hot_H() {
 
 }
 
-void Distribution_Hot_H::init(shared_ptr<Particle> p)
+void Distribution_Hot_H::init(Particle &p)
 {
-	if (source == "H_Hplus")
+	// with several sources, each particle comes from a source drawn in proportion to the source rates
+	int k = 0;
+	if (sources.size() > 1)
+	{
+		if (sampling::using_qmc())
+		{
+			double frac;
+			k = source_sampler.sample_ordered(sampling::get_qrand(), frac);
+		}
+		else
+		{
+			k = source_sampler.sample(common::get_rand());
+		}
+	}
+	p.set_source(k);
+
+	if (sources[k] == source_H_Hplus)
 	{
 		init_H_Hplus_particle(p);
 	}
-	else if (source == "HCOplus_DR")
+	else if (sources[k] == source_HCOplus_DR)
 	{
 		init_HCOplus_DR_particle(p);
 	}
-	else if (source == "any_mechanism_prob")
+	else if (sources[k] == source_any_mechanism_prob)
 	{
 	         init_any_mechanism_prob_particle(p);
 	}
 }
 
 // init particle using H_Hplus mechanism
-void Distribution_Hot_H::init_H_Hplus_particle(shared_ptr<Particle> p)
+void Distribution_Hot_H::init_H_Hplus_particle(Particle &p)
 {
 	// altitude distribution for hot H
 	double r = get_new_radius_H_Hplus();
@@ -169,11 +232,8 @@ void Distribution_Hot_H::init_H_Hplus_particle(shared_ptr<Particle> p)
 	double temp_ion = common::interpolate_logy(temp_profile[0], temp_profile[2], alt);
 	double temp_neut = common::interpolate_logy(temp_profile[0], temp_profile[1], alt);
 
-	double phi = constants::twopi*(common::get_rand());
-	double u = 2.0*common::get_rand() - 1.0;
-	double x = r*sqrt(1-(u*u))*cos(phi);
-	double y = r*sqrt(1-(u*u))*sin(phi);
-	double z = r*u;
+	double x, y, z;
+	sampling::gen_sphere_point_q(r, x, y, z);
 
 	// Hemispherical Adjustment For Dayside Photochemical Process
 	if (x < 0)
@@ -185,8 +245,8 @@ void Distribution_Hot_H::init_H_Hplus_particle(shared_ptr<Particle> p)
 	double neut_vavg = sqrt(constants::k_b*temp_neut/m_H);    // average thermal H velocity
 	double v_ion[] = {0.0, 0.0, 0.0};
 	double v_neut[] = {0.0, 0.0, 0.0};
-	gen_mb(ion_vavg, v_ion);
-	gen_mb(neut_vavg, v_neut);
+	sampling::gen_gaussian3(ion_vavg, v_ion);
+	sampling::gen_gaussian3(neut_vavg, v_neut);
 
 	double e = 0.0;
 	Matrix<double, 3, 1> p1_v = {v_neut[0], v_neut[1], v_neut[2]};
@@ -202,18 +262,15 @@ void Distribution_Hot_H::init_H_Hplus_particle(shared_ptr<Particle> p)
 	double v = sqrt(2.0*e / (m_H + (m_H*m_H/m_Hplus)));
 
 	// spherically isotropic velocity vector
-	phi = constants::twopi*common::get_rand();
-	u = 2.0*common::get_rand() - 1.0;
-	double vx = v*sqrt(1-u*u)*cos(phi);
-	double vy = v*sqrt(1-u*u)*sin(phi);
-	double vz = v*u;
-
-	//p->init_particle(x, y, z, v_ion[0], v_ion[1], v_ion[2]);
-	p->init_particle(x, y, z, vx, vy, vz);
+	double vx, vy, vz;
+	sampling::gen_sphere_point_q(v, vx, vy, vz);
+
+	//p.init_particle(x, y, z, v_ion[0], v_ion[1], v_ion[2]);
+	p.init_particle(x, y, z, vx, vy, vz);
 }
 
 // init particle using HCOplus_DR mechanism
-void Distribution_Hot_H::init_HCOplus_DR_particle(shared_ptr<Particle> p)
+void Distribution_Hot_H::init_HCOplus_DR_particle(Particle &p)
 {
 	// altitude distribution for hot H
 	double r = get_new_radius_HCOplus_DR();
@@ -222,11 +279,8 @@ void Distribution_Hot_H::init_HCOplus_DR_particle(shared_ptr<Particle> p)
 	//double temp_neut = common::interpolate_logy(temp_profile[0], temp_profile[1], alt);
 	double temp_e = common::interpolate_logy(temp_profile[0], temp_profile[3], alt);
 
-	double phi = constants::twopi*(common::get_rand());
-	double u = 2.0*common::get_rand() - 1.0;
-	double x = r*sqrt(1-(u*u))*cos(phi);
-	double y = r*sqrt(1-(u*u))*sin(phi);
-	double z = r*u;
+	double x, y, z;
+	sampling::gen_sphere_point_q(r, x, y, z);
 
 	// Hemispherical Adjustment For Dayside Photochemical Process
 	if (x < 0)
@@ -240,13 +294,13 @@ void Distribution_Hot_H::init_HCOplus_DR_particle(shared_ptr<Particle> p)
 	double we = 0.0;       // vibrational frequency (cm-1)
 	double wexe = 0.0;     // first correction term to vibrational frequency (cm-1)
 
-	double randnum = common::get_rand();
+	double randnum = sampling::get_qrand();
 	if (randnum < 0.23)
 	{
 		Ei = 1.3;
 		we = 1743.41;
 		wexe = 14.36;
-		double randnum2 = common::get_rand();
+		double randnum2 = sampling::get_qrand();
 		if (randnum2 < 0.45)
 		{
 			vib_lvl = 0.0;
@@ -278,7 +332,7 @@ void Distribution_Hot_H::init_HCOplus_DR_particle(shared_ptr<Particle> p)
 		Ei = 0.44;
 		we = 1228.6;
 		wexe = 10.468;
-		double randnum2 = common::get_rand();
+		double randnum2 = sampling::get_qrand();
 		if (randnum2 < 0.5)
 		{
 			vib_lvl = 0.0;
@@ -303,7 +357,7 @@ void Distribution_Hot_H::init_HCOplus_DR_particle(shared_ptr<Particle> p)
 		we = 2169.81358;
 		wexe = 13.28831;
 		/*
-		double randnum2 = common::get_rand();
+		double randnum2 = sampling::get_qrand();
 		if (randnum2 < 0.5)
 		{
 			vib_lvl = 0.0;
@@ -358,30 +412,27 @@ void Distribution_Hot_H::init_HCOplus_DR_particle(shared_ptr<Particle> p)
 	double v = sqrt(2.0*Ei / (m_H + (m_H*m_H/m_CO)));
 
 	// spherically isotropic velocity vector
-	phi = constants::twopi*common::get_rand();
-	u = 2.0*common::get_rand() - 1.0;
-	double vx = v*sqrt(1-u*u)*cos(phi);
-	double vy = v*sqrt(1-u*u)*sin(phi);
-	double vz = v*u;
+	double vx, vy, vz;
+	sampling::gen_sphere_point_q(v, vx, vy, vz);
 
 	// Add initial HCO+ and e translational momentum
 	double vavg = sqrt(constants::k_b*temp_ion/(m_HCOplus));  // average thermal ion velocity
 	double v_ion[] = {0.0, 0.0, 0.0};
-	gen_mb(vavg, v_ion);                               // sample from Maxwell-Boltzmann distribution
+	sampling::gen_gaussian3(vavg, v_ion);  // sample from Maxwell-Boltzmann distribution
 	vavg = sqrt(constants::k_b*temp_e/constants::m_e);    //average thermal e velocity
 	double v_e[] = {0.0, 0.0, 0.0};
-	gen_mb(vavg, v_e);                                 // sample from Maxwell-Boltzmann distribution
+	sampling::gen_gaussian3(vavg, v_e);  // sample from Maxwell-Boltzmann distribution
 
 	// add it all up
 	vx = vx + (m_HCOplus*v_ion[0] + constants::m_e*v_e[0]) / (m_HCOplus+constants::m_e);
 	vy = vy + (m_HCOplus*v_ion[1] + constants::m_e*v_e[1]) / (m_HCOplus+constants::m_e);
 	vz = vz + (m_HCOplus*v_ion[2] + constants::m_e*v_e[2]) / (m_HCOplus+constants::m_e);
 
-	p->init_particle(x, y, z, vx, vy, vz);
+	p.init_particle(x, y, z, vx, vy, vz);
 }
 
 // init particle using any_mechanism_prob (to compute  escape rate of H atoms born at a certain altitude)
-void Distribution_Hot_H::init_any_mechanism_prob_particle(shared_ptr<Particle> p)
+void Distribution_Hot_H::init_any_mechanism_prob_particle(Particle &p)
 {
 	// altitude distribution for hot H
         double r = get_new_radius_any_mechanism_prob(); // radius from centre of planet (cm)	
@@ -390,11 +441,8 @@ void Distribution_Hot_H::init_any_mechanism_prob_particle(shared_ptr<Particle> p
 	//double temp_neut = common::interpolate_logy(temp_profile[0], temp_profile[1], alt);
 	double temp_e = common::interpolate_logy(temp_profile[0], temp_profile[3], alt);
 
-	double phi = constants::twopi*(common::get_rand());
-	double u = 2.0*common::get_rand() - 1.0;
-	double x = r*sqrt(1-(u*u))*cos(phi);
-	double y = r*sqrt(1-(u*u))*sin(phi);
-	double z = r*u;
+	double x, y, z;
+	sampling::gen_sphere_point_q(r, x, y, z);
 
 	// Hemispherical Adjustment For Dayside Photochemical Process
 	if (x < 0)
@@ -412,52 +460,55 @@ void Distribution_Hot_H::init_any_mechanism_prob_particle(shared_ptr<Particle> p
 	double v = sqrt(2.0*Ei /m_H); // units of cm/s
 
 	// spherically isotropic velocity vector
-	phi = constants::twopi*common::get_rand();
-	u = 2.0*common::get_rand() - 1.0;
-	double vx = v*sqrt(1-u*u)*cos(phi);
-	double vy = v*sqrt(1-u*u)*sin(phi);
-	double vz = v*u;
+	double vx, vy, vz;
+	sampling::gen_sphere_point_q(v, vx, vy, vz);
 
        	//std::cout << "alt " << alt/1e5 << "\t" << v << "\n"; // This line allows check that particles are being produced at the altitude (km) and with the velocity (cm/s) expected
 
 	// Don't add initial translational momentum of reactants -  this is acceptable because the velocities are isotropic, so there will be a net 0 effect on v
-	p->init_particle(x, y, z, vx, vy, vz);
+	p.init_particle(x, y, z, vx, vy, vz);
 }
 
-// scans HCOplus_DR_CDF for new particle radius
+// draws new particle radius from HCOplus_DR_CDF, uniformly distributed within the chosen altitude bin
 double Distribution_Hot_H::get_new_radius_HCOplus_DR()
 {
-        double u = common::get_rand(); // random no between 0 and 1
-	int k = 0;
-	while (HCOplus_DR_CDF[0][k] < u)
+	if (sampling::using_qmc())
 	{
-		k++;
+		// a single quasi-random coordinate picks both the bin and the position within it
+		double frac;
+		int k = HCOplus_DR_sampler.sample_ordered(sampling::get_qrand(), frac);
+		return HCOplus_DR_CDF[1][k] + alt_bin_size*frac + my_planet.get_radius();
 	}
-	return HCOplus_DR_CDF[1][k] + my_planet.get_radius();
+	int k = HCOplus_DR_sampler.sample(common::get_rand());
+	return HCOplus_DR_CDF[1][k] + alt_bin_size*common::get_rand() + my_planet.get_radius();
 }
 
-// scans H_Hplus_CDF for new particle radius
+// draws new particle radius from H_Hplus_CDF, uniformly distributed within the chosen altitude bin
 double Distribution_Hot_H::get_new_radius_H_Hplus()
 {
-	double u = common::get_rand();
-	int k = 0;
-	while (H_Hplus_CDF[0][k] < u)
+	if (sampling::using_qmc())
 	{
-		k++;
+		// a single quasi-random coordinate picks both the bin and the position within it
+		double frac;
+		int k = H_Hplus_sampler.sample_ordered(sampling::get_qrand(), frac);
+		return H_Hplus_CDF[1][k] + alt_bin_size*frac + my_planet.get_radius();
 	}
-	return H_Hplus_CDF[1][k] + my_planet.get_radius();
+	int k = H_Hplus_sampler.sample(common::get_rand());
+	return H_Hplus_CDF[1][k] + alt_bin_size*common::get_rand() + my_planet.get_radius();
 }
 
-// scans any_mechanism_prob_CDF for new particle radius
+// draws new particle radius from any_mechanism_prob_CDF, uniformly distributed within the chosen altitude bin
 double Distribution_Hot_H::get_new_radius_any_mechanism_prob()
 {
-	double u = common::get_rand();
-	int k = 0;
-	while (any_mechanism_prob_CDF[0][k] < u)
+	if (sampling::using_qmc())
 	{
-		k++;
+		// a single quasi-random coordinate picks both the bin and the position within it
+		double frac;
+		int k = any_mechanism_prob_sampler.sample_ordered(sampling::get_qrand(), frac);
+		return any_mechanism_prob_CDF[1][k] + alt_bin_size*frac + my_planet.get_radius();
 	}
-	return any_mechanism_prob_CDF[1][k] + my_planet.get_radius();
+	int k = any_mechanism_prob_sampler.sample(common::get_rand());
+	return any_mechanism_prob_CDF[1][k] + alt_bin_size*common::get_rand() + my_planet.get_radius();
 }
 
 // returns global production rate (needs to be set by chosen production method)
@@ -467,13 +518,49 @@ double Distribution_Hot_H::get_global_rate()
 	return global_rate;
 }
 
+int Distribution_Hot_H::get_num_sources()
+{
+	return sources.size();
+}
+
+string Distribution_Hot_H::get_source_name(int source_id)
+{
+	return source_names[source_id];
+}
+
+// global production rate of one source [s^-1]
+double Distribution_Hot_H::get_source_rate(int source_id)
+{
+	return source_rates[source_id];
+}
+
 // generate H_Hplus_CDF for given altitude range using imported density/temp profiles
 void Distribution_Hot_H::make_H_Hplus_CDF(double lower_alt, double upper_alt)
 {
+	// the CDF depends only on the inputs below, so reuse it from the derived table cache if possible
+	Derived_Cache cache("Hot_H_H_Hplus_CDF");
+	cache.add_input(temp_profile);
+	cache.add_input(H_profile);
+	cache.add_input(Hplus_profile);
+	cache.add_input(H_Hplus_rate_coeff);
+	cache.add_input(lower_alt);
+	cache.add_input(upper_alt);
+	cache.add_input(my_planet.get_mass());
+	cache.add_input(my_planet.get_radius());
+	vector<vector<double>> cached;
+	if (cache.load(cached))
+	{
+		H_Hplus_CDF[0] = cached[0];
+		H_Hplus_CDF[1] = cached[1];
+		global_rate = cached[2][0];
+		cout << "Global hot H production rate from H+ + H:\n" << global_rate << " per second\n";
+		return;
+	}
+
 	//ofstream outfile;
 	//outfile.open("/home/rodney/Documents/coronaTest/rodney_hplh.dat");
 
-	double bin_size = 10000.0; // [cm]
+	double bin_size = alt_bin_size; // [cm]
 	int num_alt_bins = (int)((upper_alt - lower_alt) / bin_size);
 	vector<double> H_Hplus_rate;
 	H_Hplus_rate.resize(num_alt_bins);
@@ -552,15 +639,36 @@ void Distribution_Hot_H::make_H_Hplus_CDF(double lower_alt, double upper_alt)
 	double global_rate_H_Hplus = rate_sum_times_r_sqrd*bin_size;
 	cout << "Global hot H production rate from H+ + H:\n" << global_rate_H_Hplus << " per second\n";
 	global_rate = global_rate_H_Hplus;
+	cache.store({H_Hplus_CDF[0], H_Hplus_CDF[1], {global_rate}});
 }
 
 // generate HCOplus_DR_CDF for given altitude range using imported density/temp profiles
 void Distribution_Hot_H::make_HCOplus_DR_CDF(double lower_alt, double upper_alt)
 {
+	// the CDF depends only on the inputs below, so reuse it from the derived table cache if possible
+	Derived_Cache cache("Hot_H_HCOplus_DR_CDF");
+	cache.add_input(temp_profile);
+	cache.add_input(HCOplus_profile);
+	cache.add_input(electron_profile);
+	cache.add_input(HCOplus_DR_rate_coeff);
+	cache.add_input(lower_alt);
+	cache.add_input(upper_alt);
+	cache.add_input(my_planet.get_mass());
+	cache.add_input(my_planet.get_radius());
+	vector<vector<double>> cached;
+	if (cache.load(cached))
+	{
+		HCOplus_DR_CDF[0] = cached[0];
+		HCOplus_DR_CDF[1] = cached[1];
+		global_rate = cached[2][0];
+		cout << "Global hot H production rate from HCO+ DR:\n" << global_rate << " per second\n";
+		return;
+	}
+
 	//ofstream outfile;
 	//outfile.open("/home/rodney/Documents/coronaTest/rodney_hcopl_lsa.dat");
 
-	double bin_size = 10000.0; // [cm]
+	double bin_size = alt_bin_size; // [cm]
 	int num_alt_bins = (int)((upper_alt - lower_alt) / bin_size);
 	vector<double> HCOplus_DR_rate;
 	HCOplus_DR_rate.resize(num_alt_bins);
@@ -648,12 +756,13 @@ void Distribution_Hot_H::make_HCOplus_DR_CDF(double lower_alt, double upper_alt)
 	double global_rate_HCOplus_DR = rate_sum_times_r_sqrd*bin_size;
 	cout << "Global hot H production rate from HCO+ DR:\n" << global_rate_HCOplus_DR << " per second\n";
 	global_rate = global_rate_HCOplus_DR;
+	cache.store({HCOplus_DR_CDF[0], HCOplus_DR_CDF[1], {global_rate}});
 }
 
 // generate any_mechanism_prob_CDF for given altitude range - particular production rates are ignored, and all test particles are produced in a certain altitude bin
 void Distribution_Hot_H::make_any_mechanism_prob_CDF(double lower_alt, double upper_alt)
 {
-	double bin_size = 10000.0; // [cm]
+	double bin_size = alt_bin_size; // [cm]
 	int num_alt_bins = (int)((upper_alt - lower_alt) / bin_size);
 
 	any_mechanism_prob_CDF[0].resize(num_alt_bins);
@@ -670,7 +779,7 @@ void Distribution_Hot_H::make_any_mechanism_prob_CDF(double lower_alt, double up
 		}
 		else
 		{
-		        any_mechanism_prob_CDF[0][i] = any_mechanism_prob_CDF[0][i-1] + 0.0; 
+		        any_mechanism_prob_CDF[0][i] = (i == 0) ? 0.0 : any_mechanism_prob_CDF[0][i-1];
 		}
 	}
 }
@@ -9,13 +9,21 @@
 #define DISTRIBUTION_HOT_H_HPP_
 
 #include "Distribution.hpp"
+#include "Derived_Cache.hpp"
+#include "Alias_Sampler.hpp"
+
+// hot H production mechanisms
+enum Hot_H_Source { source_H_Hplus, source_HCOplus_DR, source_any_mechanism_prob };
 
 class Distribution_Hot_H: public Distribution {
 public:
 	Distribution_Hot_H(Planet my_p, double ref_h, double ref_T);
 	virtual ~Distribution_Hot_H();
-	void init(shared_ptr<Particle> p);
+	void init(Particle &p);
 	double get_global_rate();
+	int get_num_sources();
+	string get_source_name(int source_id);
+	double get_source_rate(int source_id);
 
 private:
 	double m_H;                // [g] neutral H mass
@@ -26,8 +34,11 @@ private:
 	double HCOplus_DR_rate_coeff;  // [cm^3/s] rate coefficient for HCO+ + e -> H* + CO
         double any_mechanism_energy; // [eV] energy given to H atom when 'any_mechanism_prob' source chose (producing H at single altitude)
         int any_mechanism_alt_bin; // altitude bin in which H atoms are produced when source is 'any_mechanism_prob'
-	double global_rate;    // [s^-1] set by chosen production method; calling function needs to divide this by 2 to get hemispherical rate
-	string source;         // which source to use when initializing particles ('H_Hplus' or 'HCOplus_DR')
+	double global_rate;    // [s^-1] total of source_rates; calling function needs to divide this by 2 to get hemispherical rate
+	vector<string> source_names;   // sources to draw particles from, as named in Hot_H.cfg
+	vector<int> sources;           // Hot_H_Source of each entry of source_names
+	vector<double> source_rates;   // [s^-1] global production rate of each source
+	Alias_Sampler source_sampler;  // draws a source in proportion to source_rates (only used with several sources)
         vector<vector<double>> H_profile;
 	vector<vector<double>> Hplus_profile;
 	vector<vector<double>> HCOplus_profile;
@@ -36,24 +47,28 @@ private:
 	vector<vector<double>> H_Hplus_CDF;
 	vector<vector<double>> HCOplus_DR_CDF;
         vector<vector<double>> any_mechanism_prob_CDF;
+	double alt_bin_size;   // [cm] width of altitude bins in the production CDFs above
+	Alias_Sampler H_Hplus_sampler;          // alias tables for drawing altitude bins from the CDFs above
+	Alias_Sampler HCOplus_DR_sampler;
+	Alias_Sampler any_mechanism_prob_sampler;
 
-	// scans HCOplus_DR_CDF for new particle radius
+	// draws new particle radius from HCOplus_DR_CDF
 	double get_new_radius_HCOplus_DR();
 
-	// scans H_Hplus_CDF for new particle radius
+	// draws new particle radius from H_Hplus_CDF
 	double get_new_radius_H_Hplus();
 
-        // scans any_mechanism_prob_CDF for new particle radius
+        // draws new particle radius from any_mechanism_prob_CDF
         double get_new_radius_any_mechanism_prob();
 
         // init particle using H_Hplus mechanism
-	void init_H_Hplus_particle(shared_ptr<Particle> p);
+	void init_H_Hplus_particle(Particle &p);
 
 	// init particle using HCOplus_DR mechanism
-	void init_HCOplus_DR_particle(shared_ptr<Particle> p);
+	void init_HCOplus_DR_particle(Particle &p);
 
   	// init particle using any_mechanism_prob (to estimate escape probability)
-        void init_any_mechanism_prob_particle(shared_ptr<Particle> p);
+        void init_any_mechanism_prob_particle(Particle &p);
 
 	// generate HCOplus_DR_CDF for given altitude range using imported density/temp profiles
 	void make_HCOplus_DR_CDF(double lower_alt, double upper_alt);
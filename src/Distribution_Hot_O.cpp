@@ -21,6 +21,8 @@ Distribution_Hot_O::Distribution_Hot_O(Planet my_p, double ref_h, double ref_T)
 	source = "";
 	O2plus_DR_rate_coeff = 0.0;
 	global_rate = 0.0;
+	alt_bin_size = 10000.0;
+	B_O2plus = 3.35967e-16;
 
 	temp_profile.resize(4);
 	O2plus_profile.resize(2);
@@ -98,13 +100,19 @@ Distribution_Hot_O::Distribution_Hot_O(Planet my_p, double ref_h, double ref_T)
 		}
 	}
 
-	common::import_csv(temp_prof_filename, temp_profile[0], temp_profile[1], temp_profile[2], temp_profile[3]);
-	common::import_csv(O2plus_prof_filename, O2plus_profile[0], O2plus_profile[1]);
-	common::import_csv(electron_prof_filename, electron_profile[0], electron_profile[1]);
+	temp_profile = common::read_csv(temp_prof_filename, 4).columns;
+	O2plus_profile = common::read_csv(O2plus_prof_filename, 2).columns;
+	electron_profile = common::read_csv(electron_prof_filename, 2).columns;
+
+	// rotational energies are sampled at ion temperatures from the profile, or at T_ion for the old method
+	double Ti_min = *min_element(temp_profile[2].begin(), temp_profile[2].end());
+	double Ti_max = *max_element(temp_profile[2].begin(), temp_profile[2].end());
+	make_E_rot_tables(min(Ti_min, T_ion), max(Ti_max, T_ion));
 
 	if (source == "O2plus_DR")
 	{
 		make_O2plus_DR_CDF(profile_bottom, profile_top);
+		O2plus_DR_sampler.init_from_CDF(O2plus_DR_CDF[0]);
 	}
 	else if (source == "O2plus_DR_old_method")
 	{
@@ -116,7 +124,7 @@ Distribution_Hot_O::~Distribution_Hot_O() {
 
 }
 
-void Distribution_Hot_O::init(shared_ptr<Particle> p)
+void Distribution_Hot_O::init(Particle &p)
 {
 	if (source == "O2plus_DR")
 	{
@@ -129,7 +137,7 @@ void Distribution_Hot_O::init(shared_ptr<Particle> p)
 }
 
 // init particle using O2plus_DR mechanism
-void Distribution_Hot_O::init_O2plus_DR_particle(shared_ptr<Particle> p)
+void Distribution_Hot_O::init_O2plus_DR_particle(Particle &p)
 {
 	// altitude distribution for O2+ dissociative recombination
 	double r = get_new_radius_O2plus_DR();
@@ -138,11 +146,8 @@ void Distribution_Hot_O::init_O2plus_DR_particle(shared_ptr<Particle> p)
 	//double temp_neut = common::interpolate_logy(temp_profile[0], temp_profile[1], alt);
 	double temp_e = common::interpolate_logy(temp_profile[0], temp_profile[3], alt);
 
-	double phi = constants::twopi*(common::get_rand());
-	double u = 2.0*common::get_rand() - 1.0;
-	double x = r*sqrt(1-(u*u))*cos(phi);
-	double y = r*sqrt(1-(u*u))*sin(phi);
-	double z = r*u;
+	double x, y, z;
+	sampling::gen_sphere_point_q(r, x, y, z);
 
 	// Hemispherical Adjustment For Dayside Photochemical Process
 	if (x < 0)
@@ -154,7 +159,7 @@ void Distribution_Hot_O::init_O2plus_DR_particle(shared_ptr<Particle> p)
 	// Probabilities and energies
 	// Particles are activated per channel to allow testing the contribution of each population in the simulation
 	double Ei = 0.0;
-	double randnum = common::get_rand();
+	double randnum = sampling::get_qrand();
 	if (randnum < 0.22)
 	{
 		Ei = 6.99*constants::ergev;
@@ -173,45 +178,39 @@ void Distribution_Hot_O::init_O2plus_DR_particle(shared_ptr<Particle> p)
 	}
 
 	// Thermal Rotational Energy of O2+
-	Ei = Ei + E_rot(3.35967e-16, temp_ion);
+	Ei = Ei + E_rot(temp_ion);
 
 	// Translational Energy per O Resulting from Dissociative Recombination of O2+
-	double v = sqrt(Ei / p->get_mass());
+	double v = sqrt(Ei / p.get_mass());
 
 	// spherically isotropic velocity vector
-	phi = constants::twopi*common::get_rand();
-	u = 2.0*common::get_rand() - 1.0;
-	double vx = v*sqrt(1-u*u)*cos(phi);
-	double vy = v*sqrt(1-u*u)*sin(phi);
-	double vz = v*u;
+	double vx, vy, vz;
+	sampling::gen_sphere_point_q(v, vx, vy, vz);
 
 	// Add initial ion and electron translational momentum
     double vavg = sqrt(constants::k_b*temp_ion/(m_O2plus));  // average thermal ion velocity
     double v_ion[] = {0.0, 0.0, 0.0};
-    gen_mb(vavg, v_ion);                               // sample from Maxwell-Boltzmann distribution
+    sampling::gen_gaussian3(vavg, v_ion);  // sample from Maxwell-Boltzmann distribution
     vavg = sqrt(constants::k_b*temp_e/constants::m_e);    //average thermal electron velocity
     double v_e[] = {0.0, 0.0, 0.0};
-    gen_mb(vavg, v_e);                                 // sample from Maxwell-Boltzmann distribution
+    sampling::gen_gaussian3(vavg, v_e);  // sample from Maxwell-Boltzmann distribution
 
     // add it all up
     vx = vx + (m_O2plus*v_ion[0] + constants::m_e*v_e[0]) / (m_O2plus+constants::m_e);
     vy = vy + (m_O2plus*v_ion[1] + constants::m_e*v_e[1]) / (m_O2plus+constants::m_e);
     vz = vz + (m_O2plus*v_ion[2] + constants::m_e*v_e[2]) / (m_O2plus+constants::m_e);
 
-    p->init_particle(x, y, z, vx, vy, vz);
+    p.init_particle(x, y, z, vx, vy, vz);
 }
 
 // init particle using Justin's original method
-void Distribution_Hot_O::init_old_way(shared_ptr<Particle> p)
+void Distribution_Hot_O::init_old_way(Particle &p)
 {
 	// altitude distribution for O2+ dissociative recombination
-	double r = my_planet.get_radius() + 160e5 - log(common::get_rand())*H_DR;
+	double r = my_planet.get_radius() + 160e5 - log(sampling::get_qrand())*H_DR;
 
-	double phi = constants::twopi*(common::get_rand());
-	double u = 2.0*common::get_rand() - 1.0;
-	double x = r*sqrt(1-(u*u))*cos(phi);
-	double y = r*sqrt(1-(u*u))*sin(phi);
-	double z = r*u;
+	double x, y, z;
+	sampling::gen_sphere_point_q(r, x, y, z);
 
 	// Hemispherical Adjustment For Dayside Photochemical Process
 	if (x < 0)
@@ -223,7 +222,7 @@ void Distribution_Hot_O::init_old_way(shared_ptr<Particle> p)
 	// Probabilities and energies
 	// Particles are activated per channel to allow testing the contribution of each population in the simulation
 	double Ei = 0.0;
-	double randnum = common::get_rand();
+	double randnum = sampling::get_qrand();
 	if (randnum < 0.22)
 	{
 		Ei = 6.99*constants::ergev;
@@ -242,70 +241,91 @@ void Distribution_Hot_O::init_old_way(shared_ptr<Particle> p)
 	}
 
 	// Thermal Rotational Energy of O2+
-	Ei = Ei + E_rot(3.35967e-16, T_ion);
+	Ei = Ei + E_rot(T_ion);
 
 	// Translational Energy per O Resulting from Dissociative Recombination of O2+
-	double v = sqrt(Ei / p->get_mass());
+	double v = sqrt(Ei / p.get_mass());
 
 	// spherically isotropic velocity vector
-	phi = constants::twopi*common::get_rand();
-	u = 2.0*common::get_rand() - 1.0;
-	double vx = v*sqrt(1-u*u)*cos(phi);
-	double vy = v*sqrt(1-u*u)*sin(phi);
-	double vz = v*u;
+	double vx, vy, vz;
+	sampling::gen_sphere_point_q(v, vx, vy, vz);
 
 	// Add initial ion and electron translational momentum
     double vavg = sqrt(constants::k_b*T_ion/(m_O2plus));  // average thermal ion velocity
     double v_ion[] = {0.0, 0.0, 0.0};
-    gen_mb(vavg, v_ion);                               // sample from Maxwell-Boltzmann distribution
+    sampling::gen_gaussian3(vavg, v_ion);  // sample from Maxwell-Boltzmann distribution
     vavg = sqrt(constants::k_b*T_e/constants::m_e);    //average thermal electron velocity
     double v_e[] = {0.0, 0.0, 0.0};
-    gen_mb(vavg, v_e);                                 // sample from Maxwell-Boltzmann distribution
+    sampling::gen_gaussian3(vavg, v_e);  // sample from Maxwell-Boltzmann distribution
 
     // add it all up
     vx = vx + (m_O2plus*v_ion[0] + constants::m_e*v_e[0]) / (m_O2plus+constants::m_e);
     vy = vy + (m_O2plus*v_ion[1] + constants::m_e*v_e[1]) / (m_O2plus+constants::m_e);
     vz = vz + (m_O2plus*v_ion[2] + constants::m_e*v_e[2]) / (m_O2plus+constants::m_e);
 
-    p->init_particle(x, y, z, vx, vy, vz);
+    p.init_particle(x, y, z, vx, vy, vz);
 }
 
-// scans O2plus_DR_CDF for new particle radius
+// draws new particle radius from O2plus_DR_CDF, uniformly distributed within the chosen altitude bin
 double Distribution_Hot_O::get_new_radius_O2plus_DR()
 {
-	double u = common::get_rand();
-	int k = 0;
-	while (O2plus_DR_CDF[0][k] < u)
+	if (sampling::using_qmc())
 	{
-		k++;
+		// a single quasi-random coordinate picks both the bin and the position within it
+		double frac;
+		int k = O2plus_DR_sampler.sample_ordered(sampling::get_qrand(), frac);
+		return O2plus_DR_CDF[1][k] + alt_bin_size*frac + my_planet.get_radius();
 	}
-	return O2plus_DR_CDF[1][k] + my_planet.get_radius();
+	int k = O2plus_DR_sampler.sample(common::get_rand());
+	return O2plus_DR_CDF[1][k] + alt_bin_size*common::get_rand() + my_planet.get_radius();
 }
 
-// Sample Rotational Energy from a Thermal Population of Rigid Rotators
-double Distribution_Hot_O::E_rot(double B, double T)
+// tabulate rotational level distributions of a thermal population of rigid rotators for temperatures from T_min to T_max
+// level j has weight (2j+1)*exp(-j(j+1)B/kT); levels above E_rot_max_level are negligible at the temperatures used here
+void Distribution_Hot_O::make_E_rot_tables(double T_min, double T_max)
 {
-	int j = 0;
-	int nj = 200;  // highest rotational level considered
-
-	// partition function using two terms of Euler-MacLaurin summation formula
-	double Q_rot = constants::k_b*T/B + 1.0/3.0;
-
-	double P_tot = 0.0;
-	double P_j = 0.0;
-	double u = common::get_rand();
+	E_rot_T_step = 10.0;
+	E_rot_T_min = T_min;
+	int num_temps = (int)ceil((T_max - T_min)/E_rot_T_step) + 1;
+	if (num_temps < 2)
+	{
+		num_temps = 2;
+	}
+	E_rot_samplers.resize(num_temps);
 
-	for (int i=0; i<(nj+1); i++)
+	vector<double> weights(E_rot_max_level+1);
+	for (int i=0; i<num_temps; i++)
 	{
-		P_j = (2.0*j+1.0)*exp(-j*(j+1)*B/(constants::k_b*T))/Q_rot;
-		P_tot = P_tot + P_j;
-		j = i;
-		if (u < P_tot)
+		double T = E_rot_T_min + i*E_rot_T_step;
+		for (int j=0; j<=E_rot_max_level; j++)
 		{
-			break;
+			weights[j] = (2.0*j+1.0)*exp(-j*(j+1.0)*B_O2plus/(constants::k_b*T));
 		}
+		E_rot_samplers[i].init(weights);
+	}
+}
+
+// Sample Rotational Energy from a Thermal Population of Rigid Rotators
+// (picks one of the two neighbouring grid temperatures with probability given by linear interpolation in T)
+double Distribution_Hot_O::E_rot(double T)
+{
+	double t = (T - E_rot_T_min)/E_rot_T_step;
+	int num_temps = E_rot_samplers.size();
+	int i = (int)t;
+	if (t <= 0.0)
+	{
+		i = 0;
+	}
+	else if (i >= num_temps - 1)
+	{
+		i = num_temps - 1;
 	}
-	return j*(j+1.0)*B;
+	else if (common::get_rand() < t - i)
+	{
+		i++;
+	}
+	int j = E_rot_samplers[i].sample(common::get_rand());
+	return j*(j+1.0)*B_O2plus;
 }
 
 // returns global production rate (needs to be set by chosen production method)
@@ -321,9 +341,36 @@ void Distribution_Hot_O::make_O2plus_DR_CDF(double lower_alt, double upper_alt)
 	ofstream outfile;
 	outfile.open("./o2plus_dr_rates.dat");
 
-	double bin_size = 10000.0; // [cm]
+	double bin_size = alt_bin_size; // [cm]
 	int num_alt_bins = (int)((upper_alt - lower_alt) / bin_size);
 	vector<double> O2plus_DR_rate;
+
+	// the CDF and rates depend only on the inputs below, so reuse them from the derived table cache if possible
+	Derived_Cache cache("Hot_O_O2plus_DR_CDF");
+	cache.add_input(temp_profile);
+	cache.add_input(O2plus_profile);
+	cache.add_input(electron_profile);
+	cache.add_input(O2plus_DR_rate_coeff);
+	cache.add_input(lower_alt);
+	cache.add_input(upper_alt);
+	cache.add_input(my_planet.get_mass());
+	cache.add_input(my_planet.get_radius());
+	vector<vector<double>> cached;
+	if (cache.load(cached))
+	{
+		O2plus_DR_CDF[0] = cached[0];
+		O2plus_DR_CDF[1] = cached[1];
+		O2plus_DR_rate = cached[2];
+		global_rate = cached[3][0];
+		for (int i=0; i<num_alt_bins; i++)
+		{
+			outfile << O2plus_DR_CDF[1][i]*1e-5 << "\t" << O2plus_DR_rate[i] << "\n";
+		}
+		outfile.close();
+		cout << "Global hot O production rate from O2+ DR:\n" << global_rate << " per second\n";
+		return;
+	}
+
 	O2plus_DR_rate.resize(num_alt_bins);
 	O2plus_DR_CDF[0].resize(num_alt_bins);
 	O2plus_DR_CDF[1].resize(num_alt_bins);
@@ -406,6 +453,7 @@ void Distribution_Hot_O::make_O2plus_DR_CDF(double lower_alt, double upper_alt)
 	double global_rate_O2plus_DR = rate_sum_times_r_sqrd*bin_size;
 	cout << "Global hot O production rate from O2+ DR:\n" << global_rate_O2plus_DR << " per second\n";
 	global_rate = global_rate_O2plus_DR;
+	cache.store({O2plus_DR_CDF[0], O2plus_DR_CDF[1], O2plus_DR_rate, {global_rate}});
 }
 
 
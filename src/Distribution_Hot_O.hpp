@@ -9,12 +9,16 @@
 #define DISTRIBUTION_HOT_O_HPP_
 
 #include "Distribution.hpp"
+#include "Derived_Cache.hpp"
+#include "Alias_Sampler.hpp"
+
+const int E_rot_max_level = 200;  // highest rotational level of O2plus considered
 
 class Distribution_Hot_O: public Distribution {
 public:
 	Distribution_Hot_O(Planet my_p, double ref_h, double ref_T);
 	virtual ~Distribution_Hot_O();
-	void init(shared_ptr<Particle> p);
+	void init(Particle &p);
 	double get_global_rate();
 
 private:
@@ -35,21 +39,32 @@ private:
 	vector<vector<double>> electron_profile; // stores the imported electron density profile
 	vector<vector<double>> temp_profile;  // stores the imported temperature profiles (4-column csv expected: altitude(cm), neutral_temp(K), ion_temp(K), electron_temp(K))
 	vector<vector<double>> O2plus_DR_CDF; // stores an inverse CDF made using the O2plus_DR production rate profile
+	double alt_bin_size;                  // [cm] width of altitude bins in O2plus_DR_CDF
+	Alias_Sampler O2plus_DR_sampler;      // alias table for drawing altitude bins from O2plus_DR_CDF
 
-	// scans O2plus_DR_CDF for new particle radius
+	// draws new particle radius from O2plus_DR_CDF
 	double get_new_radius_O2plus_DR();
 
 	// init particle using O2plus_DR mechanism
-	void init_O2plus_DR_particle(shared_ptr<Particle> p);
+	void init_O2plus_DR_particle(Particle &p);
 
 	// init particle using Justin's original method
-	void init_old_way(shared_ptr<Particle> p);
+	void init_old_way(Particle &p);
 
 	// generate O2plus_DR_CDF for given altitude range using imported density/temp profiles
 	void make_O2plus_DR_CDF(double lower_alt, double upper_alt);
 
-	// calculate rotational energy of O2plus ion
-	double E_rot(double B, double T);
+	// rotational level distributions of O2plus on a temperature grid, used by E_rot
+	double B_O2plus;                         // [erg] rotational constant of O2plus
+	double E_rot_T_min;                      // [K] lowest temperature in grid
+	double E_rot_T_step;                     // [K] temperature grid spacing
+	vector<Alias_Sampler> E_rot_samplers;    // alias table over rotational levels j = 0..E_rot_max_level at each grid temperature
+
+	// tabulate rotational level distributions for temperatures from T_min to T_max
+	void make_E_rot_tables(double T_min, double T_max);
+
+	// sample rotational energy of O2plus ion at temperature T
+	double E_rot(double T);
 };
 
 #endif /* DISTRIBUTION_HOT_O_HPP_ */
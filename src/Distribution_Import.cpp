@@ -6,42 +6,160 @@
  */
 
 #include "Distribution_Import.hpp"
+#include <charconv>
+#include <cstring>
+
+// read the first three whitespace-separated numbers of each non-blank line of filename into cols
+static void read_text_columns(string filename, vector<double> cols[3])
+{
+	ifstream infile(filename, ios::binary);
+	if (!infile.good())
+	{
+		cout << "Could not open particle import file \"" << filename << "\"!\n";
+		exit(1);
+	}
+	infile.seekg(0, ios::end);
+	string buf(infile.tellg(), '\0');
+	infile.seekg(0, ios::beg);
+	infile.read(&buf[0], buf.size());
+	infile.close();
+
+	// reserve using a rough guess of the line length so that the columns are not regrown many times
+	for (int j=0; j<3; j++)
+	{
+		cols[j].clear();
+		cols[j].reserve(buf.size()/48 + 1);
+	}
+
+	const char *p = buf.data();
+	const char *end = p + buf.size();
+	int line_num = 0;
+	while (p < end)
+	{
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+		if (eol == NULL)
+		{
+			eol = end;
+		}
+		line_num++;
+
+		double val[3];
+		int n = 0;
+		const char *q = p;
+		while (n < 3)
+		{
+			while (q < eol && isspace((unsigned char)*q))
+			{
+				q++;
+			}
+			if (q == eol)
+			{
+				break;
+			}
+			if (*q == '+')
+			{
+				q++;
+			}
+			from_chars_result r = from_chars(q, eol, val[n]);
+			if (r.ec != errc())
+			{
+				cout << "Invalid number on line " << line_num << " of particle import file \"" << filename << "\"!\n";
+				exit(1);
+			}
+			q = r.ptr;
+			n++;
+		}
+		if (n == 3)
+		{
+			for (int j=0; j<3; j++)
+			{
+				cols[j].push_back(val[j]);
+			}
+		}
+		else if (n > 0)
+		{
+			cout << "Line " << line_num << " of particle import file \"" << filename << "\" has fewer than 3 values!\n";
+			exit(1);
+		}
+		p = eol + 1;
+	}
+}
 
 Distribution_Import::Distribution_Import(Planet my_p, double ref_h, double ref_T, string pos_file, string vel_file)
 	: Distribution(my_p, ref_h, ref_T) {
 	num_particles = 0;
 	next_index = 0;
+	species = NULL;
+	ids = NULL;
 
-	ifstream pos_input, vel_input;
-	pos_input.open(pos_file);
-	vel_input.open(vel_file);
-	string pos_line, vel_line;
-
-	while (getline(pos_input, pos_line) && getline(vel_input, vel_line))
+	if (Particle_File::is_particle_file(pos_file))
 	{
-		num_particles++;
-		stringstream str_pos(pos_line);
-		stringstream str_vel(vel_line);
-
-		positions.conservativeResize(positions.rows()+1, NoChange);
-		velocities.conservativeResize(velocities.rows()+1, NoChange);
-
-		str_pos >> positions(positions.rows()-1, 0) >> positions(positions.rows()-1, 1) >> positions(positions.rows()-1, 2);
-		str_vel >> velocities(velocities.rows()-1, 0) >> velocities(velocities.rows()-1, 1) >> velocities(velocities.rows()-1, 2);
+		if (!particle_file.open(pos_file))
+		{
+			cout << "Could not read particle file \"" << pos_file << "\"!\n";
+			exit(1);
+		}
+		num_particles = particle_file.get_num_particles();
+		for (int j=0; j<6; j++)
+		{
+			columns[j] = particle_file.get_column(j);
+		}
+		species = particle_file.get_species();
+		ids = particle_file.get_ids();
+		if (species != NULL)
+		{
+			for (int i=0; i<num_particles; i++)
+			{
+				if (species[i] < 0 || species[i] >= num_species_types)
+				{
+					cout << "Unknown species id " << species[i] << " in particle file \"" << pos_file << "\"!\n";
+					exit(1);
+				}
+			}
+		}
+		if (particle_file.has_weights())
+		{
+			cout << "Particle weights in \"" << pos_file << "\" are ignored (particles are tallied with equal weight)\n";
+		}
+		cout << "Importing " << num_particles << " particles from particle file " << pos_file << "\n";
+	}
+	else
+	{
+		read_text(pos_file, vel_file);
+		for (int j=0; j<6; j++)
+		{
+			columns[j] = text_columns[j].data();
+		}
+		cout << "Importing " << num_particles << " particles from " << pos_file << " and " << vel_file << "\n";
 	}
-	pos_input.close();
-	vel_input.close();
 }
 
 Distribution_Import::~Distribution_Import() {
 
 }
 
-void Distribution_Import::init(shared_ptr<Particle> p)
+void Distribution_Import::read_text(string pos_file, string vel_file)
+{
+	read_text_columns(pos_file, &text_columns[0]);
+	read_text_columns(vel_file, &text_columns[3]);
+
+	num_particles = min(text_columns[0].size(), text_columns[3].size());
+	if (text_columns[0].size() != text_columns[3].size())
+	{
+		cout << "Position and velocity import files have different numbers of particles; using the first " << num_particles << "\n";
+	}
+}
+
+void Distribution_Import::init(Particle &p)
 {
 	if (next_index < num_particles)
 	{
-		p->init_particle(positions(next_index, 0), positions(next_index, 1), positions(next_index, 2), velocities(next_index, 0), velocities(next_index, 1), velocities(next_index, 2));
+		int row = next_index;
+		if (species != NULL && species[row] != p.get_species())
+		{
+			p = Particle(species[row]);
+		}
+		p.init_particle(columns[0][row], columns[1][row], columns[2][row], columns[3][row], columns[4][row], columns[5][row]);
 		next_index++;
 	}
 	else
@@ -50,6 +168,36 @@ void Distribution_Import::init(shared_ptr<Particle> p)
 	}
 }
 
+// particle parts.id[i] takes row parts.id[i] of the imported states (no random numbers needed), and the id that row
+// had in the run that wrote the particle file, if the file has ids
+void Distribution_Import::init_batch(Particle_Store &parts, int begin, int end, int /*rng_stream*/)
+{
+	for (int i=begin; i<end; i++)
+	{
+		int row = parts.id[i];
+		if (row >= num_particles)
+		{
+			cout << "End of available particles in imported distribution met!" << endl;
+			exit(1);
+		}
+		parts.x[i] = columns[0][row];
+		parts.y[i] = columns[1][row];
+		parts.z[i] = columns[2][row];
+		parts.vx[i] = columns[3][row];
+		parts.vy[i] = columns[4][row];
+		parts.vz[i] = columns[5][row];
+		parts.source[i] = 0;
+		if (species != NULL)
+		{
+			parts.species[i] = species[row];
+		}
+		if (ids != NULL)
+		{
+			parts.id[i] = ids[row];
+		}
+	}
+}
+
 double Distribution_Import::get_global_rate()
 {
 	return 0.0;
@@ -12,20 +12,32 @@
 #include <sstream>
 #include <fstream>
 #include "Distribution.hpp"
+#include "Particle_File.hpp"
 using namespace std;
 
+// initializes particles from a set of imported particle states, either
+//   - a binary particle file (see Particle_File.hpp, e.g. a snapshot written by a previous run) given as pos_file,
+//     which is memory-mapped and read row by row as particles are initialized, or
+//   - a pair of text files of x, y, z positions [cm] and vx, vy, vz velocities [cm/s], one particle per line
 class Distribution_Import: public Distribution {
 public:
 	Distribution_Import(Planet my_p, double ref_h, double ref_T, string pos_file, string vel_file);
 	virtual ~Distribution_Import();
-	void init(shared_ptr<Particle> p);
+	void init(Particle &p);
+	void init_batch(Particle_Store &parts, int begin, int end, int rng_stream);
 	double get_global_rate();
 
 private:
 	int num_particles;
-	int next_index;
-	Matrix<double, Dynamic, 3> positions;
-	Matrix<double, Dynamic, 3> velocities;
+	int next_index;   // next row handed out by init()
+	const double *columns[6];   // x, y, z, vx, vy, vz of every row (in particle_file or text_columns)
+	const int32_t *species;     // species id of every row, or NULL to keep the species particles were made with
+	const int32_t *ids;         // particle id of every row, or NULL to keep the ids particles were made with
+	Particle_File particle_file;
+	vector<double> text_columns[6];
+
+	// read positions and velocities from text files into text_columns
+	void read_text(string pos_file, string vel_file);
 };
 
 #endif /* DISTRIBUTION_IMPORT_HPP_ */
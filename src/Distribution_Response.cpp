@@ -0,0 +1,184 @@
+/*
+ * Distribution_Response.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Distribution_Response.hpp"
+#include <fstream>
+#include <iomanip>
+
+Distribution_Response::Distribution_Response(Planet my_p, double ref_h, double ref_T, double alt_lo, double alt_hi, int num_alts, double E_lo, double E_hi, int num_Es, int num_cos)
+	: Distribution(my_p, ref_h, ref_T) {
+	alt_min = alt_lo;
+	alt_max = alt_hi;
+	num_alt_bins = num_alts;
+	energy_min = E_lo;
+	energy_max = E_hi;
+	num_energy_bins = num_Es;
+	num_cos_bins = num_cos;
+	next_index = 0;
+
+	if (num_alt_bins < 1 || num_energy_bins < 1 || num_cos_bins < 1 || !(alt_max > alt_min) || !(energy_max > energy_min) || energy_min < 0.0)
+	{
+		cout << "Invalid escape response grid! Please check response options in configuration file.\n";
+		exit(1);
+	}
+	num_cells = num_alt_bins*num_energy_bins*num_cos_bins;
+	escaped_day.assign(num_cells, 0);
+	escaped_night.assign(num_cells, 0);
+	cout << "Escape response mode: " << num_alt_bins << " altitude x " << num_energy_bins << " energy x " << num_cos_bins << " direction bins\n";
+}
+
+Distribution_Response::~Distribution_Response() {
+
+}
+
+void Distribution_Response::init(Particle &p)
+{
+	double x, y, z, vx, vy, vz;
+	sampling::set_qmc_point(next_index / num_cells);
+	init_in_cell(next_index, p.get_mass(), x, y, z, vx, vy, vz);
+	p.init_particle(x, y, z, vx, vy, vz);
+	next_index++;
+}
+
+// particle parts.id[i] is launched in cell parts.id[i] % num_cells
+void Distribution_Response::init_batch(Particle_Store &parts, int begin, int end, int rng_stream)
+{
+	common::set_rand_stream(rng_stream);
+	for (int i=begin; i<end; i++)
+	{
+		// with quasi-random initial conditions, the launches within a cell take consecutive points of the sequence
+		sampling::set_qmc_point(parts.id[i] / num_cells);
+		init_in_cell(parts.id[i], species_table[parts.species[i]].mass, parts.x[i], parts.y[i], parts.z[i], parts.vx[i], parts.vy[i], parts.vz[i]);
+		parts.source[i] = 0;
+	}
+}
+
+void Distribution_Response::init_in_cell(int id, double mass, double &x, double &y, double &z, double &vx, double &vy, double &vz)
+{
+	int cell = id % num_cells;
+	int a = cell / (num_energy_bins*num_cos_bins);
+	int e = (cell / num_cos_bins) % num_energy_bins;
+	int c = cell % num_cos_bins;
+
+	double alt_bin_size = (alt_max - alt_min)/num_alt_bins;
+	double energy_bin_size = (energy_max - energy_min)/num_energy_bins;
+	double cos_bin_size = 2.0/num_cos_bins;
+
+	double r = my_planet.get_radius() + alt_min + alt_bin_size*(a + sampling::get_qrand());
+	double energy = (energy_min + energy_bin_size*(e + sampling::get_qrand()))*constants::ergev;
+	double mu = -1.0 + cos_bin_size*(c + sampling::get_qrand());
+
+	// Hemispherical Adjustment For Dayside Photochemical Process
+	sampling::gen_sphere_point_q(r, x, y, z);
+	if (x < 0)
+	{
+		x = -x;
+	}
+
+	// velocity at angle acos(mu) from local vertical: build two unit vectors perpendicular to the radial direction
+	double ux = x/r;
+	double uy = y/r;
+	double uz = z/r;
+	double e1x, e1y, e1z;
+	if (abs(uz) < 0.9)
+	{
+		double s = sqrt(ux*ux + uy*uy);
+		e1x = -uy/s;
+		e1y = ux/s;
+		e1z = 0.0;
+	}
+	else
+	{
+		double s = sqrt(uy*uy + uz*uz);
+		e1x = 0.0;
+		e1y = -uz/s;
+		e1z = uy/s;
+	}
+	double e2x = uy*e1z - uz*e1y;
+	double e2y = uz*e1x - ux*e1z;
+	double e2z = ux*e1y - uy*e1x;
+
+	double cos_phi, sin_phi;
+	if (sampling::using_qmc())
+	{
+		double phi = constants::twopi*sampling::get_qrand();
+		cos_phi = cos(phi);
+		sin_phi = sin(phi);
+	}
+	else
+	{
+		common::get_rand_azimuth(cos_phi, sin_phi);
+	}
+	double v = sqrt(2.0*energy/mass);
+	double v_perp = v*sqrt(max(1.0 - mu*mu, 0.0));
+	vx = v*mu*ux + v_perp*(cos_phi*e1x + sin_phi*e2x);
+	vy = v*mu*uy + v_perp*(cos_phi*e1y + sin_phi*e2y);
+	vz = v*mu*uz + v_perp*(cos_phi*e1z + sin_phi*e2z);
+}
+
+// particles are launched on a grid rather than by a production mechanism, so there is no production rate
+double Distribution_Response::get_global_rate()
+{
+	return 0.0;
+}
+
+void Distribution_Response::count_escape(int id, bool day)
+{
+	if (day)
+	{
+		escaped_day[id % num_cells]++;
+	}
+	else
+	{
+		escaped_night[id % num_cells]++;
+	}
+}
+
+// launched particles with id < end in cell
+static int count_launched(int cell, int end, int num_cells)
+{
+	return end/num_cells + (cell < end % num_cells ? 1 : 0);
+}
+
+// escape probability per cell with its Agresti-Coull standard error (at z = 1): sqrt(p~(1-p~)/n~) with
+// n~ = n + 1 and p~ = (escaped + 1/2)/n~, which unlike sqrt(p(1-p)/n) does not vanish for cells where none or all
+// of the particles escaped
+void Distribution_Response::output_table(int first_id, int num_launched, string filename)
+{
+	ofstream outfile(filename);
+	if (!outfile.good())
+	{
+		cout << "Could not open \"" << filename << "\" for writing!\n";
+		return;
+	}
+	double alt_bin_size = (alt_max - alt_min)/num_alt_bins;
+	double energy_bin_size = (energy_max - energy_min)/num_energy_bins;
+	double cos_bin_size = 2.0/num_cos_bins;
+
+	outfile << "# escape response table (dist_type Response); cos is the cosine of the angle between birth velocity and local vertical\n";
+	outfile << "# planet_radius " << setprecision(10) << my_planet.get_radius() << "\n";
+	outfile << "# grid " << num_alt_bins << " " << num_energy_bins << " " << num_cos_bins << "\n";
+	outfile << "# alt_min[cm],alt_max[cm],energy_min[eV],energy_max[eV],cos_min,cos_max,launched,escaped_day,escaped_night,escape_prob,escape_prob_err\n";
+	for (int cell=0; cell<num_cells; cell++)
+	{
+		int a = cell / (num_energy_bins*num_cos_bins);
+		int e = (cell / num_cos_bins) % num_energy_bins;
+		int c = cell % num_cos_bins;
+		int n = count_launched(cell, first_id + num_launched, num_cells) - count_launched(cell, first_id, num_cells);
+		int escaped = escaped_day[cell] + escaped_night[cell];
+		double prob = (n > 0) ? (double)escaped/(double)n : 0.0;
+		double prob_ac = (escaped + 0.5)/(n + 1.0);
+		double err = (n > 0) ? sqrt(prob_ac*(1.0 - prob_ac)/(n + 1.0)) : 0.0;
+
+		outfile << setprecision(10) << alt_min + alt_bin_size*a << "," << alt_min + alt_bin_size*(a+1) << ",";
+		outfile << energy_min + energy_bin_size*e << "," << energy_min + energy_bin_size*(e+1) << ",";
+		outfile << -1.0 + cos_bin_size*c << "," << -1.0 + cos_bin_size*(c+1) << ",";
+		outfile << n << "," << escaped_day[cell] << "," << escaped_night[cell] << ",";
+		outfile << setprecision(6) << prob << "," << err << "\n";
+	}
+	outfile.close();
+}
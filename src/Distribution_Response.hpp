@@ -0,0 +1,54 @@
+/*
+ * Distribution_Response.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef DISTRIBUTION_RESPONSE_HPP_
+#define DISTRIBUTION_RESPONSE_HPP_
+
+#include <string>
+#include <vector>
+#include "Distribution.hpp"
+using namespace std;
+
+// escape response mode: instead of following one production mechanism, particles are launched stratified over a grid
+// of cells in birth altitude, birth energy and (optionally) cosine of the angle between velocity and local vertical;
+// particle id goes to cell id % num_cells, and within its cell a particle's altitude, energy and direction cosine are
+// uniformly distributed (azimuth is uniform, birth positions are on the day side as for the photochemical sources)
+//
+// escapes are counted per cell, and output_table writes escape probabilities per cell that corona3d_convolve can
+// combine with any production profile without rerunning transport
+class Distribution_Response: public Distribution {
+public:
+	Distribution_Response(Planet my_p, double ref_h, double ref_T, double alt_lo, double alt_hi, int num_alts, double E_lo, double E_hi, int num_Es, int num_cos);
+	virtual ~Distribution_Response();
+	void init(Particle &p);
+	void init_batch(Particle_Store &parts, int begin, int end, int rng_stream);
+	double get_global_rate();
+
+	// count an escape of particle id (on the day side if day is set)
+	void count_escape(int id, bool day);
+
+	// write escape probabilities per cell, for a run that launched particles first_id..first_id+num_launched-1
+	void output_table(int first_id, int num_launched, string filename);
+
+private:
+	double alt_min;        // [cm] bottom of altitude grid (above surface)
+	double alt_max;        // [cm] top of altitude grid
+	int num_alt_bins;
+	double energy_min;     // [eV] bottom of energy grid
+	double energy_max;     // [eV] top of energy grid
+	int num_energy_bins;
+	int num_cos_bins;      // bins in cosine of angle from local vertical over [-1, 1] (1 means isotropic)
+	int num_cells;
+	int next_index;        // next particle id handed out by init()
+	vector<int> escaped_day;    // escapes counted in each cell
+	vector<int> escaped_night;
+
+	// init particle state in cell of particle id (mass in g); uses the calling thread's random numbers
+	void init_in_cell(int id, double mass, double &x, double &y, double &z, double &vx, double &vy, double &vz);
+};
+
+#endif /* DISTRIBUTION_RESPONSE_HPP_ */
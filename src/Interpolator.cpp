@@ -38,7 +38,7 @@ Interpolator::~Interpolator() {
 
 // return linearly interpolated y value for given x value
 // if x outside boundaries returns either highest or lowest stored y value
-double Interpolator::linterp(double x)
+double Interpolator::linterp(double x) const
 {
 	double val = 0.0;
 
@@ -63,7 +63,7 @@ double Interpolator::linterp(double x)
 
 // return log-linearly interpolated y value for given x (use if y is on a logarithmic scale in input file)
 // if x outside boundaries returns either highest or lowest stored y value
-double Interpolator::loglinterp(double x)
+double Interpolator::loglinterp(double x) const
 {
 	double val = 0.0;
 
@@ -19,11 +19,11 @@ public:
 
 	// return linearly interpolated y value for given x value
 	// if x outside boundaries returns either highest or lowest stored y value
-	double linterp(double x);
+	double linterp(double x) const;
 
 	// return log-linearly interpolated y value for given x (use if y is on a logarithmic scale in input file)
 	// if x outside boundaries returns either highest or lowest stored y value
-	double loglinterp(double x);
+	double loglinterp(double x) const;
 
 private:
 	int size;
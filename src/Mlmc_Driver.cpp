@@ -0,0 +1,285 @@
+/*
+ * Mlmc_Driver.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Mlmc_Driver.hpp"
+#include <chrono>
+#include <climits>
+
+Mlmc_Driver::Mlmc_Driver(Planet p, const Particle &part, shared_ptr<Distribution> dist, const Background_Species &bg, int num_EDFs, int EDF_alts[], int threads)
+	: bg_species(bg)
+{
+	my_planet = p;
+	part_template = part;
+	my_dist = dist;
+	this->num_EDFs = num_EDFs;
+	this->EDF_alts.assign(EDF_alts, EDF_alts + num_EDFs);
+	num_threads = threads;
+
+	rate = 0.0;
+	next_id = 0;
+}
+
+Mlmc_Driver::~Mlmc_Driver() {
+
+}
+
+void Mlmc_Driver::run(const Run_Options &options, double tolerance, int max_levels, int initial_parts)
+{
+	double dt = options.dt;
+	int num_steps = options.num_steps;
+	if (max_levels < 0 || max_levels > 30 || ((long long)num_steps << max_levels) > INT_MAX)
+	{
+		cout << "MLMC: too many levels (" << max_levels << ") for " << num_steps << " timesteps; the finest level would need more than " << INT_MAX << " steps!\n";
+		exit(1);
+	}
+	level_options = Run_Options();
+	level_options.lower_bound = options.lower_bound;
+	level_options.upper_bound = options.upper_bound;
+	level_options.track_length_stats = options.track_length_stats;
+	level_options.method = options.method;
+	rate = my_dist->get_global_rate() / 2.0;
+	next_id = 0;
+	levels.clear();
+
+	// start with levels 0 and 1, since the bias can only be estimated from a correction
+	int L = min(1, max_levels);
+	vector<long long> targets;
+	double bias = 0.0;
+	bool converged = false;
+	while (!converged)
+	{
+		while ((int)levels.size() <= L)
+		{
+			int l = levels.size();
+			Mlmc_Level level;
+			level.dt = dt / (double)(1 << l);
+			level.num_steps = num_steps << l;
+			level.num_samples = 0;
+			level.cost = 0.0;
+			level.sum = 0.0;
+			level.sum2 = 0.0;
+			level.num_batches = 0;
+			levels.push_back(level);
+			targets.push_back(initial_parts);
+			cout << "MLMC: starting level " << l << " (dt = " << level.dt << " s, " << level.num_steps << " steps)\n";
+		}
+
+		// bring each level up to its target, in two batches the first time so that every level has a batch variance
+		for (int l=0; l<=L; l++)
+		{
+			long long needed = targets[l] - levels[l].num_samples;
+			if (levels[l].num_samples == 0 && needed > 1)
+			{
+				run_batch(l, needed/2);
+				needed = needed - needed/2;
+			}
+			while (needed > 0)
+			{
+				int n = (int)min(needed, (long long)mlmc_max_batch);
+				run_batch(l, n);
+				needed = needed - n;
+			}
+		}
+
+		// optimal number of particles per level for the statistical error to be tolerance/sqrt(2)
+		double sum_vc = 0.0;
+		for (int l=0; l<=L; l++)
+		{
+			sum_vc = sum_vc + sqrt(get_variance(l)*get_cost(l));
+		}
+		bool more_samples = false;
+		for (int l=0; l<=L; l++)
+		{
+			long long optimal = (long long)ceil(2.0/(tolerance*tolerance) * sqrt(get_variance(l)/get_cost(l)) * sum_vc);
+			if (optimal > levels[l].num_samples)
+			{
+				targets[l] = optimal;
+				more_samples = true;
+			}
+		}
+		if (more_samples)
+		{
+			continue;
+		}
+
+		// remaining timestep bias, assuming it halves from one level to the next (first order in dt)
+		bias = (L == 0) ? 0.0 : fabs(get_mean(L));
+		if (L >= 2)
+		{
+			bias = max(bias, 0.5*fabs(get_mean(L-1)));
+		}
+		if (bias <= tolerance/sqrt(2.0))
+		{
+			converged = true;
+		}
+		else if (L >= max_levels)
+		{
+			cout << "MLMC: estimated timestep bias " << bias << " is still above tolerance at the maximum number of levels (" << max_levels << ")\n";
+			converged = true;
+		}
+		else
+		{
+			L++;
+		}
+	}
+
+	output_results(tolerance, bias, options.output_stats_dir);
+}
+
+// run n more particles on level l, adding to its sums
+void Mlmc_Driver::run_batch(int l, int n)
+{
+	Mlmc_Level &level = levels[l];
+	long long first_id = next_id;
+	next_id = next_id + ((n + init_chunk_size - 1) / init_chunk_size) * init_chunk_size;
+
+	auto start = chrono::steady_clock::now();
+	vector<double> escaped, dens[2];
+	run_particles(n, first_id, level.dt, level.num_steps, escaped, dens);
+	if (l > 0)
+	{
+		// same particles and collision draws with twice the timestep
+		vector<double> escaped_coarse, dens_coarse[2];
+		run_particles(n, first_id, 2.0*level.dt, level.num_steps/2, escaped_coarse, dens_coarse);
+		for (int i=0; i<n; i++)
+		{
+			escaped[i] = escaped[i] - escaped_coarse[i];
+		}
+		for (int side=0; side<2; side++)
+		{
+			for (unsigned j=0; j<dens[side].size(); j++)
+			{
+				dens[side][j] = dens[side][j] - dens_coarse[side][j];
+			}
+		}
+	}
+	level.cost = level.cost + chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	for (int i=0; i<n; i++)
+	{
+		level.sum = level.sum + escaped[i];
+		level.sum2 = level.sum2 + escaped[i]*escaped[i];
+	}
+	for (int side=0; side<2; side++)
+	{
+		level.dens_sum[side].resize(dens[side].size(), 0.0);
+		level.dens_sum2[side].resize(dens[side].size(), 0.0);
+		for (unsigned j=0; j<dens[side].size(); j++)
+		{
+			level.dens_sum[side][j] = level.dens_sum[side][j] + n*dens[side][j];
+			level.dens_sum2[side][j] = level.dens_sum2[side][j] + n*dens[side][j]*dens[side][j];
+		}
+	}
+	level.num_samples = level.num_samples + n;
+	level.num_batches++;
+}
+
+void Mlmc_Driver::run_particles(int n, long long first_id, double dt, int num_steps, vector<double> &escaped, vector<double> dens[2])
+{
+	vector<Particle> parts(n, part_template);
+	Atmosphere atm(n, 0, "", my_planet, parts, my_dist, bg_species, num_EDFs, EDF_alts.data(), num_threads, (int)first_id);
+	atm.set_coupled_collisions(true);
+	Run_Options run = level_options;
+	run.dt = dt;
+	run.num_steps = num_steps;
+	atm.run_simulation(run);
+
+	escaped.resize(n);
+	for (int i=0; i<n; i++)
+	{
+		Particle_Fate fate = atm.get_fate(i);
+		escaped[i] = (fate == fate_escaped_day || fate == fate_escaped_night) ? 1.0 : 0.0;
+	}
+	for (int side=0; side<2; side++)
+	{
+		dens[side] = atm.get_density_profile(side, dt, rate);
+	}
+}
+
+double Mlmc_Driver::get_mean(int l) const
+{
+	return levels[l].sum / (double)levels[l].num_samples;
+}
+
+// variance of a single particle's contribution to level l
+double Mlmc_Driver::get_variance(int l) const
+{
+	const Mlmc_Level &level = levels[l];
+	if (level.num_samples < 2)
+	{
+		return 0.0;
+	}
+	double mean = get_mean(l);
+	return max(level.sum2 - level.num_samples*mean*mean, 0.0) / (double)(level.num_samples - 1);
+}
+
+// wall time per particle on level l
+double Mlmc_Driver::get_cost(int l) const
+{
+	return max(levels[l].cost / (double)levels[l].num_samples, 1e-9);
+}
+
+void Mlmc_Driver::output_results(double tolerance, double bias, string output_dir) const
+{
+	int L = levels.size() - 1;
+	double escape_fraction = 0.0;
+	double escape_variance = 0.0;
+	for (int l=0; l<=L; l++)
+	{
+		escape_fraction = escape_fraction + get_mean(l);
+		escape_variance = escape_variance + get_variance(l) / (double)levels[l].num_samples;
+	}
+
+	cout << "MLMC levels:\n";
+	cout << "\tlevel\tdt[s]\tparticles\tcost[s/particle]\tmean\tvariance\n";
+	for (int l=0; l<=L; l++)
+	{
+		cout << "\t" << l << "\t" << levels[l].dt << "\t" << levels[l].num_samples << "\t\t" << get_cost(l) << "\t\t" << get_mean(l) << "\t" << get_variance(l) << "\n";
+	}
+	cout << "MLMC escape fraction: " << escape_fraction << " +/- " << sqrt(escape_variance) << " (statistical), estimated timestep bias " << bias << ", tolerance " << tolerance << endl;
+	cout << "MLMC total loss rate: " << escape_fraction*rate << " +/- " << sqrt(escape_variance)*rate << endl;
+
+	ofstream summary_out(output_dir + "mlmc_summary.out");
+	summary_out << "#multilevel Monte Carlo over timestep resolution; level l >= 1 is the difference between timesteps dt and 2*dt\n";
+	summary_out << "#escape fraction " << escape_fraction << "\n";
+	summary_out << "#statistical error " << sqrt(escape_variance) << "\n";
+	summary_out << "#estimated timestep bias " << bias << "\n";
+	summary_out << "#total loss rate[s-1] " << escape_fraction*rate << "\n";
+	summary_out << "#level\tdt[s]\tparticles\tcost[s/particle]\tmean\tvariance\n";
+	for (int l=0; l<=L; l++)
+	{
+		summary_out << l << "\t" << levels[l].dt << "\t" << levels[l].num_samples << "\t" << get_cost(l) << "\t" << get_mean(l) << "\t" << get_variance(l) << "\n";
+	}
+	summary_out.close();
+
+	// density profiles: sum of the level means, with errors from the spread between batches within each level
+	string side_names[2] = {"day", "night"};
+	int num_bins = min((int)levels[0].dens_sum[0].size(), (int)(1e-5*level_options.upper_bound) + 1);
+	for (int side=0; side<2; side++)
+	{
+		ofstream dens_out(output_dir + "mlmc_density1d_" + side_names[side] + ".out");
+		dens_out << "#alt[km]\tdensity[cm-3]\tstd error[cm-3]\n";
+		for (int j=0; j<num_bins; j++)
+		{
+			double dens = 0.0;
+			double variance = 0.0;
+			for (int l=0; l<=L; l++)
+			{
+				const Mlmc_Level &level = levels[l];
+				double mean = level.dens_sum[side][j] / (double)level.num_samples;
+				dens = dens + mean;
+				if (level.num_batches > 1)
+				{
+					double spread = max(level.dens_sum2[side][j] - level.num_samples*mean*mean, 0.0) / (double)(level.num_batches - 1);
+					variance = variance + spread / (double)level.num_samples;
+				}
+			}
+			dens_out << j << "\t\t" << dens << "\t" << sqrt(variance) << "\n";
+		}
+		dens_out.close();
+	}
+}
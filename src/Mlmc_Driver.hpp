@@ -0,0 +1,82 @@
+/*
+ * Mlmc_Driver.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef MLMC_DRIVER_HPP_
+#define MLMC_DRIVER_HPP_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include "Atmosphere.hpp"
+using namespace std;
+
+// largest number of particles run at once (more are run in several batches)
+const int mlmc_max_batch = 262144;
+
+// sums for one level of the multilevel estimator
+struct Mlmc_Level {
+	double dt;                  // fine timestep of the level
+	int num_steps;              // number of fine timesteps (same total simulated time on every level)
+	long long num_samples;      // particles run so far (each run twice, at dt and 2*dt, on levels above 0)
+	double cost;                // wall time spent on the level so far [s]
+	double sum;                 // sum over particles of the escape indicator (level 0) or its fine-coarse difference
+	double sum2;                // sum of squares of the above
+	int num_batches;
+	vector<double> dens_sum[2];   // [side][bin] sum over batches of (batch size) * (batch density or density difference)
+	vector<double> dens_sum2[2];  // [side][bin] sum over batches of (batch size) * (batch value)^2
+};
+
+// multilevel Monte Carlo over timestep resolution (Giles 2008)
+// level 0 runs particles with the coarsest timestep; level l > 0 runs the same particles with timesteps dt/2^l and
+// dt/2^(l-1), with collision draws keyed by particle and candidate collision (see Background_Species::collide_coupled)
+// so that the two runs meet the same collisions and differ only through the timestep, and estimates the correction
+// from one resolution to the next; every run uses the same coupled collision model, so the level 0 estimate plus the
+// corrections estimates the finest-timestep result with far fewer fine-timestep particles
+// particles per level follow from the measured variance and cost of each level, and levels are added until the last
+// correction of the escape fraction puts the remaining timestep bias below the tolerance; the density profiles are
+// summed over the same levels, but their bias is not estimated or tested
+class Mlmc_Driver {
+public:
+	Mlmc_Driver(Planet p, const Particle &part, shared_ptr<Distribution> dist, const Background_Species &bg, int num_EDFs, int EDF_alts[], int threads);
+	virtual ~Mlmc_Driver();
+
+	// options.dt and options.num_steps set level 0, and results go to options.output_stats_dir; of the other options,
+	// the simulation boundaries, the stats estimator, and the integrator are used (every level runs serially, with
+	// fixed steps and without sorting or other outputs); tolerance is the target root-mean-square error of the
+	// escape fraction; initial_parts is the number of particles used to first estimate each level's variance and cost;
+	// the finest level runs num_steps*2^max_levels steps, which must fit in an int
+	void run(const Run_Options &options, double tolerance, int max_levels, int initial_parts);
+
+private:
+	Planet my_planet;
+	Particle part_template;
+	shared_ptr<Distribution> my_dist;
+	const Background_Species &bg_species;
+	int num_EDFs;
+	vector<int> EDF_alts;
+	int num_threads;
+
+	Run_Options level_options;  // run_simulation options of every run (dt and num_steps are set per run; no stats files)
+	double rate;                // production rate represented by the particles (as in run_simulation output)
+	long long next_id;          // first particle id of the next batch
+	vector<Mlmc_Level> levels;
+
+	// run n more particles on level l
+	void run_batch(int l, int n);
+
+	// run n particles with timestep dt starting from particle id first_id, with coupled collisions; fills escaped[i]
+	// with 1 or 0 and dens[side] with the density profiles
+	void run_particles(int n, long long first_id, double dt, int num_steps, vector<double> &escaped, vector<double> dens[2]);
+
+	double get_mean(int l) const;
+	double get_variance(int l) const;
+	double get_cost(int l) const;
+
+	void output_results(double tolerance, double bias, string output_dir) const;
+};
+
+#endif /* MLMC_DRIVER_HPP_ */
@@ -0,0 +1,248 @@
+/*
+ * Numa_Topology.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Numa_Topology.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <cctype>
+#include <dirent.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+static string pin_policy = "none";
+static vector<vector<int>> node_cpus;   // allowed CPUs of each node (nodes without any are left out)
+static vector<int> node_id;             // operating system id of each node
+static vector<int> placement;           // CPU for worker w is placement[w % placement.size()] (empty without pinning)
+static vector<int> cpu_node;            // node of each CPU
+
+// parse a sysfs CPU list such as "0-3,8-11"
+static vector<int> parse_cpu_list(string list)
+{
+	vector<int> cpus;
+	stringstream ss(list);
+	string range;
+	while (getline(ss, range, ','))
+	{
+		if (range.find_first_of("0123456789") == string::npos)
+		{
+			continue;
+		}
+		size_t dash = range.find('-');
+		int first = stoi(range.substr(0, dash));
+		int last = (dash == string::npos) ? first : stoi(range.substr(dash + 1));
+		for (int c=first; c<=last; c++)
+		{
+			cpus.push_back(c);
+		}
+	}
+	return cpus;
+}
+
+namespace numa {
+
+	void init(string policy)
+	{
+		if (policy != "none" && policy != "compact" && policy != "scatter")
+		{
+			cout << "Unknown thread_pinning \"" << policy << "\" (must be none, compact, or scatter)!\n";
+			exit(1);
+		}
+		pin_policy = policy;
+
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		sched_getaffinity(0, sizeof(allowed), &allowed);
+
+		// nodes in numerical order, keeping only the CPUs we may use
+		vector<int> node_ids;
+		DIR *dir = opendir("/sys/devices/system/node");
+		if (dir)
+		{
+			struct dirent *entry;
+			while ((entry = readdir(dir)) != NULL)
+			{
+				string name = entry->d_name;
+				if (name.compare(0, 4, "node") == 0 && name.size() > 4 && isdigit(name[4]))
+				{
+					node_ids.push_back(stoi(name.substr(4)));
+				}
+			}
+			closedir(dir);
+		}
+		sort(node_ids.begin(), node_ids.end());
+
+		node_cpus.clear();
+		node_id.clear();
+		for (int id : node_ids)
+		{
+			ifstream infile("/sys/devices/system/node/node" + to_string(id) + "/cpulist");
+			string list;
+			getline(infile, list);
+			vector<int> cpus;
+			for (int c : parse_cpu_list(list))
+			{
+				if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+				{
+					cpus.push_back(c);
+				}
+			}
+			if (!cpus.empty())
+			{
+				node_cpus.push_back(cpus);
+				node_id.push_back(id);
+			}
+		}
+		if (node_cpus.empty())
+		{
+			vector<int> cpus;
+			for (int c=0; c<CPU_SETSIZE; c++)
+			{
+				if (CPU_ISSET(c, &allowed))
+				{
+					cpus.push_back(c);
+				}
+			}
+			node_cpus.push_back(cpus);
+			node_id.push_back(0);
+		}
+
+		cpu_node.assign(CPU_SETSIZE, 0);
+		for (unsigned n=0; n<node_cpus.size(); n++)
+		{
+			for (int c : node_cpus[n])
+			{
+				cpu_node[c] = n;
+			}
+		}
+
+		placement.clear();
+		if (pin_policy == "compact")
+		{
+			for (const vector<int> &cpus : node_cpus)
+			{
+				placement.insert(placement.end(), cpus.begin(), cpus.end());
+			}
+		}
+		else if (pin_policy == "scatter")
+		{
+			for (unsigned i=0; ; i++)
+			{
+				bool any = false;
+				for (const vector<int> &cpus : node_cpus)
+				{
+					if (i < cpus.size())
+					{
+						placement.push_back(cpus[i]);
+						any = true;
+					}
+				}
+				if (!any)
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	bool pinning()
+	{
+		return !placement.empty();
+	}
+
+	string get_policy()
+	{
+		return pin_policy;
+	}
+
+	int get_num_nodes()
+	{
+		return node_cpus.size();
+	}
+
+	int get_worker_cpu(int w)
+	{
+		return placement.empty() ? -1 : placement[w % placement.size()];
+	}
+
+	int get_worker_node(int w)
+	{
+		return placement.empty() ? 0 : cpu_node[get_worker_cpu(w)];
+	}
+
+	void pin_thread(int w)
+	{
+		if (placement.empty())
+		{
+			return;
+		}
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(get_worker_cpu(w), &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+
+	// uses the move_pages system call directly (flag 2 is MPOL_MF_MOVE: move pages used only by this process)
+	long move_to_node(const void *begin, size_t bytes, int node)
+	{
+		if (node_cpus.size() < 2 || bytes == 0)
+		{
+			return 0;
+		}
+		uintptr_t page = sysconf(_SC_PAGESIZE);
+		uintptr_t first = ((uintptr_t)begin + page - 1) / page * page;
+		uintptr_t end = ((uintptr_t)begin + bytes) / page * page;
+		if (end <= first)
+		{
+			return 0;
+		}
+		size_t count = (end - first) / page;
+		vector<void *> pages(count);
+		vector<int> nodes(count, node_id[node]);
+		vector<int> status(count, -1);
+		for (size_t i=0; i<count; i++)
+		{
+			pages[i] = (void *)(first + i*page);
+		}
+		if (syscall(SYS_move_pages, 0, count, pages.data(), nodes.data(), status.data(), 2) < 0)
+		{
+			return 0;
+		}
+		int target = node_id[node];
+		return count_if(status.begin(), status.end(), [target](int s) { return s == target; });
+	}
+
+	void print_report(int num_workers)
+	{
+		cout << "NUMA topology: " << node_cpus.size() << " node(s)\n";
+		for (unsigned n=0; n<node_cpus.size(); n++)
+		{
+			cout << "\tnode " << node_id[n] << ": " << node_cpus[n].size() << " CPU(s) (";
+			for (unsigned i=0; i<node_cpus[n].size(); i++)
+			{
+				cout << (i > 0 ? " " : "") << node_cpus[n][i];
+			}
+			cout << ")\n";
+		}
+		cout << "Thread pinning: " << pin_policy << "\n";
+		if (pinning())
+		{
+			for (int w=0; w<num_workers; w++)
+			{
+				cout << "\tworker " << w << ": CPU " << get_worker_cpu(w) << ", node " << node_id[get_worker_node(w)] << "\n";
+			}
+			if (num_workers > (int)placement.size())
+			{
+				cout << "\t(" << num_workers << " workers on " << placement.size() << " CPU(s): some CPUs run several workers)\n";
+			}
+		}
+	}
+}
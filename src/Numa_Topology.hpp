@@ -0,0 +1,45 @@
+/*
+ * Numa_Topology.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef NUMA_TOPOLOGY_HPP_
+#define NUMA_TOPOLOGY_HPP_
+
+#include <string>
+#include <vector>
+using namespace std;
+
+// NUMA topology and worker thread placement for the parallel transport engine
+// the topology is read from /sys/devices/system/node (a machine without it is one node), limited to the CPUs this
+// process may run on; no NUMA library is needed
+namespace numa {
+	// read the topology and choose a CPU for each worker by policy:
+	// "none" (default): no pinning, the operating system places threads
+	// "compact": fill the CPUs of one node before moving on to the next (workers share memory bandwidth and caches)
+	// "scatter": alternate between nodes (spreads workers over all memory controllers)
+	void init(string policy);
+
+	bool pinning();
+	string get_policy();
+	int get_num_nodes();
+
+	// CPU and NUMA node of worker w; workers beyond the number of CPUs wrap around
+	// (nodes are numbered 0 .. get_num_nodes()-1 here; without pinning the CPU is -1 and the node is 0)
+	int get_worker_cpu(int w);
+	int get_worker_node(int w);
+
+	// pin the calling thread to worker w's CPU (does nothing without pinning); threads it starts inherit the pinning
+	void pin_thread(int w);
+
+	// move the memory pages lying wholly within [begin, begin + bytes) to node; returns the number of pages that
+	// ended up there (0 on a single-node machine, where there is nothing to move)
+	long move_to_node(const void *begin, size_t bytes, int node);
+
+	// print nodes and their CPUs, the policy, and the placement of num_workers workers
+	void print_report(int num_workers);
+};
+
+#endif /* NUMA_TOPOLOGY_HPP_ */
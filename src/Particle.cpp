@@ -6,17 +6,15 @@
  */
 
 #include "Particle.hpp"
-#include "Particle_CO.hpp"
-#include "Particle_CO2.hpp"
-#include "Particle_H.hpp"
-#include "Particle_N2.hpp"
-#include "Particle_O.hpp"
 #include <iostream>
 
 Particle::Particle()
 {
 	active = true;
 	traced = false;
+	species = -1;
+	source = 0;
+	mass = 0.0;
 	radius = 0.0;
 	inverse_radius = 0.0;
 	previous_radius = 0.0;
@@ -24,11 +22,38 @@ Particle::Particle()
 	velocity[0] = velocity[1] = velocity[2] = 0.0;
 }
 
+Particle::Particle(int species_id)
+	: Particle()
+{
+	species = species_id;
+	mass = species_table[species].mass;
+}
+
 Particle::~Particle()
 {
 
 }
 
+double Particle::get_mass() const
+{
+	return mass;
+}
+
+string Particle::get_name() const
+{
+	return species_table[species].name;
+}
+
+int Particle::get_species() const
+{
+	return species;
+}
+
+int Particle::get_source() const
+{
+	return source;
+}
+
 // deactivate this particle
 void Particle::deactivate(string fate)
 {
@@ -42,68 +67,64 @@ void Particle::deactivate(string fate)
 }
 
 // perform collision on a particle and update velocity vector
-void Particle::do_collision(shared_ptr<Particle> target, double theta, double time, double planet_r)
+void Particle::do_collision(const Particle &target, double theta, double time, double planet_r)
 {
-	double v_before, v_after;
-	double my_mass = get_mass();
-	double targ_mass = target->get_mass();
-	Matrix<double, 3, 1> targ_v = {target->get_vx(), target->get_vy(), target->get_vz()};
-	Matrix<double, 3, 1> vcm;
-	Matrix<double, 3, 3> Rrg;
-
-	vcm = (my_mass*velocity.array() + targ_mass*targ_v.array()) / (my_mass + targ_mass);
-	Matrix<double, 3, 1> v1v = velocity.array() - vcm.array();        // particle 1 c-o-m velocity
-	// Matrix<double, 3, 1> v2v = targ_v.array() - vcm.array();          // particle 2 c-o-m velocity
-	double v1 = sqrt(v1v[0]*v1v[0] + v1v[1]*v1v[1] + v1v[2]*v1v[2]);  // particle 1 c-o-m scalar velocity
-	// double v2 = sqrt(v2v[0]*v2v[0] + v2v[1]*v2v[1] + v2v[2]*v2v[2]);  // particle 2 c-o-m scalar velocity
-
-	// unit vector parallel to particle 1 velocity
-	Matrix<double, 3, 1> r = velocity.array() / sqrt(velocity[0]*velocity[0] + velocity[1]*velocity[1] + velocity[2]*velocity[2]); // velocity is a three-component vector: vx, vy, vz, so r is the velocity vector normalised to -1 to 1
-
-	double alpha = atan2(velocity[1], velocity[0]);
-	double phi = atan2(velocity[2], sqrt(velocity[0]*velocity[0] + velocity[1]*velocity[1]));
-	double gamma = constants::twopi*common::get_rand();  //  gamma random no. from uniform distribution between 0 and 2pi
-
-	Matrix<double, 3, 1> vp;
-	vp[0] = v1*cos(alpha)*cos(phi-theta);
-	vp[1] = v1*sin(alpha)*cos(phi-theta);
-	vp[2] = v1*sin(phi-theta);
-
-	double Cg = cos(gamma);
-	double Sg = sin(gamma);
-	double Vg = 1.0-Cg;
-
-	Rrg(0, 0) = r[0]*r[0]*Vg+Cg;
-	Rrg(0, 1) = r[0]*r[1]*Vg+r[2]*Sg;
-	Rrg(0, 2) = r[0]*r[2]*Vg-r[1]*Sg;
-
-	Rrg(1, 0) = r[0]*r[1]*Vg-r[2]*Sg;
-	Rrg(1, 1) = r[1]*r[1]*Vg+Cg;
-	Rrg(1, 2) = r[1]*r[2]*Vg+r[0]*Sg;
-
-	Rrg(2, 0) = r[0]*r[2]*Vg+r[1]*Sg;
-	Rrg(2, 1) = r[1]*r[2]*Vg-r[0]*Sg;
-	Rrg(2, 2) = r[2]*r[2]*Vg+Cg;
+	double targ_v[] = {target.velocity[0], target.velocity[1], target.velocity[2]};
+	do_collision(target.species, targ_v, theta, time, planet_r);
+}
 
+// perform collision with a partner of given species and velocity (e.g. as sampled by Background_Species::check_collisions)
+// this particle's velocity relative to the center of mass keeps its magnitude and is turned to angle theta from the
+// particle's original direction of motion, with a random azimuth
+// (same kinematics as Background_Species::apply_collisions, one particle at a time)
+void Particle::do_collision(int targ_species, const double targ_v[], double theta, double time, double planet_r)
+{
+	double v_before = get_total_v();
+	double targ_mass = species_table[targ_species].mass;
+	double mfrac = targ_mass / (mass + targ_mass);
 
-	Matrix<double, 3, 1> vrel1 = Rrg * vp;
+	// center-of-mass velocity, and this particle's velocity relative to it
+	double vcm[3], w[3];
+	for (int i=0; i<3; i++)
+	{
+		w[i] = mfrac*(velocity[i] - targ_v[i]);
+		vcm[i] = velocity[i] - w[i];
+	}
+	double w_tot = sqrt(w[0]*w[0] + w[1]*w[1] + w[2]*w[2]);
+	if (w_tot == 0.0 || v_before == 0.0)  // no relative motion or no direction, nothing to deflect
+	{
+		log_collision(targ_species, theta, v_before, time, planet_r);
+		return;
+	}
 
-	// update post-collision velocity
-	if (traced)
+	// unit vector along this particle's velocity (theta is measured from it), and two unit vectors orthogonal to it
+	double u[] = {velocity[0]/v_before, velocity[1]/v_before, velocity[2]/v_before};
+	double sign = copysign(1.0, u[2]);
+	double a = -1.0 / (sign + u[2]);
+	double b = u[0]*u[1]*a;
+	double e1[] = {1.0 + sign*u[0]*u[0]*a, sign*b, -sign*u[0]};
+	double e2[] = {b, sign + u[1]*u[1]*a, -u[1]};
+
+	// turn w to angle theta from the original direction with uniformly distributed azimuth
+	double cos_phi, sin_phi;
+	common::get_rand_azimuth(cos_phi, sin_phi);
+	double cos_theta = cos(theta);
+	double sin_theta = sin(theta);
+	for (int i=0; i<3; i++)
 	{
-	  v_before = get_total_v()*1e-5; //  sqrt(vx^2 + vy^2 + vz^2)
+		velocity[i] = vcm[i] + w_tot*(cos_theta*u[i] + sin_theta*(cos_phi*e1[i] + sin_phi*e2[i]));
 	}
-	velocity = vcm.array() + vrel1.array(); // here is where velocity changes
 
-	// in case you need the updated collision partner velocity for something
-	// targ_v = vcm.array() - ((my_mass / targ_mass) * vrel1.array());
+	log_collision(targ_species, theta, v_before, time, planet_r);
+}
 
-	// write to collision log if traced particle
+// write collision to collision log if traced particle; v_before is speed before collision [cm/s]
+void Particle::log_collision(int targ_species, double theta, double v_before, double time, double planet_r)
+{
 	if (traced)
 	{
-		v_after = get_total_v()*1e-5;
 		double alt_in_km = 1e-5*(radius - planet_r);
-		collision_log.push_back(to_string(time) + "\t\t" + to_string(alt_in_km) + "\t" + target->get_name() + "\t" + to_string(theta * (180.0/constants::pi)) + "\t" + to_string(v_before) + "\t" + to_string(v_after));
+		collision_log.push_back(to_string(time) + "\t\t" + to_string(alt_in_km) + "\t" + species_table[targ_species].name + "\t" + to_string(theta * (180.0/constants::pi)) + "\t" + to_string(v_before*1e-5) + "\t" + to_string(get_total_v()*1e-5));
 	}
 }
 
@@ -129,6 +150,123 @@ void Particle::do_timestep(double dt, double k_g)
 	velocity.array() = velocity.array() + 0.5*a*dt;
 }
 
+// advance one timestep with the chosen integrator
+void Particle::do_timestep(double dt, double k_g, Integrator method)
+{
+	if (method == integrator_yoshida4)
+	{
+		do_timestep_yoshida4(dt, k_g);
+	}
+	else if (method == integrator_kepler)
+	{
+		do_timestep_kepler(dt, k_g);
+	}
+	else
+	{
+		do_timestep(dt, k_g);
+	}
+}
+
+// fourth-order Yoshida integrator: drift-kick sequence with coefficients chosen so that the third-order error
+// terms of three Verlet substeps (the middle one backwards in time) cancel
+void Particle::do_timestep_yoshida4(double dt, double k_g)
+{
+	const double cbrt2 = cbrt(2.0);
+	const double w1 = 1.0/(2.0 - cbrt2);
+	const double w0 = -cbrt2/(2.0 - cbrt2);
+	const double c[] = {0.5*w1, 0.5*(w0 + w1), 0.5*(w0 + w1), 0.5*w1};  // drift coefficients
+	const double d[] = {w1, w0, w1};                                     // kick coefficients
+
+	previous_radius = radius;
+	for (int i=0; i<3; i++)
+	{
+		position.array() = position.array() + velocity.array()*(c[i]*dt);
+		double inv_r = 1.0 / sqrt(position[0]*position[0] + position[1]*position[1] + position[2]*position[2]);
+		velocity.array() = velocity.array() + k_g*position.array()*(inv_r*inv_r*inv_r*d[i]*dt);
+	}
+	position.array() = position.array() + velocity.array()*(c[3]*dt);
+	radius = sqrt(position[0]*position[0] + position[1]*position[1] + position[2]*position[2]);
+	inverse_radius = 1.0 / radius;
+}
+
+// Stumpff functions C(z) and S(z) for the universal variable Kepler equation (series near z = 0, where the
+// closed forms lose all precision to cancellation)
+static void stumpff(double z, double &C, double &S)
+{
+	if (abs(z) < 0.1)
+	{
+		C = 1.0/2.0 - z*(1.0/24.0 - z*(1.0/720.0 - z*(1.0/40320.0 - z*(1.0/3628800.0 - z/479001600.0))));
+		S = 1.0/6.0 - z*(1.0/120.0 - z*(1.0/5040.0 - z*(1.0/362880.0 - z*(1.0/39916800.0 - z/6227020800.0))));
+	}
+	else if (z > 0.0)
+	{
+		double sz = sqrt(z);
+		C = (1.0 - cos(sz))/z;
+		S = (sz - sin(sz))/(sz*z);
+	}
+	else
+	{
+		double sz = sqrt(-z);
+		C = (cosh(sz) - 1.0)/(-z);
+		S = (sinh(sz) - sz)/(-sz*z);
+	}
+}
+
+// exact two-body step for bound and unbound orbits alike: solve the universal Kepler equation for the universal
+// anomaly chi with Newton's method, then advance with the Lagrange f and g coefficients
+void Particle::do_timestep_kepler(double dt, double k_g)
+{
+	double mu = -k_g;
+	double sqrt_mu = sqrt(mu);
+	double r0 = radius;
+	double rv = position[0]*velocity[0] + position[1]*velocity[1] + position[2]*velocity[2];
+	double v2 = velocity[0]*velocity[0] + velocity[1]*velocity[1] + velocity[2]*velocity[2];
+	double alpha = 2.0/r0 - v2/mu;  // inverse semi-major axis (negative for unbound orbits)
+	double sigma = rv/sqrt_mu;
+
+	// for steps much shorter than the orbital period, chi is close to sqrt(mu)*dt/r0
+	double chi = sqrt_mu*dt/r0;
+	double C = 0.5;
+	double S = 1.0/6.0;
+	for (int i=0; i<50; i++)
+	{
+		double chi2 = chi*chi;
+		double z = alpha*chi2;
+		stumpff(z, C, S);
+		double r = chi2*C + sigma*chi*(1.0 - z*S) + r0*(1.0 - z*C);
+		double F = sigma*chi2*C + (1.0 - alpha*r0)*chi2*chi*S + r0*chi - sqrt_mu*dt;
+		double step = F/r;
+		chi = chi - step;
+		if (abs(step) <= 1e-15*abs(chi))
+		{
+			break;
+		}
+	}
+	double chi2 = chi*chi;
+	stumpff(alpha*chi2, C, S);
+
+	// f and g_dot are within dt^2 of 1, so the updates are written in terms of f - 1 and g_dot - 1 to keep
+	// rounding errors from piling up over many short steps
+	double f_minus_1 = -chi2*C/r0;
+	double g = dt - chi2*chi*S/sqrt_mu;
+	Matrix<double, 3, 1> new_position = position + (f_minus_1*position + g*velocity);
+	double r = new_position.norm();
+	double f_dot = sqrt_mu/(r*r0)*chi*(alpha*chi2*S - 1.0);
+	double g_dot_minus_1 = -chi2*C/r;
+
+	previous_radius = radius;
+	velocity = velocity + (f_dot*position + g_dot_minus_1*velocity);
+	position = new_position;
+	radius = r;
+	inverse_radius = 1.0 / radius;
+}
+
+// orbital energy per unit mass, v^2/2 + k_g/r [erg/g]
+double Particle::get_specific_energy(double k_g) const
+{
+	return 0.5*velocity.squaredNorm() + k_g*inverse_radius;
+}
+
 // write collision log to given file
 void Particle::dump_collision_log(string filename)
 {
@@ -172,13 +310,13 @@ double Particle::get_cos_theta() const
 
 double Particle::get_energy_in_eV() const
 {
-	return 0.5*get_mass()*pow(get_total_v(), 2.0)/constants::ergev;
+	return 0.5*mass*pow(get_total_v(), 2.0)/constants::ergev;
 }
 
 double Particle::get_radial_energy_in_eV(double dt) const
 {
 	double radial_v = abs(radius - previous_radius) / dt;
-	return 0.5*get_mass()*pow(radial_v, 2.0)/constants::ergev;
+	return 0.5*mass*pow(radial_v, 2.0)/constants::ergev;
 }
 
 double Particle::get_radius() const
@@ -265,47 +403,23 @@ void Particle::init_particle_vonly(double vx, double vy, double vz)
 void Particle::init_particle_MB(double r, double v_avg)
 {
 	radius = r;
-	double phi = constants::twopi*(common::get_rand());
-	double u = 2.0*common::get_rand() - 1;
 	inverse_radius = 1.0/r;
 	previous_radius = radius;
-	position[0] = r*sqrt(1-(u*u))*cos(phi);
-	position[1] = r*sqrt(1-(u*u))*sin(phi);
-	position[2] = r*u;
-
-	double randnum1 = common::get_rand();
-	double randnum2 = common::get_rand();
-	double randnum3 = common::get_rand();
-	double randnum4 = common::get_rand();
-
-	randnum1 = v_avg*sqrt(-2.0*log(1.0-randnum1));
-	randnum2 = constants::twopi*randnum2;
-	randnum3 = v_avg*sqrt(-2.0*log(1.0-randnum3));
-	randnum4 = constants::twopi*randnum4;
-
-	velocity[0] = randnum1*cos(randnum2);
-	velocity[1] = randnum1*sin(randnum2);
-	velocity[2] = randnum3*cos(randnum4);
+	sampling::gen_sphere_point(r, position[0], position[1], position[2]);
+	sampling::gen_gaussian3(v_avg, velocity.data());
 }
 
 void Particle::init_particle_vonly_MB(double v_avg)
 {
-	double randnum1 = common::get_rand();
-	double randnum2 = common::get_rand();
-	double randnum3 = common::get_rand();
-	double randnum4 = common::get_rand();
-
-	randnum1 = v_avg*sqrt(-2.0*log(1.0-randnum1));
-	randnum2 = constants::twopi*randnum2;
-	randnum3 = v_avg*sqrt(-2.0*log(1.0-randnum3));
-	randnum4 = constants::twopi*randnum4;
-
-	velocity[0] = randnum1*cos(randnum2);
-	velocity[1] = randnum1*sin(randnum2);
-	velocity[2] = randnum3*cos(randnum4);
+	sampling::gen_gaussian3(v_avg, velocity.data());
 }
 
 void Particle::set_traced()
 {
 	traced = true;
 }
+
+void Particle::set_source(int source_id)
+{
+	source = source_id;
+}
@@ -12,18 +12,37 @@
 //#include </usr/local/Cellar/eigen/3.3.9/include/eigen3/Eigen/Core>  // uncomment for Mac
 #include </opt/local/include/eigen3/Eigen/Core> // uncomment for Mac option 2
 #include "Common_Functions.hpp"
+#include "Sampling.hpp"
+#include "Species.hpp"
 using namespace Eigen;
 
+// orbit integrators for the free flight between collisions (gravity of the planet only)
+// verlet: second-order velocity Verlet (the original method)
+// yoshida4: fourth-order symplectic composition of three Verlet steps (Yoshida 1990), three force evaluations per step
+// kepler: exact two-body propagation with universal variables, so the step size only limits collision sampling
+enum Integrator { integrator_verlet, integrator_yoshida4, integrator_kepler };
+
+// particles are plain value types; the species is a small integer id into species_table (see Species.hpp)
+// rather than a virtual subclass, so hot-path calls need no virtual dispatch or reference counting
 class Particle {
 public:
 	Particle();
-	virtual ~Particle();
-	virtual double get_mass() const = 0;  //must be implemented in derived classes
-	virtual string get_name() const = 0;  //must be implemented in derived classes
+	Particle(int species_id);
+	~Particle();
+	double get_mass() const;
+	string get_name() const;
+	int get_species() const;
+	int get_source() const;
 
 	void deactivate(string fate);
-	void do_collision(shared_ptr<Particle> target, double theta, double time, double planet_r);
+	void do_collision(const Particle &target, double theta, double time, double planet_r);
+	void do_collision(int targ_species, const double targ_v[], double theta, double time, double planet_r);
 	void do_timestep(double dt, double k_g);
+	void do_timestep(double dt, double k_g, Integrator method);
+	void do_timestep_yoshida4(double dt, double k_g);
+	void do_timestep_kepler(double dt, double k_g);
+	double get_specific_energy(double k_g) const;
+	void log_collision(int targ_species, double theta, double v_before, double time, double planet_r);
 	void dump_collision_log(string filename);
 	bool is_active() const;
 	bool is_thermalized() const;
@@ -48,10 +67,14 @@ public:
 	void init_particle_MB(double r, double v_avg); // init particle from MB distribution
 	void init_particle_vonly_MB(double v_avg);     // init with velocity only for collision partners
 	void set_traced();
+	void set_source(int source_id);
 
 protected:
 	bool active;                    // flag for whether particle is active, i.e. should still be considered in the simulation
 	bool traced;                    // flag for whether particle is traced through simulation
+	int species;                    // index into species_table
+	int source;                     // production source the particle was drawn from (see Distribution::get_num_sources)
+	double mass;                    // particle mass [g]; cached from species_table
 	double radius;                  // radius from center of planet	[cm]
 	double inverse_radius;          // inverse radius (for computational efficiency) [cm^-1]
 	double previous_radius;         // radius at previous time step; used for tracking
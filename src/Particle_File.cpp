@@ -0,0 +1,162 @@
+/*
+ * Particle_File.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Particle_File.hpp"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <climits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+Particle_File::Particle_File() {
+	map = NULL;
+	map_size = 0;
+	header = NULL;
+}
+
+Particle_File::~Particle_File() {
+	if (map != NULL)
+	{
+		munmap(map, map_size);
+	}
+}
+
+bool Particle_File::open(string filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Particle_File_Header))
+	{
+		close(fd);
+		return false;
+	}
+	map_size = st.st_size;
+	map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		map = NULL;
+		return false;
+	}
+
+	// the particle count is checked against the file size before it is multiplied by anything
+	header = (const Particle_File_Header *)map;
+	uint64_t n = header->num_particles;
+	uint64_t bytes_per_row = 6*sizeof(double);
+	bytes_per_row += (header->flags & particle_file_weights) ? sizeof(double) : 0;
+	bytes_per_row += (header->flags & particle_file_species) ? sizeof(int32_t) : 0;
+	bytes_per_row += (header->flags & particle_file_ids) ? sizeof(int32_t) : 0;
+	if (memcmp(header->magic, particle_file_magic, sizeof(particle_file_magic)) != 0 || header->version != particle_file_version
+			|| n > (uint64_t)INT_MAX || n > (map_size - sizeof(Particle_File_Header)) / bytes_per_row)
+	{
+		munmap(map, map_size);
+		map = NULL;
+		header = NULL;
+		return false;
+	}
+
+	// rows are mostly read in order while particles are initialized
+	madvise(map, map_size, MADV_SEQUENTIAL);
+	return true;
+}
+
+int Particle_File::get_num_particles() const
+{
+	return header->num_particles;
+}
+
+bool Particle_File::has_weights() const
+{
+	return (header->flags & particle_file_weights) != 0;
+}
+
+bool Particle_File::has_species() const
+{
+	return (header->flags & particle_file_species) != 0;
+}
+
+bool Particle_File::has_ids() const
+{
+	return (header->flags & particle_file_ids) != 0;
+}
+
+const double *Particle_File::get_column(int col) const
+{
+	return (const double *)((const char *)map + sizeof(Particle_File_Header)) + col*header->num_particles;
+}
+
+const double *Particle_File::get_weights() const
+{
+	return has_weights() ? get_column(6) : NULL;
+}
+
+const int32_t *Particle_File::get_species() const
+{
+	if (!has_species())
+	{
+		return NULL;
+	}
+	return (const int32_t *)get_column(has_weights() ? 7 : 6);
+}
+
+const int32_t *Particle_File::get_ids() const
+{
+	if (!has_ids())
+	{
+		return NULL;
+	}
+	const int32_t *after_doubles = (const int32_t *)get_column(has_weights() ? 7 : 6);
+	return has_species() ? after_doubles + header->num_particles : after_doubles;
+}
+
+bool Particle_File::is_particle_file(string filename)
+{
+	ifstream infile(filename, ios::binary);
+	char magic[8];
+	infile.read(magic, sizeof(magic));
+	return infile.good() && memcmp(magic, particle_file_magic, sizeof(particle_file_magic)) == 0;
+}
+
+void Particle_File::write(string filename, const Particle_Store &parts, const double *weights)
+{
+	Particle_File_Header h;
+	memcpy(h.magic, particle_file_magic, sizeof(particle_file_magic));
+	h.version = particle_file_version;
+	h.flags = particle_file_species | particle_file_ids | (weights != NULL ? particle_file_weights : 0);
+	h.num_particles = parts.size;
+
+	ofstream outfile(filename, ios::binary);
+	if (!outfile.good())
+	{
+		cout << "Could not open \"" << filename << "\" for writing!\n";
+		exit(1);
+	}
+	size_t n = parts.size;
+	outfile.write((const char *)&h, sizeof(h));
+	outfile.write((const char *)parts.x.data(), n*sizeof(double));
+	outfile.write((const char *)parts.y.data(), n*sizeof(double));
+	outfile.write((const char *)parts.z.data(), n*sizeof(double));
+	outfile.write((const char *)parts.vx.data(), n*sizeof(double));
+	outfile.write((const char *)parts.vy.data(), n*sizeof(double));
+	outfile.write((const char *)parts.vz.data(), n*sizeof(double));
+	if (weights != NULL)
+	{
+		outfile.write((const char *)weights, n*sizeof(double));
+	}
+	vector<int32_t> species(parts.species.begin(), parts.species.begin() + n);
+	outfile.write((const char *)species.data(), n*sizeof(int32_t));
+	vector<int32_t> ids(parts.id.begin(), parts.id.begin() + n);
+	outfile.write((const char *)ids.data(), n*sizeof(int32_t));
+	outfile.close();
+}
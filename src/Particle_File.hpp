@@ -0,0 +1,76 @@
+/*
+ * Particle_File.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef PARTICLE_FILE_HPP_
+#define PARTICLE_FILE_HPP_
+
+#include <string>
+#include <cstdint>
+#include "Particle_Store.hpp"
+using namespace std;
+
+// binary file of particle states (e.g. a snapshot of a previous run), memory-mapped by Distribution_Import so that
+// particles can be initialized straight from the file without parsing or copying the whole set up front
+//
+// layout (native byte order):
+//   Particle_File_Header
+//   num_particles doubles for each of x, y, z [cm], vx, vy, vz [cm/s]
+//   num_particles doubles of weights (if particle_file_weights is set)
+//   num_particles int32 species ids, indices into species_table (if particle_file_species is set)
+//   num_particles int32 particle ids, the id each particle had in the run that wrote it (if particle_file_ids is set)
+const char particle_file_magic[8] = {'C', '3', 'D', 'P', 'A', 'R', 'T', '\0'};
+const uint32_t particle_file_version = 1;
+const uint32_t particle_file_weights = 1;   // flag: file has a weight column
+const uint32_t particle_file_species = 2;   // flag: file has a species column
+const uint32_t particle_file_ids = 4;       // flag: file has a particle id column
+
+struct Particle_File_Header {
+	char magic[8];            // particle_file_magic
+	uint32_t version;         // particle_file_version
+	uint32_t flags;           // particle_file_weights | particle_file_species | particle_file_ids
+	uint64_t num_particles;   // number of values per column
+};
+
+class Particle_File {
+public:
+	Particle_File();
+	virtual ~Particle_File();
+
+	// map particle file into memory; returns false if it is missing, not a particle file of this version, or holds
+	// more particles than fit in the file (or in an int)
+	bool open(string filename);
+
+	int get_num_particles() const;
+	bool has_weights() const;
+	bool has_species() const;
+	bool has_ids() const;
+
+	// returns pointer to state column col (0-2 = x, y, z; 3-5 = vx, vy, vz) of num_particles values
+	const double *get_column(int col) const;
+
+	// returns pointers to the optional weight, species and id columns (NULL if not in file)
+	const double *get_weights() const;
+	const int32_t *get_species() const;
+	const int32_t *get_ids() const;
+
+	// true if filename starts with particle_file_magic
+	static bool is_particle_file(string filename);
+
+	// write particles in parts, with their species and ids (and weights, if not NULL), to a particle file
+	static void write(string filename, const Particle_Store &parts, const double *weights);
+
+private:
+	void *map;                      // start of memory-mapped file
+	size_t map_size;                // size of mapping [bytes]
+	const Particle_File_Header *header;
+
+	// particle files own a memory mapping, so they are not copied
+	Particle_File(const Particle_File &);
+	Particle_File &operator=(const Particle_File &);
+};
+
+#endif /* PARTICLE_FILE_HPP_ */
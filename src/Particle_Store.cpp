@@ -0,0 +1,31 @@
+/*
+ * Particle_Store.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Particle_Store.hpp"
+
+Particle_Store::Particle_Store() {
+	size = 0;
+}
+
+Particle_Store::~Particle_Store() {
+
+}
+
+// set number of particles held; existing entries are kept, new entries are zeroed
+void Particle_Store::resize(int n)
+{
+	size = n;
+	id.resize(n, 0);
+	species.resize(n, 0);
+	source.resize(n, 0);
+	x.resize(n, 0.0);
+	y.resize(n, 0.0);
+	z.resize(n, 0.0);
+	vx.resize(n, 0.0);
+	vy.resize(n, 0.0);
+	vz.resize(n, 0.0);
+}
@@ -0,0 +1,36 @@
+/*
+ * Particle_Store.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef PARTICLE_STORE_HPP_
+#define PARTICLE_STORE_HPP_
+
+#include <vector>
+using namespace std;
+
+// structure-of-arrays store of particle positions and velocities
+// used to pass blocks of particles to batched kernels (e.g. Background_Species::check_collisions)
+class Particle_Store {
+public:
+	Particle_Store();
+	virtual ~Particle_Store();
+
+	// set number of particles held; existing entries are kept, new entries are zeroed
+	void resize(int n);
+
+	int size;             // number of particles held
+	vector<int> id;       // index of each particle in the whole simulation (e.g. row of an imported distribution)
+	vector<int> species;  // index into species_table
+	vector<int> source;   // production source each particle was drawn from (see Distribution::get_num_sources)
+	vector<double> x;     // positions [cm]
+	vector<double> y;
+	vector<double> z;
+	vector<double> vx;    // velocities [cm/s]
+	vector<double> vy;
+	vector<double> vz;
+};
+
+#endif /* PARTICLE_STORE_HPP_ */
@@ -33,17 +33,17 @@ void Planet::init(double m, double r)
 	k_g = -(mass * constants::G);
 }
 
-double Planet::get_mass()
+double Planet::get_mass() const
 {
 	return mass;
 }
 
-double Planet::get_radius()
+double Planet::get_radius() const
 {
 	return radius;
 }
 
-double Planet::get_k_g()
+double Planet::get_k_g() const
 {
 	return k_g;
 }
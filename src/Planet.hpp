@@ -16,9 +16,9 @@ public:
 	virtual ~Planet();
 	void init(); // initialize with defaults (Venus mass/radius)
 	void init(double m, double r);
-	double get_mass();
-	double get_radius();
-	double get_k_g();
+	double get_mass() const;
+	double get_radius() const;
+	double get_k_g() const;
 
 private:
 	double mass;    // [g] mass of planet
@@ -0,0 +1,191 @@
+/*
+ * Sampling.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Sampling.hpp"
+
+// scratch arrays for batched sampling (one set per thread)
+static thread_local vector<double> scratch_u1;
+static thread_local vector<double> scratch_u2;
+static thread_local vector<double> scratch_g;
+
+// scrambled Sobol sequence for quasi-random initial conditions, and each thread's current point in it
+static bool qmc_on = false;
+static Sobol qmc_sequence;
+static thread_local uint32_t qmc_index = 0;
+static thread_local int qmc_dim = 0;
+
+// fill g[0..2m) with standard normal numbers, using both outputs of m Box-Muller pairs
+static void gen_normal_pairs(int m, double g[])
+{
+	scratch_u1.resize(m);
+	scratch_u2.resize(m);
+	double *u1 = scratch_u1.data();
+	double *u2 = scratch_u2.data();
+	common::fill_rand(m, u1);
+	common::fill_rand(m, u2);
+	for (int k=0; k<m; k++)
+	{
+		double r = sqrt(-2.0*log(1.0-u1[k]));
+		double phi = constants::twopi*u2[k];
+		g[2*k] = r*cos(phi);
+		g[2*k+1] = r*sin(phi);
+	}
+}
+
+namespace sampling {
+
+	// Gaussian 3-vector with standard deviation sigma in each component
+	void gen_gaussian3(double sigma, double v[])
+	{
+		double r1 = sigma*sqrt(-2.0*log(1.0-common::get_rand()));
+		double phi1 = constants::twopi*common::get_rand();
+		double r2 = sigma*sqrt(-2.0*log(1.0-common::get_rand()));
+		double phi2 = constants::twopi*common::get_rand();
+
+		v[0] = r1*cos(phi1);
+		v[1] = r1*sin(phi1);
+		v[2] = r2*cos(phi2);
+	}
+
+	// n Gaussian 3-vectors, vector i with standard deviation sigma[i]
+	void gen_gaussian3(int n, const double sigma[], double x[], double y[], double z[])
+	{
+		int m = (3*n + 1)/2;
+		scratch_g.resize(2*m);
+		double *g = scratch_g.data();
+		gen_normal_pairs(m, g);
+		for (int i=0; i<n; i++)
+		{
+			x[i] = sigma[i]*g[3*i];
+			y[i] = sigma[i]*g[3*i+1];
+			z[i] = sigma[i]*g[3*i+2];
+		}
+	}
+
+	// n Gaussian 3-vectors, all with standard deviation sigma
+	void gen_gaussian3(int n, double sigma, double x[], double y[], double z[])
+	{
+		int m = (3*n + 1)/2;
+		scratch_g.resize(2*m);
+		double *g = scratch_g.data();
+		gen_normal_pairs(m, g);
+		for (int i=0; i<n; i++)
+		{
+			x[i] = sigma*g[3*i];
+			y[i] = sigma*g[3*i+1];
+			z[i] = sigma*g[3*i+2];
+		}
+	}
+
+	// isotropically distributed unit vector (uniform cos(polar angle), azimuth without trig calls)
+	void gen_isotropic(double &x, double &y, double &z)
+	{
+		double cos_phi, sin_phi;
+		z = 2.0*common::get_rand() - 1.0;
+		common::get_rand_azimuth(cos_phi, sin_phi);
+		double s = sqrt(1.0 - z*z);
+		x = s*cos_phi;
+		y = s*sin_phi;
+	}
+
+	// n isotropically distributed unit vectors
+	void gen_isotropic(int n, double x[], double y[], double z[])
+	{
+		scratch_u1.resize(n);
+		scratch_u2.resize(n);
+		double *u1 = scratch_u1.data();
+		double *u2 = scratch_u2.data();
+		common::fill_rand(n, u1);
+		common::fill_rand(n, u2);
+		for (int i=0; i<n; i++)
+		{
+			double uz = 2.0*u1[i] - 1.0;
+			double s = sqrt(1.0 - uz*uz);
+			double phi = constants::twopi*u2[i];
+			x[i] = s*cos(phi);
+			y[i] = s*sin(phi);
+			z[i] = uz;
+		}
+	}
+
+	// uniformly distributed point on sphere of radius r
+	void gen_sphere_point(double r, double &x, double &y, double &z)
+	{
+		gen_isotropic(x, y, z);
+		x = r*x;
+		y = r*y;
+		z = r*z;
+	}
+
+	// n uniformly distributed points on spheres of radius r[i]
+	void gen_sphere_points(int n, const double r[], double x[], double y[], double z[])
+	{
+		gen_isotropic(n, x, y, z);
+		for (int i=0; i<n; i++)
+		{
+			x[i] = r[i]*x[i];
+			y[i] = r[i]*y[i];
+			z[i] = r[i]*z[i];
+		}
+	}
+
+	void use_qmc(bool on)
+	{
+		qmc_on = on;
+		if (qmc_on)
+		{
+			qmc_sequence.init(sobol_max_dims, common::get_run_seed());
+		}
+	}
+
+	bool using_qmc()
+	{
+		return qmc_on;
+	}
+
+	// start quasi-random point index on the calling thread
+	void set_qmc_point(long long index)
+	{
+		qmc_index = (uint32_t)index;
+		qmc_dim = 0;
+	}
+
+	// next coordinate of the calling thread's current quasi-random point
+	double get_qrand()
+	{
+		if (!qmc_on || qmc_dim >= qmc_sequence.get_num_dims())
+		{
+			return common::get_rand();
+		}
+		return qmc_sequence.get(qmc_index, qmc_dim++);
+	}
+
+	// isotropically distributed unit vector from two quasi-random coordinates
+	// (trig azimuth rather than rejection sampling, so that every point uses the same dimensions)
+	void gen_isotropic_q(double &x, double &y, double &z)
+	{
+		if (!qmc_on)
+		{
+			gen_isotropic(x, y, z);
+			return;
+		}
+		z = 2.0*get_qrand() - 1.0;
+		double phi = constants::twopi*get_qrand();
+		double s = sqrt(1.0 - z*z);
+		x = s*cos(phi);
+		y = s*sin(phi);
+	}
+
+	// uniformly distributed point on sphere of radius r using two quasi-random coordinates
+	void gen_sphere_point_q(double r, double &x, double &y, double &z)
+	{
+		gen_isotropic_q(x, y, z);
+		x = r*x;
+		y = r*y;
+		z = r*z;
+	}
+}
@@ -0,0 +1,63 @@
+/*
+ * Sampling.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef SAMPLING_HPP_
+#define SAMPLING_HPP_
+
+#include "Common_Functions.hpp"
+#include "Sobol.hpp"
+using namespace std;
+
+// random vectors used to initialize particles and collision partners
+// batched versions fill structure-of-arrays outputs: random numbers are drawn for the whole batch first, then
+// transformed in branch-free loops over plain arrays (which the compiler can vectorize)
+namespace sampling {
+	// Gaussian 3-vector with standard deviation sigma in each component (e.g. a Maxwell-Boltzmann velocity,
+	// with sigma = sqrt(kT/m))
+	void gen_gaussian3(double sigma, double v[]);
+
+	// n Gaussian 3-vectors, vector i with standard deviation sigma[i]; uses both outputs of every Box-Muller pair
+	void gen_gaussian3(int n, const double sigma[], double x[], double y[], double z[]);
+
+	// n Gaussian 3-vectors, all with standard deviation sigma
+	void gen_gaussian3(int n, double sigma, double x[], double y[], double z[]);
+
+	// isotropically distributed unit vector
+	void gen_isotropic(double &x, double &y, double &z);
+
+	// n isotropically distributed unit vectors
+	void gen_isotropic(int n, double x[], double y[], double z[]);
+
+	// uniformly distributed point on sphere of radius r (centered on the origin)
+	void gen_sphere_point(double r, double &x, double &y, double &z);
+
+	// n uniformly distributed points on spheres of radius r[i]
+	void gen_sphere_points(int n, const double r[], double x[], double y[], double z[]);
+
+	// quasi-Monte Carlo initial conditions: when on, the initial-condition coordinates of particle i (birth altitude,
+	// birth direction, energy channel, ...) are the coordinates of point i of a scrambled Sobol sequence, drawn in
+	// order with get_qrand(); everything else, including transport, still uses common::get_rand()
+	// off by default, in which case get_qrand() is just common::get_rand()
+	void use_qmc(bool on);
+	bool using_qmc();
+
+	// start quasi-random point index on the calling thread
+	void set_qmc_point(long long index);
+
+	// next coordinate of the calling thread's current quasi-random point; falls back to common::get_rand() if
+	// quasi-random sampling is off or the point has run out of dimensions
+	double get_qrand();
+
+	// isotropically distributed unit vector using two get_qrand() coordinates (same as gen_isotropic if
+	// quasi-random sampling is off)
+	void gen_isotropic_q(double &x, double &y, double &z);
+
+	// uniformly distributed point on sphere of radius r using two get_qrand() coordinates
+	void gen_sphere_point_q(double r, double &x, double &y, double &z);
+};
+
+#endif /* SAMPLING_HPP_ */
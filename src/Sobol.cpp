@@ -0,0 +1,137 @@
+/*
+ * Sobol.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Sobol.hpp"
+#include <iostream>
+
+// primitive polynomial degree s, coefficients a and initial direction numbers m for dimensions 2 and up
+// (dimension 1 is the van der Corput sequence)
+static const int joe_kuo_s[sobol_max_dims-1] = {1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6};
+static const int joe_kuo_a[sobol_max_dims-1] = {0, 1, 1, 2, 1, 4, 2, 4, 7, 11, 13, 14, 1, 13, 16};
+static const int joe_kuo_m[sobol_max_dims-1][6] = {
+	{1},
+	{1, 3},
+	{1, 3, 1},
+	{1, 1, 1},
+	{1, 1, 3, 3},
+	{1, 3, 5, 13},
+	{1, 1, 5, 5, 17},
+	{1, 1, 5, 5, 5},
+	{1, 1, 7, 11, 19},
+	{1, 1, 5, 1, 1},
+	{1, 1, 1, 3, 11},
+	{1, 3, 5, 5, 31},
+	{1, 3, 3, 9, 7, 49},
+	{1, 1, 1, 15, 21, 21},
+	{1, 3, 1, 13, 27, 49}
+};
+
+static uint32_t reverse_bits(uint32_t x)
+{
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+	x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+// Laine-Karras hash: each output bit depends only on the input bits below it, so applied to bit-reversed
+// values it permutes every dyadic interval within its parent (a nested uniform, i.e. Owen, scramble)
+static uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+{
+	x += seed;
+	x ^= x*0x6c50b47cu;
+	x ^= x*0xb82f1e52u;
+	x ^= x*0xc7afe638u;
+	x ^= x*0x8d22f6e6u;
+	return x;
+}
+
+static uint32_t owen_scramble(uint32_t x, uint32_t seed)
+{
+	return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+// splitmix64, used to derive one scramble seed per dimension from the run seed
+static uint64_t mix_seed(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+Sobol::Sobol() {
+	num_dims = 0;
+}
+
+Sobol::~Sobol() {
+
+}
+
+void Sobol::init(int num_dims, uint64_t seed)
+{
+	if (num_dims < 1 || num_dims > sobol_max_dims)
+	{
+		cout << "Sobol sequence must have between 1 and " << sobol_max_dims << " dimensions!\n";
+		exit(1);
+	}
+	this->num_dims = num_dims;
+	directions.assign(32*num_dims, 0);
+	scramble_seeds.resize(num_dims);
+
+	for (int bit=0; bit<32; bit++)
+	{
+		directions[bit] = 1u << (31 - bit);
+	}
+	for (int d=1; d<num_dims; d++)
+	{
+		int s = joe_kuo_s[d-1];
+		int a = joe_kuo_a[d-1];
+		uint32_t *v = &directions[32*d];
+		for (int bit=0; bit<s; bit++)
+		{
+			v[bit] = (uint32_t)joe_kuo_m[d-1][bit] << (31 - bit);
+		}
+		for (int bit=s; bit<32; bit++)
+		{
+			v[bit] = v[bit-s] ^ (v[bit-s] >> s);
+			for (int k=1; k<s; k++)
+			{
+				if ((a >> (s - 1 - k)) & 1)
+				{
+					v[bit] ^= v[bit-k];
+				}
+			}
+		}
+	}
+
+	for (int d=0; d<num_dims; d++)
+	{
+		scramble_seeds[d] = (uint32_t)mix_seed(seed + d);
+	}
+}
+
+int Sobol::get_num_dims() const
+{
+	return num_dims;
+}
+
+// coordinate dim of point index, in [0, 1)
+double Sobol::get(uint32_t index, int dim) const
+{
+	const uint32_t *v = &directions[32*dim];
+	uint32_t x = 0;
+	for (int bit=0; index != 0; bit++, index >>= 1)
+	{
+		if (index & 1)
+		{
+			x ^= v[bit];
+		}
+	}
+	return owen_scramble(x, scramble_seeds[dim])*(1.0/4294967296.0);
+}
@@ -0,0 +1,40 @@
+/*
+ * Sobol.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef SOBOL_HPP_
+#define SOBOL_HPP_
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// Sobol low-discrepancy sequence with hash-based Owen scrambling (Burley 2020), evaluated directly at any index
+// so that point i can be computed by whichever thread initializes particle i
+// direction numbers are Joe and Kuo's (new-joe-kuo-6.21201) for the first sobol_max_dims dimensions
+constexpr int sobol_max_dims = 16;
+
+class Sobol {
+public:
+	Sobol();
+	virtual ~Sobol();
+
+	// use num_dims dimensions (at most sobol_max_dims), scrambled with seed; different seeds give independent
+	// randomizations of the same sequence
+	void init(int num_dims, uint64_t seed);
+
+	int get_num_dims() const;
+
+	// coordinate dim of point index, in [0, 1)
+	double get(uint32_t index, int dim) const;
+
+private:
+	int num_dims;
+	vector<uint32_t> directions;   // directions[32*dim + bit]
+	vector<uint32_t> scramble_seeds;
+};
+
+#endif /* SOBOL_HPP_ */
@@ -0,0 +1,21 @@
+/*
+ * Species.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Species.hpp"
+
+// returns species id matching given name (as used in configuration files), or -1 if not a known species
+int get_species_id(string name)
+{
+	for (int i=0; i<num_species_types; i++)
+	{
+		if (name == species_table[i].name)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
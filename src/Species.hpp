@@ -0,0 +1,34 @@
+/*
+ * Species.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef SPECIES_HPP_
+#define SPECIES_HPP_
+
+#include "Common_Functions.hpp"
+
+// small integer ids for every particle species the model knows about
+// these index species_table below and are stored in each Particle in place of a virtual type
+enum Species_ID { species_H = 0, species_O, species_N2, species_CO, species_CO2, num_species_types };
+
+// compile-time traits of a particle species
+struct Species_Traits {
+	const char *name;   // name used in configuration files and collision logs
+	double mass;        // [g] particle mass
+};
+
+constexpr Species_Traits species_table[num_species_types] = {
+	{"H",   1.00794*constants::amu},
+	{"O",   15.9994*constants::amu},
+	{"N2",  28.0134*constants::amu},
+	{"CO",  28.0101*constants::amu},
+	{"CO2", 44.0095*constants::amu}
+};
+
+// returns species id matching given name (as used in configuration files), or -1 if not a known species
+int get_species_id(string name);
+
+#endif /* SPECIES_HPP_ */
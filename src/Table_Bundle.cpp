@@ -0,0 +1,247 @@
+/*
+ * Table_Bundle.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#include "Table_Bundle.hpp"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+Table_Bundle::Table_Bundle() {
+	map = NULL;
+	map_size = 0;
+	header = NULL;
+	entries = NULL;
+}
+
+Table_Bundle::~Table_Bundle() {
+	if (map != NULL)
+	{
+		munmap(map, map_size);
+	}
+}
+
+// true if the entry's names are terminated within their fields and its data lies within a bundle of map_size bytes
+static bool is_valid_entry(const Bundle_Entry &entry, size_t map_size)
+{
+	if (memchr(entry.name, '\0', bundle_name_length) == NULL || memchr(entry.column_names, '\0', bundle_name_length) == NULL)
+	{
+		return false;
+	}
+	if (entry.offset > map_size || entry.offset % sizeof(double) != 0)
+	{
+		return false;
+	}
+	uint64_t max_values = (map_size - entry.offset) / sizeof(double);
+	return (entry.num_cols == 0 || entry.num_rows <= max_values / entry.num_cols);
+}
+
+// map bundle file into memory; returns false if it is missing, not a bundle of this version, or damaged
+bool Table_Bundle::open(string filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Bundle_Header))
+	{
+		close(fd);
+		return false;
+	}
+	map_size = st.st_size;
+	map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		map = NULL;
+		return false;
+	}
+
+	header = (const Bundle_Header *)map;
+	entries = (const Bundle_Entry *)((const char *)map + sizeof(Bundle_Header));
+	bool valid = (memcmp(header->magic, bundle_magic, sizeof(bundle_magic)) == 0 && header->version == bundle_version
+			&& header->num_tables <= (map_size - sizeof(Bundle_Header))/sizeof(Bundle_Entry));
+	for (uint32_t i=0; valid && i<header->num_tables; i++)
+	{
+		valid = is_valid_entry(entries[i], map_size);
+	}
+	if (!valid)
+	{
+		munmap(map, map_size);
+		map = NULL;
+		header = NULL;
+		entries = NULL;
+		return false;
+	}
+	return true;
+}
+
+int Table_Bundle::get_num_tables() const
+{
+	return (header == NULL) ? 0 : header->num_tables;
+}
+
+string Table_Bundle::get_name(int index) const
+{
+	return entries[index].name;
+}
+
+uint64_t Table_Bundle::get_checksum(int index) const
+{
+	return entries[index].checksum;
+}
+
+int Table_Bundle::get_num_rows(int index) const
+{
+	return entries[index].num_rows;
+}
+
+int Table_Bundle::get_num_cols(int index) const
+{
+	return entries[index].num_cols;
+}
+
+vector<string> Table_Bundle::get_column_names(int index) const
+{
+	vector<string> names;
+	string joined = entries[index].column_names;
+	if (joined.empty())
+	{
+		return names;
+	}
+	size_t start = 0;
+	while (true)
+	{
+		size_t comma = joined.find(',', start);
+		names.push_back(joined.substr(start, comma - start));
+		if (comma == string::npos)
+		{
+			break;
+		}
+		start = comma + 1;
+	}
+	return names;
+}
+
+// returns index of table packed from source file name, or -1 if not in bundle
+int Table_Bundle::find(string name) const
+{
+	int num_tables = get_num_tables();
+	for (int i=0; i<num_tables; i++)
+	{
+		if (name == entries[i].name)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+// returns pointer to column col of table index (num_rows values)
+const double *Table_Bundle::get_column(int index, int col) const
+{
+	const double *data = (const double *)((const char *)map + entries[index].offset);
+	return data + col*entries[index].num_rows;
+}
+
+// false if the source file still exists but has changed size or modification time since it was packed
+// (a missing source is not an error: bundles may be shipped to jobs without the csv files)
+bool Table_Bundle::is_current(int index) const
+{
+	struct stat st;
+	if (stat(entries[index].name, &st) != 0)
+	{
+		return true;
+	}
+	return (st.st_size == entries[index].source_size && st.st_mtime == entries[index].source_mtime);
+}
+
+// write a bundle of the given tables packed from source files names[i]
+void Table_Bundle::write(string filename, const vector<string> &names, const vector<Csv_Table> &tables)
+{
+	int num_tables = names.size();
+	Bundle_Header h;
+	memcpy(h.magic, bundle_magic, sizeof(bundle_magic));
+	h.version = bundle_version;
+	h.num_tables = num_tables;
+
+	vector<Bundle_Entry> dir(num_tables);
+	uint64_t offset = sizeof(Bundle_Header) + num_tables*sizeof(Bundle_Entry);
+	for (int i=0; i<num_tables; i++)
+	{
+		if ((int)names[i].size() >= bundle_name_length)
+		{
+			cout << "Table path \"" << names[i] << "\" is too long for bundle!\n";
+			exit(1);
+		}
+		string column_names = "";
+		for (unsigned j=0; j<tables[i].names.size(); j++)
+		{
+			column_names += (j > 0 ? "," : "") + tables[i].names[j];
+		}
+		if ((int)column_names.size() >= bundle_name_length)
+		{
+			cout << "Column names of table \"" << names[i] << "\" are too long for bundle (" << column_names.size() << " characters, must be under " << bundle_name_length << ")!\n";
+			exit(1);
+		}
+		memset(&dir[i], 0, sizeof(Bundle_Entry));
+		strcpy(dir[i].name, names[i].c_str());
+		strcpy(dir[i].column_names, column_names.c_str());
+		struct stat st;
+		if (stat(names[i].c_str(), &st) == 0)
+		{
+			dir[i].source_size = st.st_size;
+			dir[i].source_mtime = st.st_mtime;
+		}
+		dir[i].checksum = checksum_file(names[i]);
+		dir[i].num_cols = tables[i].get_num_cols();
+		dir[i].num_rows = tables[i].get_num_rows();
+		dir[i].offset = offset;
+		offset += dir[i].num_cols*dir[i].num_rows*sizeof(double);
+	}
+
+	ofstream outfile(filename, ios::binary);
+	if (!outfile.good())
+	{
+		cout << "Could not open \"" << filename << "\" for writing!\n";
+		exit(1);
+	}
+	outfile.write((const char *)&h, sizeof(h));
+	outfile.write((const char *)dir.data(), num_tables*sizeof(Bundle_Entry));
+	for (int i=0; i<num_tables; i++)
+	{
+		for (unsigned j=0; j<dir[i].num_cols; j++)
+		{
+			outfile.write((const char *)tables[i].columns[j].data(), dir[i].num_rows*sizeof(double));
+		}
+	}
+	outfile.close();
+}
+
+// FNV-1a hash of the contents of a file
+uint64_t Table_Bundle::checksum_file(string filename)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	ifstream infile(filename, ios::binary);
+	char buf[65536];
+	while (infile.good())
+	{
+		infile.read(buf, sizeof(buf));
+		streamsize n = infile.gcount();
+		for (streamsize i=0; i<n; i++)
+		{
+			hash ^= (unsigned char)buf[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
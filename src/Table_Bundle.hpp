@@ -0,0 +1,88 @@
+/*
+ * Table_Bundle.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+#ifndef TABLE_BUNDLE_HPP_
+#define TABLE_BUNDLE_HPP_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "Common_Functions.hpp"
+using namespace std;
+
+// binary bundle of input tables, written offline by corona3d_pack and memory-mapped by the simulator
+// so that common::read_csv can hand back table columns without parsing any text
+//
+// layout (native byte order):
+//   Bundle_Header
+//   num_tables x Bundle_Entry
+//   table data: each table's columns stored one after another (column-major), starting at Bundle_Entry::offset
+const char bundle_magic[8] = {'C', '3', 'D', 'T', 'B', 'L', '\0', '\0'};
+const uint32_t bundle_version = 2;
+const int bundle_name_length = 256;
+
+struct Bundle_Header {
+	char magic[8];            // bundle_magic
+	uint32_t version;         // bundle_version
+	uint32_t num_tables;      // number of Bundle_Entry records following the header
+};
+
+struct Bundle_Entry {
+	char name[bundle_name_length];  // path of source table, as referenced in the config files
+	char column_names[bundle_name_length];  // column names from source header line, comma-separated (empty if the source has no header)
+	uint64_t checksum;        // FNV-1a hash of the source file contents
+	int64_t source_size;      // size of source file when packed [bytes]
+	int64_t source_mtime;     // modification time of source file when packed [s]
+	uint64_t num_rows;        // number of rows (values per column)
+	uint64_t num_cols;        // number of columns
+	uint64_t offset;          // offset of first column from start of bundle [bytes]
+};
+
+class Table_Bundle {
+public:
+	Table_Bundle();
+	virtual ~Table_Bundle();
+
+	// map bundle file into memory; returns false if it is missing, not a bundle of this version, or damaged
+	// (a directory entry with an unterminated name or with data reaching past the end of the file)
+	bool open(string filename);
+
+	int get_num_tables() const;
+	string get_name(int index) const;
+	uint64_t get_checksum(int index) const;
+	int get_num_rows(int index) const;
+	int get_num_cols(int index) const;
+	vector<string> get_column_names(int index) const;
+
+	// returns index of table packed from source file name, or -1 if not in bundle
+	int find(string name) const;
+
+	// returns pointer to column col of table index (num_rows values)
+	const double *get_column(int index, int col) const;
+
+	// false if the source file still exists but has changed size or modification time since it was packed
+	bool is_current(int index) const;
+
+	// write a bundle of the given tables packed from source files names[i]
+	// (exits if a path or a table's joined column names do not fit in bundle_name_length characters)
+	static void write(string filename, const vector<string> &names, const vector<Csv_Table> &tables);
+
+	// FNV-1a hash of the contents of a file
+	static uint64_t checksum_file(string filename);
+
+private:
+	void *map;                      // start of memory-mapped bundle
+	size_t map_size;                // size of mapping [bytes]
+	const Bundle_Header *header;
+	const Bundle_Entry *entries;
+
+	// bundles own a memory mapping, so they are not copied
+	Table_Bundle(const Table_Bundle &);
+	Table_Bundle &operator=(const Table_Bundle &);
+};
+
+#endif /* TABLE_BUNDLE_HPP_ */
@@ -0,0 +1,181 @@
+/*
+ * corona3d_convolve.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+// offline tool that applies an escape response table (written by a dist_type Response run) to a production profile,
+// giving the escape rate of that source without rerunning transport
+//
+// usage:  corona3d_convolve <response table> <production profile> <energy [eV] | energy spectrum>
+//
+//   production profile:  csv of altitude [cm] and volume production rate [cm^-3 s^-1] on the day side
+//   energy spectrum:     csv of birth energy [eV] and relative weight (or a single birth energy in eV)
+//
+// sources are taken to be isotropic, so direction bins of the table are averaged; rates follow the convention of the
+// simulator's loss rates (production over the day side hemisphere only)
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include "Common_Functions.hpp"
+using namespace std;
+
+// production rate at altitude alt [cm]; zero outside the profile, log-linear between positive points
+static double get_production(vector<double> &alts, vector<double> &rates, double alt)
+{
+	if (alt < alts[0] || alt > alts.back())
+	{
+		return 0.0;
+	}
+	int i = lower_bound(alts.begin(), alts.end(), alt) - alts.begin();
+	if (i == 0)
+	{
+		return rates[0];
+	}
+	if (rates[i-1] > 0.0 && rates[i] > 0.0)
+	{
+		return common::interpolate_logy(alts, rates, alt);
+	}
+	return common::interpolate(alts, rates, alt);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 4)
+	{
+		cout << "usage:  corona3d_convolve <response table> <production profile> <energy [eV] | energy spectrum>\n";
+		return 1;
+	}
+
+	// grid and planet radius are recorded in comment lines of the table
+	double planet_radius = 0.0;
+	int num_alts = 0;
+	int num_energies = 0;
+	int num_cos = 0;
+	ifstream infile(argv[1]);
+	string line;
+	while (getline(infile, line) && !line.empty() && line[0] == '#')
+	{
+		stringstream str(line.substr(1));
+		string key;
+		str >> key;
+		if (key == "planet_radius")
+		{
+			str >> planet_radius;
+		}
+		else if (key == "grid")
+		{
+			str >> num_alts >> num_energies >> num_cos;
+		}
+	}
+	infile.close();
+	if (planet_radius <= 0.0 || num_alts < 1 || num_energies < 1 || num_cos < 1)
+	{
+		cout << "\"" << argv[1] << "\" is not an escape response table!\n";
+		return 1;
+	}
+	Csv_Table table = common::read_csv(argv[1], 11);
+	if (table.get_num_rows() != num_alts*num_energies*num_cos)
+	{
+		cout << "Escape response table \"" << argv[1] << "\" has the wrong number of rows!\n";
+		return 1;
+	}
+	vector<double> &alt_lo = table.columns[0];
+	vector<double> &alt_hi = table.columns[1];
+	vector<double> &energy_lo = table.columns[2];
+	vector<double> &energy_hi = table.columns[3];
+	vector<double> &prob = table.columns[9];
+	vector<double> &prob_err = table.columns[10];
+
+	// birth energy weights per energy bin (energies outside the table's range are counted as not escaping)
+	vector<double> energy_weights(num_energies, 0.0);
+	double total_weight = 0.0;
+	double outside_weight = 0.0;
+	vector<double> energies, weights;
+	char *end = NULL;
+	double single_energy = strtod(argv[3], &end);
+	if (end != argv[3] && *end == '\0')
+	{
+		energies.push_back(single_energy);
+		weights.push_back(1.0);
+	}
+	else
+	{
+		Csv_Table spectrum = common::read_csv(argv[3], 2);
+		energies = spectrum.columns[0];
+		weights = spectrum.columns[1];
+	}
+	double E_min = energy_lo[0];
+	double E_max = energy_hi[(num_energies-1)*num_cos];
+	for (unsigned i=0; i<energies.size(); i++)
+	{
+		total_weight += weights[i];
+		int e = (int)((energies[i] - E_min)/(E_max - E_min)*num_energies);
+		if (energies[i] < E_min || energies[i] > E_max)
+		{
+			outside_weight += weights[i];
+			continue;
+		}
+		energy_weights[min(e, num_energies-1)] += weights[i];
+	}
+	if (!(total_weight > 0.0))
+	{
+		cout << "Energy spectrum has no positive weight!\n";
+		return 1;
+	}
+	if (outside_weight > 0.0)
+	{
+		cout << "warning: " << 100.0*outside_weight/total_weight << "% of the energy spectrum is outside the table's energy range ("
+			<< E_min << " to " << E_max << " eV) and is counted as not escaping\n";
+	}
+
+	Csv_Table profile = common::read_csv(argv[2], 2);
+	vector<double> &prof_alts = profile.columns[0];
+	vector<double> &prof_rates = profile.columns[1];
+
+	// integrate production over each altitude bin of the day side hemisphere
+	const int num_sub = 16;
+	double total_production = 0.0;
+	double total_escape = 0.0;
+	double total_var = 0.0;
+	cout << "#alt_min[km]\talt_max[km]\tproduction[s-1]\tescape[s-1]\tescape_prob\n";
+	for (int a=0; a<num_alts; a++)
+	{
+		int row0 = a*num_energies*num_cos;
+		double lo = alt_lo[row0];
+		double hi = alt_hi[row0];
+		double dz = (hi - lo)/num_sub;
+		double production = 0.0;
+		for (int k=0; k<num_sub; k++)
+		{
+			double z = lo + dz*(k + 0.5);
+			double r = planet_radius + z;
+			production += 2.0*constants::pi*r*r*get_production(prof_alts, prof_rates, z)*dz;
+		}
+
+		double p_esc = 0.0;
+		double p_var = 0.0;
+		for (int e=0; e<num_energies; e++)
+		{
+			double w = energy_weights[e]/total_weight/num_cos;
+			for (int c=0; c<num_cos; c++)
+			{
+				int row = row0 + e*num_cos + c;
+				p_esc += w*prob[row];
+				p_var += w*w*prob_err[row]*prob_err[row];
+			}
+		}
+
+		total_production += production;
+		total_escape += production*p_esc;
+		total_var += production*production*p_var;
+		cout << lo*1e-5 << "\t\t" << hi*1e-5 << "\t\t" << production << "\t" << production*p_esc << "\t" << p_esc << "\n";
+	}
+
+	cout << "Production rate over table altitudes: " << total_production << " per second\n";
+	cout << "Escape rate: " << total_escape << " +/- " << sqrt(total_var) << " per second\n";
+	cout << "Escape fraction: " << (total_production > 0.0 ? total_escape/total_production : 0.0) << "\n";
+	return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * corona3d_pack.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+// offline tool that compiles every csv table referenced by a corona3d_2020 configuration into one
+// binary bundle (see Table_Bundle.hpp), to be used with the "table_bundle" option in corona3d_2020.cfg
+//
+// usage:  corona3d_pack <main config> <bundle>     pack tables referenced by config (run from simulation directory)
+//         corona3d_pack -v <bundle>                 list bundle contents and check them against their csv files
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <set>
+#include <sys/stat.h>
+#include "Common_Functions.hpp"
+#include "Table_Bundle.hpp"
+using namespace std;
+
+// distribution configs are read from fixed filenames by Distribution_Hot_H and Distribution_Hot_O
+static const char *dist_configs[] = {"Hot_H.cfg", "Hot_O.cfg"};
+
+static bool is_regular_file(const string &filename)
+{
+	struct stat st;
+	return (stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode));
+}
+
+// collect every value in config file filename that names an existing file; other .cfg files are followed
+static void collect_tables(const string &filename, set<string> &visited, vector<string> &tables)
+{
+	if (visited.count(filename) > 0)
+	{
+		return;
+	}
+	visited.insert(filename);
+
+	ifstream infile;
+	infile.open(filename);
+	string line, param, val;
+	while (getline(infile, line))
+	{
+		if (line[0] == '#' || line.empty() || std::all_of(line.begin(), line.end(), ::isspace))
+		{
+			continue;
+		}
+		stringstream str(line);
+		param = "";
+		val = "";
+		str >> param >> val;
+		if (val == "" || !is_regular_file(val))
+		{
+			continue;
+		}
+		if (val.size() > 4 && val.compare(val.size()-4, 4, ".cfg") == 0)
+		{
+			collect_tables(val, visited, tables);
+		}
+		else if (find(tables.begin(), tables.end(), val) == tables.end())
+		{
+			tables.push_back(val);
+		}
+	}
+	infile.close();
+}
+
+static int pack(const string &config, const string &bundle)
+{
+	if (!is_regular_file(config))
+	{
+		cout << "Configuration file \"" << config << "\" not found!\n";
+		return 1;
+	}
+
+	set<string> visited;
+	vector<string> candidates;
+	collect_tables(config, visited, candidates);
+	for (const char *dist_config : dist_configs)
+	{
+		if (is_regular_file(dist_config))
+		{
+			collect_tables(dist_config, visited, candidates);
+		}
+	}
+
+	vector<string> names;
+	vector<Csv_Table> tables;
+	for (const string &name : candidates)
+	{
+		Csv_Table table;
+		string error;
+		if (!common::try_read_csv(name, table, error))
+		{
+			cout << "skipping " << name << " (not a numeric csv table: " << error << ")\n";
+			continue;
+		}
+		if (table.get_num_rows() == 0)
+		{
+			cout << "skipping " << name << " (no data rows)\n";
+			continue;
+		}
+		cout << "packing " << name << " (" << table.get_num_rows() << " rows, " << table.get_num_cols() << " columns)\n";
+		names.push_back(name);
+		tables.push_back(table);
+	}
+
+	Table_Bundle::write(bundle, names, tables);
+	cout << "Wrote " << names.size() << " tables to " << bundle << "\n";
+	return 0;
+}
+
+static int verify(const string &bundle)
+{
+	Table_Bundle b;
+	if (!b.open(bundle))
+	{
+		cout << "\"" << bundle << "\" not found or not a valid bundle of version " << bundle_version << "!\n";
+		return 1;
+	}
+
+	int num_changed = 0;
+	for (int i=0; i<b.get_num_tables(); i++)
+	{
+		string name = b.get_name(i);
+		string status = "ok";
+		if (!is_regular_file(name))
+		{
+			status = "csv file missing";
+		}
+		else if (Table_Bundle::checksum_file(name) != b.get_checksum(i))
+		{
+			status = "CHANGED";
+			num_changed++;
+		}
+		cout << hex << setw(16) << setfill('0') << b.get_checksum(i) << dec << setfill(' ') << "  " << setw(6) << b.get_num_rows(i) << " x " << b.get_num_cols(i) << "  " << name << "  " << status << "\n";
+	}
+	cout << b.get_num_tables() << " tables, " << num_changed << " changed since packing\n";
+	return (num_changed > 0) ? 2 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 3 && string(argv[1]) == "-v")
+	{
+		return verify(argv[2]);
+	}
+	else if (argc == 3)
+	{
+		return pack(argv[1], argv[2]);
+	}
+
+	cout << "usage:  corona3d_pack <main config> <bundle>\n";
+	cout << "        corona3d_pack -v <bundle>\n";
+	return 1;
+}
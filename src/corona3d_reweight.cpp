@@ -0,0 +1,157 @@
+/*
+ * corona3d_reweight.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: agent
+ */
+
+// offline tool that recomputes the density, column density and escape outputs of a run made with "record_births 1"
+// for a different source altitude profile, without transporting particles again: the particles born in each 1 km
+// birth group are weighted by the ratio of the new source's share of production in that group to the run's share of
+// births there (see Birth_Record.hpp for when this is valid)
+//
+// usage:  corona3d_reweight <birth record> <production profile> <output prefix>
+//
+//   production profile:  csv of altitude [cm] and volume production rate [cm^-3 s^-1] of the new source, on the day side
+//   outputs:             <output prefix>density1d_day.out, density1d_night.out and column_density_day.out, in the
+//                        simulator's formats, for the altitude bins covered by the record
+#include <iostream>
+#include <fstream>
+#include "Common_Functions.hpp"
+#include "Birth_Record.hpp"
+using namespace std;
+
+// production rate at altitude alt [cm]; zero outside the profile, log-linear between positive points
+static double get_production(vector<double> &alts, vector<double> &rates, double alt)
+{
+	if (alt < alts[0] || alt > alts.back())
+	{
+		return 0.0;
+	}
+	int i = lower_bound(alts.begin(), alts.end(), alt) - alts.begin();
+	if (i == 0)
+	{
+		return rates[0];
+	}
+	if (rates[i-1] > 0.0 && rates[i] > 0.0)
+	{
+		return common::interpolate_logy(alts, rates, alt);
+	}
+	return common::interpolate(alts, rates, alt);
+}
+
+// global production rate [s^-1] between altitudes lo and hi [cm] (over the whole sphere, as for the Hot_H sources)
+static double integrate_production(vector<double> &alts, vector<double> &rates, double planet_radius, double lo, double hi)
+{
+	const double step = 1000.0;  // [cm]
+	int n = max(1, (int)((hi - lo)/step));
+	double dz = (hi - lo)/n;
+	double total = 0.0;
+	for (int k=0; k<n; k++)
+	{
+		double z = lo + dz*(k + 0.5);
+		double r = planet_radius + z;
+		total += 4.0*constants::pi*r*r*get_production(alts, rates, z)*dz;
+	}
+	return total;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 4)
+	{
+		cout << "usage:  corona3d_reweight <birth record> <production profile> <output prefix>\n";
+		return 1;
+	}
+
+	Birth_Record rec;
+	string error;
+	if (!rec.read(argv[1], error))
+	{
+		cout << "Could not read birth record \"" << argv[1] << "\": " << error << "!\n";
+		return 1;
+	}
+	Csv_Table profile = common::read_csv(argv[2], 2);
+	vector<double> &prof_alts = profile.columns[0];
+	vector<double> &prof_rates = profile.columns[1];
+
+	// new production per birth group, and in total
+	double R = rec.planet_radius;
+	double global_rate = integrate_production(prof_alts, prof_rates, R, prof_alts[0], prof_alts.back());
+	if (!(global_rate > 0.0))
+	{
+		cout << "Production profile has no positive production!\n";
+		return 1;
+	}
+	vector<double> weights(rec.num_groups, 0.0);
+	double covered = 0.0;
+	for (int g=0; g<rec.num_groups; g++)
+	{
+		double lo = 1e5*(rec.first_group + g);
+		double q = integrate_production(prof_alts, prof_rates, R, lo, lo + 1e5);
+		if (rec.births[g] > 0.0)
+		{
+			weights[g] = (q/global_rate) * rec.num_parts / rec.births[g];
+			covered += q;
+		}
+	}
+	cout << "Global production rate of new source: " << global_rate << " per second (recorded run: " << rec.global_rate << ")\n";
+	if (covered < 0.999*global_rate)
+	{
+		cout << "warning: " << 100.0*(1.0 - covered/global_rate) << "% of the new production is at altitudes with no recorded births and is left out\n";
+	}
+
+	// reweighted counts, then the same normalization as Atmosphere::output_tally
+	int nb = rec.num_alt_bins;
+	vector<double> dens_day(nb, 0.0), dens_night(nb, 0.0), coldens_day(nb, 0.0);
+	double escapes = 0.0;
+	double escape_var = 0.0;
+	for (int g=0; g<rec.num_groups; g++)
+	{
+		double w = weights[g];
+		if (w == 0.0)
+		{
+			continue;
+		}
+		size_t base = (size_t)g*nb;
+		for (int i=0; i<nb; i++)
+		{
+			dens_day[i] += w*rec.dens_day[base + i];
+			dens_night[i] += w*rec.dens_night[base + i];
+			coldens_day[i] += w*rec.coldens_day[base + i];
+		}
+		double esc = rec.escapes_day[g] + rec.escapes_night[g];
+		double p = esc/rec.births[g];
+		escapes += w*esc;
+		escape_var += w*w*rec.births[g]*p*(1.0 - p);
+	}
+
+	double rate = global_rate/2.0;
+	double scale = rec.dt*rate/(double)rec.num_parts;
+	string prefix = argv[3];
+	ofstream dens_day_out(prefix + "density1d_day.out");
+	ofstream dens_night_out(prefix + "density1d_night.out");
+	ofstream coldens_day_out(prefix + "column_density_day.out");
+	if (!dens_day_out.good() || !dens_night_out.good() || !coldens_day_out.good())
+	{
+		cout << "Could not open output files with prefix \"" << prefix << "\"!\n";
+		return 1;
+	}
+	dens_day_out << "#alt[km]\tdensity[cm-3]\n";
+	dens_night_out << "#alt[km]\tdensity[cm-3]\n";
+	coldens_day_out << "#alt[km]\tcol density[cm-2]\n";
+	for (int i=0; i<nb; i++)
+	{
+		double r_in_cm = R + 1e5*(double)i;
+		double volume = 2.0*constants::pi/3.0 * (pow(r_in_cm+1e5, 3.0) - pow(r_in_cm, 3.0));
+		double coldens_area = 0.5 * constants::pi * (pow(r_in_cm+1e5, 2.0) - pow(r_in_cm, 2.0));
+		dens_day_out << i << "\t\t" << scale*dens_day[i] / volume << "\n";
+		dens_night_out << i << "\t\t" << scale*dens_night[i] / volume << "\n";
+		coldens_day_out << i << "\t\t" << scale*coldens_day[i] / coldens_area << "\n";
+	}
+
+	double fraction = escapes/rec.num_parts;
+	cout << "Escape fraction: " << fraction << " +/- " << sqrt(escape_var)/rec.num_parts << "\n";
+	cout << "Total loss rate: " << fraction*rate << " +/- " << sqrt(escape_var)/rec.num_parts*rate << " per second\n";
+	return 0;
+}
@@ -9,46 +9,15 @@
 #include <iomanip>
 #include <typeinfo>
 #include "Atmosphere.hpp"
+#include "Mlmc_Driver.hpp"
 using namespace std;
 
-//subroutine to set particle types from main
-shared_ptr<Particle> set_particle_type(string type)
-{
-	shared_ptr<Particle> p;
-
-	if (type == "H")
-	{
-		p = make_shared<Particle_H>();
-	}
-	else if (type == "O")
-	{
-		p = make_shared<Particle_O>();
-	}
-	else if (type == "N2")
-	{
-		p = make_shared<Particle_N2>();
-	}
-	else if (type == "CO")
-	{
-		p = make_shared<Particle_CO>();
-	}
-	else if (type == "CO2")
-	{
-		p = make_shared<Particle_CO2>();
-	}
-	else
-	{
-		cout << "Invalid particle type specified! Please check configuration file.\n";
-		exit(1);
-	}
-	return p;
-}
-
 int main(int argc, char* argv[])
 {
 	cout << "Initializing Simulation...\n";
 
 	//initialize and read parameters from configuration file
+	Run_Options run;    // run_simulation parameters, filled in directly where the config sets them
 	int num_testparts = 0;
 	string part_type = "";
 	string dist_type = "";
@@ -59,28 +28,38 @@ int main(int argc, char* argv[])
 	string trace_output_dir = "";
 	int num_EDFs = 0;
 	int EDF_alts_index = 0;
-	int print_status_freq = 0;
-	int output_pos_freq = 0;
-	string output_pos_dir = "";
-	string output_stats_dir = "";
+	string output_pos_format = "text";
+	string init_sampling = "random";
+	double response_alt_min = 80e5;
+	double response_alt_max = 400e5;
+	int response_alt_bins = 32;
+	double response_energy_min = 0.0;
+	double response_energy_max = 10.0;
+	int response_energy_bins = 20;
+	int response_cos_bins = 1;
+	string stats_estimator = "point";
+	string integrator = "verlet";
+	string parallel_mode = "serial";
+	string thread_pinning = "none";
+	double mlmc_tolerance = 0.0;
+	int mlmc_max_levels = 4;
 	double profile_bottom_alt = 0.0;
 	double profile_top_alt = 0.0;
 	string temp_profile_filename = "";
 	string neut_densities_filename = "";
 	string ion_densities_filename = "";
-	int timesteps = 0;
-	double dt = 0.0;
 	double ref_height = 0.0;
 	double ref_temp = 0.0;
 	double planet_mass = 0.0;
 	double planet_radius = 0.0;
-	double sim_lower_bound = 0.0;
-	double sim_upper_bound = 0.0;
 	Planet my_planet;
-	vector<shared_ptr<Particle>> parts;
+	vector<Particle> parts;
 	shared_ptr<Distribution> dist;
 	int num_bgparts = 0;
 	int bg_params_index = 0;
+	string table_bundle_filename = "";
+	string cache_dir = "";
+	int num_threads = 0;
 
 	ifstream infile;
 	infile.open("corona3d_2020.cfg");
@@ -127,14 +106,46 @@ int main(int argc, char* argv[])
 		{
 			dist_type = values[i];
 		}
+		else if (parameters[i] == "init_sampling")
+		{
+			init_sampling = values[i];
+		}
 		else if (parameters[i] == "pos_infile")
 		{
 			pos_infile = values[i];
 		}
-		else if (parameters[i] == "vel_infle")
+		else if (parameters[i] == "vel_infile" || parameters[i] == "vel_infle")
 		{
 			vel_infile = values[i];
 		}
+		else if (parameters[i] == "response_alt_min")
+		{
+			response_alt_min = stod(values[i]);
+		}
+		else if (parameters[i] == "response_alt_max")
+		{
+			response_alt_max = stod(values[i]);
+		}
+		else if (parameters[i] == "response_alt_bins")
+		{
+			response_alt_bins = stoi(values[i]);
+		}
+		else if (parameters[i] == "response_energy_min")
+		{
+			response_energy_min = stod(values[i]);
+		}
+		else if (parameters[i] == "response_energy_max")
+		{
+			response_energy_max = stod(values[i]);
+		}
+		else if (parameters[i] == "response_energy_bins")
+		{
+			response_energy_bins = stoi(values[i]);
+		}
+		else if (parameters[i] == "response_cos_bins")
+		{
+			response_cos_bins = stoi(values[i]);
+		}
 		else if (parameters[i] == "output_dir")
 		{
 			output_dir = values[i];
@@ -149,19 +160,31 @@ int main(int argc, char* argv[])
 		}
 		else if (parameters[i] == "print_status_freq")
 		{
-			print_status_freq = stoi(values[i]);
+			run.print_status_freq = stoi(values[i]);
 		}
 		else if (parameters[i] == "output_pos_freq")
 		{
-			output_pos_freq = stoi(values[i]);
+			run.output_pos_freq = stoi(values[i]);
+		}
+		else if (parameters[i] == "output_pos_format")
+		{
+			output_pos_format = values[i];
 		}
 		else if (parameters[i] == "output_pos_dir")
 		{
-			output_pos_dir = values[i];
+			run.output_pos_dir = values[i];
+		}
+		else if (parameters[i] == "record_births")
+		{
+			run.record_births = (stoi(values[i]) != 0);
+		}
+		else if (parameters[i] == "stats_estimator")
+		{
+			stats_estimator = values[i];
 		}
 		else if (parameters[i] == "output_stats_dir")
 		{
-			output_stats_dir = values[i];
+			run.output_stats_dir = values[i];
 		}
 		else if (parameters[i] == "profile_bottom_alt")
 		{
@@ -183,13 +206,49 @@ int main(int argc, char* argv[])
 		{
 			ion_densities_filename = values[i];
 		}
+		else if (parameters[i] == "integrator")
+		{
+			integrator = values[i];
+		}
+		else if (parameters[i] == "substep_tau")
+		{
+			run.max_substep_tau = stod(values[i]);
+		}
+		else if (parameters[i] == "max_substeps")
+		{
+			run.max_substeps = stoi(values[i]);
+		}
+		else if (parameters[i] == "sort_freq")
+		{
+			run.sort_freq = stoi(values[i]);
+		}
+		else if (parameters[i] == "parallel_mode")
+		{
+			parallel_mode = values[i];
+		}
+		else if (parameters[i] == "thread_pinning")
+		{
+			thread_pinning = values[i];
+		}
+		else if (parameters[i] == "mlmc_tolerance")
+		{
+			mlmc_tolerance = stod(values[i]);
+		}
+		else if (parameters[i] == "mlmc_max_levels")
+		{
+			mlmc_max_levels = stoi(values[i]);
+		}
+		else if (parameters[i] == "check_energy")
+		{
+			run.check_energy = (stoi(values[i]) != 0);
+		}
 		else if (parameters[i] == "timesteps")
 		{
-			timesteps = stoi(values[i]);
+			run.num_steps = stoi(values[i]);
 		}
 		else if (parameters[i] == "dt")
 		{
-			dt = stod(values[i]);
+			run.dt = stod(values[i]);
 		}
 		else if (parameters[i] == "ref_height")
 		{
@@ -209,11 +268,11 @@ int main(int argc, char* argv[])
 		}
 		else if (parameters[i] == "sim_lower_bound")
 		{
-			sim_lower_bound = stod(values[i]);
+			run.lower_bound = stod(values[i]);
 		}
 		else if (parameters[i] == "sim_upper_bound")
 		{
-			sim_upper_bound = stod(values[i]);
+			run.upper_bound = stod(values[i]);
 		}
 		else if (parameters[i] == "num_bgparts")
 		{
@@ -225,14 +284,52 @@ int main(int argc, char* argv[])
 			num_EDFs = stoi(values[i]);
 			EDF_alts_index = i+1;
 		}
+		else if (parameters[i] == "table_bundle")
+		{
+			table_bundle_filename = values[i];
+		}
+		else if (parameters[i] == "cache_dir")
+		{
+			cache_dir = values[i];
+		}
+		else if (parameters[i] == "num_threads")
+		{
+			num_threads = stoi(values[i]);
+		}
+	}
+
+	//use pre-packed input tables if a bundle is given (must happen before any tables are imported)
+	if (table_bundle_filename != "")
+	{
+		common::use_table_bundle(table_bundle_filename);
+	}
+
+	//reuse tables derived from the inputs (source and scattering CDFs) from earlier runs if a cache directory is given
+	if (cache_dir != "")
+	{
+		Derived_Cache::set_directory(cache_dir);
 	}
 
 	//initialize planet and test particles
 	my_planet.init(planet_mass, planet_radius);
-	parts.resize(num_testparts);
-	for (int i=0; i<num_testparts; i++)
+	int part_species = get_species_id(part_type);
+	if (part_species < 0)
 	{
-		parts[i] = set_particle_type(part_type);
+		cout << "Invalid particle type specified! Please check configuration file.\n";
+		exit(1);
+	}
+	parts.assign(num_testparts, Particle(part_species));
+
+	//draw initial conditions from a scrambled Sobol sequence instead of pseudo-random numbers if requested
+	if (init_sampling == "sobol")
+	{
+		sampling::use_qmc(true);
+		cout << "Using scrambled Sobol sequence for particle initial conditions\n";
+	}
+	else if (init_sampling != "random")
+	{
+		cout << "Unknown init_sampling \"" << init_sampling << "\" (must be random or sobol)!\n";
+		exit(1);
 	}
 
 	//instantiate the Distribution class to be used
@@ -252,19 +349,25 @@ int main(int argc, char* argv[])
 	{
 		dist = make_shared<Distribution_Import>(my_planet, ref_height, ref_temp, pos_infile, vel_infile);
 	}
+	else if (dist_type == "Response")
+	{
+		dist = make_shared<Distribution_Response>(my_planet, ref_height, ref_temp, response_alt_min, response_alt_max, response_alt_bins,
+				response_energy_min, response_energy_max, response_energy_bins, response_cos_bins);
+	}
 	else
 	{
 		cout << "Invalid distribution type! Please check configuration file.\n";
 		return 1;
 	}
 
-	//initialize Background_Species
+	//load atmosphere database once and initialize Background_Species from it
 	string bg_config_files[num_bgparts];
 	for (int i=0; i<num_bgparts; i++)
 	{
 		bg_config_files[i] = values[bg_params_index + i];
 	}
-	Background_Species bg_spec(num_bgparts, bg_config_files, my_planet, ref_temp, ref_height, temp_profile_filename, neut_densities_filename, profile_bottom_alt, profile_top_alt);
+	shared_ptr<const Atmosphere_Database> atm_db(new Atmosphere_Database(num_bgparts, bg_config_files, my_planet, ref_temp, ref_height, temp_profile_filename, neut_densities_filename, profile_bottom_alt, profile_top_alt));
+	Background_Species bg_spec(atm_db);
 
 	//set up EDF altitudes to be passed to atmosphere class
 	int EDF_alts[num_EDFs];
@@ -274,25 +377,78 @@ int main(int argc, char* argv[])
 	}
 
 	//set output directory paths to default if necessary
-	if (output_pos_dir == "")
+	if (output_pos_format != "text" && output_pos_format != "binary")
 	{
-		output_pos_dir = output_dir;
+		cout << "Unknown output_pos_format \"" << output_pos_format << "\" (must be text or binary)!\n";
+		exit(1);
+	}
+	if (stats_estimator != "point" && stats_estimator != "track")
+	{
+		cout << "Unknown stats_estimator \"" << stats_estimator << "\" (must be point or track)!\n";
+		exit(1);
+	}
+	run.output_pos_binary = (output_pos_format == "binary");
+	run.track_length_stats = (stats_estimator == "track");
+	if (integrator == "yoshida4")
+	{
+		run.method = integrator_yoshida4;
+	}
+	else if (integrator == "kepler")
+	{
+		run.method = integrator_kepler;
+	}
+	else if (integrator != "verlet")
+	{
+		cout << "Unknown integrator \"" << integrator << "\" (must be verlet, yoshida4, or kepler)!\n";
+		exit(1);
+	}
+	if (parallel_mode == "particles")
+	{
+		run.parallel = parallel_particles;
+	}
+	else if (parallel_mode == "shells")
+	{
+		run.parallel = parallel_shells;
+	}
+	else if (parallel_mode != "serial")
+	{
+		cout << "Unknown parallel_mode \"" << parallel_mode << "\" (must be serial, particles, or shells)!\n";
+		exit(1);
+	}
+	numa::init(thread_pinning);
+	if (run.output_pos_dir == "")
+	{
+		run.output_pos_dir = output_dir;
 	}
 	if (trace_output_dir == "")
 	{
 		trace_output_dir = output_dir;
 	}
-	if (output_stats_dir == "")
+	if (run.output_stats_dir == "")
+	{
+		run.output_stats_dir = output_dir;
+	}
+
+	//use all available hardware threads unless told otherwise
+	if (num_threads <= 0)
+	{
+		num_threads = max(1, (int)thread::hardware_concurrency());
+	}
+
+	// multilevel Monte Carlo over timestep resolution replaces the single run if asked for
+	if (mlmc_tolerance > 0.0)
 	{
-		output_stats_dir = output_dir;
+		Mlmc_Driver mlmc(my_planet, Particle(part_species), dist, bg_spec, num_EDFs, EDF_alts, num_threads);
+		mlmc.run(run, mlmc_tolerance, mlmc_max_levels, num_testparts);
+		return 0;
 	}
 
 	// initialize atmosphere and run simulation
-	Atmosphere my_atmosphere(num_testparts, num_traced, trace_output_dir, my_planet, parts, dist, bg_spec, num_EDFs, EDF_alts);
+	Atmosphere my_atmosphere(num_testparts, num_traced, trace_output_dir, my_planet, parts, dist, bg_spec, num_EDFs, EDF_alts, num_threads);
 	//my_atmosphere.output_velocity_distro(10000.0, output_dir + "vdist.out");
 	//my_atmosphere.output_altitude_distro(100000.0, output_dir + "altdist.out");
 	//my_atmosphere.output_alt_energy_distro(133e5, 0.03, output_dir + "edist.out");
-	my_atmosphere.run_simulation(dt, timesteps, sim_lower_bound, sim_upper_bound, print_status_freq, output_pos_freq, output_pos_dir, output_stats_dir);
+	my_atmosphere.run_simulation(run);
 	//my_atmosphere.output_velocity_distro(10000.0, output_dir + "vdist2.out");
 	//my_atmosphere.output_altitude_distro(100000.0, output_dir + "altdist2.out");
 